@@ -292,6 +292,7 @@ struct evdev_dispatch_interface lid_switch_interface = {
 	lid_switch_interface_device_added,   /* device_resumed, treat as add */
 	lid_switch_sync_initial_state,
 	NULL, /* toggle_touch */
+	NULL, /* process_frame */
 };
 
 struct evdev_dispatch *
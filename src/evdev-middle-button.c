@@ -700,6 +700,8 @@ evdev_init_middlebutton(struct evdev_device *device,
 			    evdev_libinput_context(device),
 			    evdev_middlebutton_handle_timeout,
 			    device);
+	libinput_timer_set_slack(&device->middlebutton.timer,
+				 TIMER_SLACK_DEFAULT);
 	device->middlebutton.enabled_default = enable;
 	device->middlebutton.want_enabled = enable;
 	device->middlebutton.enabled = enable;
@@ -0,0 +1,409 @@
+/*
+ * Copyright © 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include "evdev.h"
+
+/* Protocol A devices send the full list of contacts in every frame, each
+ * contact terminated by SYN_MT_REPORT, without any identity. We match the
+ * contacts of a frame to the slots of the previous frame by distance and
+ * send the difference as protocol B events, i.e. what the fallback
+ * dispatch expects from a slotted device.
+ *
+ * A contact further away from a slot than max_distance is a new touch. If
+ * the device sends a tracking ID, contacts only match slots with the same
+ * ID. Only the first EVDEV_MT_A_MAX_SLOTS contacts of a frame are used,
+ * the others are ignored with a ratelimited log message.
+ */
+
+#define MT_A_AXIS(code_) ((code_) - ABS_MT_TOUCH_MAJOR)
+
+/* Contacts further apart than this are separate touches */
+#define MT_A_MAX_DISTANCE_MM 30
+
+struct mt_a_contact {
+	uint32_t has; /* bitmask of MT_A_AXIS() */
+	int32_t values[EVDEV_MT_A_NAXES];
+};
+
+struct evdev_mt_a {
+	struct evdev_device *device;
+
+	/* the contacts of the current frame */
+	struct mt_a_contact contacts[EVDEV_MT_A_MAX_SLOTS];
+	unsigned int ncontacts;
+	unsigned int ndropped; /* contacts beyond EVDEV_MT_A_MAX_SLOTS */
+	struct ratelimit dropped_limit;
+
+	/* the contact before its SYN_MT_REPORT */
+	struct mt_a_contact current;
+
+	struct {
+		int32_t tracking_id; /* -1 if the slot is unused */
+		struct mt_a_contact contact;
+	} slots[EVDEV_MT_A_MAX_SLOTS];
+	int slot; /* the last ABS_MT_SLOT sent, or -1 */
+	int32_t next_tracking_id;
+
+	uint64_t max_distance2; /* squared, in device units */
+};
+
+static inline bool
+mt_a_has(const struct mt_a_contact *c, unsigned int code)
+{
+	return !!(c->has & (1U << MT_A_AXIS(code)));
+}
+
+static inline int32_t
+mt_a_value(const struct mt_a_contact *c, unsigned int code)
+{
+	return c->values[MT_A_AXIS(code)];
+}
+
+struct evdev_mt_a *
+evdev_mt_a_new(struct evdev_device *device)
+{
+	struct evdev_mt_a *mt;
+	uint64_t max_distance;
+
+	mt = zalloc(sizeof *mt);
+	if (!mt)
+		return NULL;
+
+	mt->device = device;
+	ratelimit_init(&mt->dropped_limit, s2us(30), 5);
+
+	if (device->abs.is_fake_resolution)
+		max_distance = min(device->abs.dimensions.x,
+				   device->abs.dimensions.y) / 4;
+	else
+		max_distance = MT_A_MAX_DISTANCE_MM *
+			       max(device->abs.absinfo_x->resolution,
+				   device->abs.absinfo_y->resolution);
+	mt->max_distance2 = max_distance * max_distance;
+
+	evdev_mt_a_reset(mt);
+
+	return mt;
+}
+
+void
+evdev_mt_a_destroy(struct evdev_mt_a *mt)
+{
+	free(mt);
+}
+
+void
+evdev_mt_a_reset(struct evdev_mt_a *mt)
+{
+	unsigned int i;
+
+	mt->ncontacts = 0;
+	mt->ndropped = 0;
+	mt->current.has = 0;
+	mt->slot = -1; /* unknown, the next frame sends ABS_MT_SLOT */
+
+	for (i = 0; i < ARRAY_LENGTH(mt->slots); i++)
+		mt->slots[i].tracking_id = -1;
+}
+
+static inline struct input_event *
+mt_a_event(struct input_event *out,
+	   const struct timeval *time,
+	   unsigned int code,
+	   int32_t value)
+{
+	out->time = *time;
+	out->type = EV_ABS;
+	out->code = code;
+	out->value = value;
+
+	return out + 1;
+}
+
+static inline struct input_event *
+mt_a_select_slot(struct evdev_mt_a *mt,
+		 struct input_event *out,
+		 const struct timeval *time,
+		 int slot)
+{
+	if (mt->slot == slot)
+		return out;
+
+	mt->slot = slot;
+
+	return mt_a_event(out, time, ABS_MT_SLOT, slot);
+}
+
+static inline uint64_t
+mt_a_distance(const struct mt_a_contact *a, const struct mt_a_contact *b)
+{
+	int64_t dx = (int64_t)mt_a_value(a, ABS_MT_POSITION_X) -
+		     mt_a_value(b, ABS_MT_POSITION_X),
+		dy = (int64_t)mt_a_value(a, ABS_MT_POSITION_Y) -
+		     mt_a_value(b, ABS_MT_POSITION_Y);
+
+	return dx * dx + dy * dy;
+}
+
+/* Match the contacts of this frame to the slots in use, closest pairs
+ * first. contact_slot[i] is the slot for contact i or -1 for a new
+ * contact. */
+static void
+mt_a_match_contacts(struct evdev_mt_a *mt,
+		    int contact_slot[EVDEV_MT_A_MAX_SLOTS],
+		    bool slot_matched[EVDEV_MT_A_MAX_SLOTS])
+{
+	unsigned int c, s;
+
+	for (c = 0; c < mt->ncontacts; c++)
+		contact_slot[c] = -1;
+	for (s = 0; s < EVDEV_MT_A_MAX_SLOTS; s++)
+		slot_matched[s] = false;
+
+	while (true) {
+		uint64_t best = UINT64_MAX;
+		int best_contact = -1, best_slot = -1;
+
+		for (s = 0; s < EVDEV_MT_A_MAX_SLOTS; s++) {
+			const struct mt_a_contact *slot_contact;
+
+			if (mt->slots[s].tracking_id == -1 || slot_matched[s])
+				continue;
+
+			slot_contact = &mt->slots[s].contact;
+
+			for (c = 0; c < mt->ncontacts; c++) {
+				const struct mt_a_contact *contact;
+				uint64_t d;
+
+				if (contact_slot[c] != -1)
+					continue;
+
+				contact = &mt->contacts[c];
+
+				if (mt_a_has(contact, ABS_MT_TRACKING_ID) &&
+				    mt_a_has(slot_contact, ABS_MT_TRACKING_ID)) {
+					if (mt_a_value(contact, ABS_MT_TRACKING_ID) !=
+					    mt_a_value(slot_contact, ABS_MT_TRACKING_ID))
+						continue;
+					d = 0;
+				} else {
+					d = mt_a_distance(contact, slot_contact);
+					if (d > mt->max_distance2)
+						continue;
+				}
+
+				if (d < best) {
+					best = d;
+					best_contact = c;
+					best_slot = s;
+				}
+			}
+		}
+
+		if (best_contact == -1)
+			break;
+
+		contact_slot[best_contact] = best_slot;
+		slot_matched[best_slot] = true;
+	}
+}
+
+/* Send the axes of contact p that differ from the slot, or all of them
+ * for a new touch */
+static struct input_event *
+mt_a_send_axes(struct evdev_mt_a *mt,
+	       struct input_event *e,
+	       const struct timeval *time,
+	       int slot,
+	       const struct mt_a_contact *p,
+	       bool is_new)
+{
+	struct mt_a_contact *sc = &mt->slots[slot].contact;
+	unsigned int code;
+
+	for (code = ABS_MT_TOUCH_MAJOR; code <= ABS_MT_TOOL_Y; code++) {
+		int32_t value;
+
+		if (code == ABS_MT_TRACKING_ID || !mt_a_has(p, code))
+			continue;
+
+		value = mt_a_value(p, code);
+		if (!is_new && mt_a_has(sc, code) && mt_a_value(sc, code) == value)
+			continue;
+
+		e = mt_a_select_slot(mt, e, time, slot);
+		e = mt_a_event(e, time, code, value);
+	}
+
+	/* keep the last value of axes the contact didn't send */
+	if (is_new)
+		*sc = *p;
+	else {
+		for (code = ABS_MT_TOUCH_MAJOR; code <= ABS_MT_TOOL_Y; code++) {
+			if (mt_a_has(p, code))
+				sc->values[MT_A_AXIS(code)] = mt_a_value(p, code);
+		}
+		sc->has |= p->has;
+	}
+
+	return e;
+}
+
+/* Convert the current frame to protocol B events in out, the last one
+ * being the SYN_REPORT. */
+static size_t
+mt_a_flush(struct evdev_mt_a *mt,
+	   const struct input_event *syn_report,
+	   struct input_event *out)
+{
+	int contact_slot[EVDEV_MT_A_MAX_SLOTS];
+	int slot_contact[EVDEV_MT_A_MAX_SLOTS];
+	bool slot_matched[EVDEV_MT_A_MAX_SLOTS];
+	bool slot_restart[EVDEV_MT_A_MAX_SLOTS] = { false };
+	const struct timeval *time = &syn_report->time;
+	struct input_event *e = out;
+	unsigned int c, s;
+
+	mt_a_match_contacts(mt, contact_slot, slot_matched);
+
+	/* New contacts get a slot unused in the previous frame, so a slot
+	 * doesn't end and restart within the same frame. If there is
+	 * none left, they take over a slot that ends in this frame. */
+	for (c = 0; c < mt->ncontacts; c++) {
+		if (contact_slot[c] != -1)
+			continue;
+
+		for (s = 0; s < EVDEV_MT_A_MAX_SLOTS; s++) {
+			if (mt->slots[s].tracking_id == -1 && !slot_matched[s])
+				break;
+		}
+
+		if (s == EVDEV_MT_A_MAX_SLOTS) {
+			for (s = 0; s < EVDEV_MT_A_MAX_SLOTS; s++) {
+				if (!slot_matched[s])
+					break;
+			}
+			slot_restart[s] = true;
+		}
+
+		contact_slot[c] = s;
+		slot_matched[s] = true;
+	}
+
+	for (s = 0; s < EVDEV_MT_A_MAX_SLOTS; s++)
+		slot_contact[s] = -1;
+	for (c = 0; c < mt->ncontacts; c++)
+		slot_contact[contact_slot[c]] = c;
+
+	for (s = 0; s < EVDEV_MT_A_MAX_SLOTS; s++) {
+		struct mt_a_contact *p;
+
+		if (slot_contact[s] == -1 || slot_restart[s]) {
+			if (mt->slots[s].tracking_id != -1) {
+				e = mt_a_select_slot(mt, e, time, s);
+				e = mt_a_event(e, time, ABS_MT_TRACKING_ID, -1);
+				mt->slots[s].tracking_id = -1;
+			}
+
+			if (slot_contact[s] == -1)
+				continue;
+		}
+
+		p = &mt->contacts[slot_contact[s]];
+
+		if (mt->slots[s].tracking_id == -1) {
+			e = mt_a_select_slot(mt, e, time, s);
+			e = mt_a_event(e, time, ABS_MT_TRACKING_ID,
+				       mt->next_tracking_id);
+			e = mt_a_send_axes(mt, e, time, s, p, true);
+			mt->slots[s].tracking_id = mt->next_tracking_id;
+			mt->next_tracking_id = (mt->next_tracking_id + 1) & 0xffff;
+		} else {
+			e = mt_a_send_axes(mt, e, time, s, p, false);
+		}
+	}
+
+	*e++ = *syn_report;
+	mt->ncontacts = 0;
+
+	return e - out;
+}
+
+size_t
+evdev_mt_a_process(struct evdev_mt_a *mt,
+		   const struct input_event *e,
+		   struct input_event *out)
+{
+	switch (e->type) {
+	case EV_ABS:
+		/* per-contact data is sent with the emulated slots */
+		if (e->code >= ABS_MT_TOUCH_MAJOR && e->code <= ABS_MT_TOOL_Y) {
+			mt->current.values[MT_A_AXIS(e->code)] = e->value;
+			mt->current.has |= 1U << MT_A_AXIS(e->code);
+			return 0;
+		}
+		if (e->code == ABS_MT_SLOT)
+			return 0;
+		break;
+	case EV_SYN:
+		switch (e->code) {
+		case SYN_MT_REPORT:
+			/* a SYN_MT_REPORT without data is the "no
+			 * contacts" marker */
+			if (mt_a_has(&mt->current, ABS_MT_POSITION_X) &&
+			    mt_a_has(&mt->current, ABS_MT_POSITION_Y)) {
+				if (mt->ncontacts < EVDEV_MT_A_MAX_SLOTS)
+					mt->contacts[mt->ncontacts++] = mt->current;
+				else
+					mt->ndropped++;
+			}
+			mt->current.has = 0;
+			return 0;
+		case SYN_REPORT:
+			mt->current.has = 0;
+			if (mt->ndropped) {
+				evdev_log_info_ratelimit(mt->device,
+							 &mt->dropped_limit,
+							 "protocol A: %u contacts, ignoring all but the first %d\n",
+							 mt->ncontacts + mt->ndropped,
+							 EVDEV_MT_A_MAX_SLOTS);
+				mt->ndropped = 0;
+			}
+			return mt_a_flush(mt, e, out);
+		default:
+			break;
+		}
+		break;
+	default:
+		break;
+	}
+
+	*out = *e;
+
+	return 1;
+}
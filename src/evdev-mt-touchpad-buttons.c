@@ -146,15 +146,15 @@ is_inside_top_middle_area(const struct tp_dispatch *tp,
 static void
 tp_button_set_enter_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	libinput_timer_set(&t->button.timer,
-			   t->millis + DEFAULT_BUTTON_ENTER_TIMEOUT);
+	tp_touch_set_timeout(tp, t, TP_TOUCH_TIMEOUT_BUTTON,
+			     t->millis + DEFAULT_BUTTON_ENTER_TIMEOUT);
 }
 
 static void
 tp_button_set_leave_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	libinput_timer_set(&t->button.timer,
-			   t->millis + DEFAULT_BUTTON_LEAVE_TIMEOUT);
+	tp_touch_set_timeout(tp, t, TP_TOUCH_TIMEOUT_BUTTON,
+			     t->millis + DEFAULT_BUTTON_LEAVE_TIMEOUT);
 }
 
 /*
@@ -167,31 +167,31 @@ tp_button_set_state(struct tp_dispatch *tp,
 		    enum button_state new_state,
 		    enum button_event event)
 {
-	libinput_timer_cancel(&t->button.timer);
+	tp_touch_cancel_timeout(tp, t, TP_TOUCH_TIMEOUT_BUTTON);
 
-	t->button.state = new_state;
+	t->cold->button.state = new_state;
 
-	switch (t->button.state) {
+	switch (t->cold->button.state) {
 	case BUTTON_STATE_NONE:
-		t->button.curr = 0;
+		t->cold->button.curr = 0;
 		break;
 	case BUTTON_STATE_AREA:
-		t->button.curr = BUTTON_EVENT_IN_AREA;
+		t->cold->button.curr = BUTTON_EVENT_IN_AREA;
 		break;
 	case BUTTON_STATE_BOTTOM:
-		t->button.curr = event;
+		t->cold->button.curr = event;
 		break;
 	case BUTTON_STATE_TOP:
 		break;
 	case BUTTON_STATE_TOP_NEW:
-		t->button.curr = event;
+		t->cold->button.curr = event;
 		tp_button_set_enter_timer(tp, t);
 		break;
 	case BUTTON_STATE_TOP_TO_IGNORE:
 		tp_button_set_leave_timer(tp, t);
 		break;
 	case BUTTON_STATE_IGNORE:
-		t->button.curr = 0;
+		t->cold->button.curr = 0;
 		break;
 	}
 }
@@ -258,7 +258,7 @@ tp_button_bottom_handle_event(struct tp_dispatch *tp,
 	case BUTTON_EVENT_IN_BOTTOM_R:
 	case BUTTON_EVENT_IN_BOTTOM_M:
 	case BUTTON_EVENT_IN_BOTTOM_L:
-		if (event != t->button.curr)
+		if (event != t->cold->button.curr)
 			tp_button_set_state(tp,
 					    t,
 					    BUTTON_STATE_BOTTOM,
@@ -294,7 +294,7 @@ tp_button_top_handle_event(struct tp_dispatch *tp,
 	case BUTTON_EVENT_IN_TOP_R:
 	case BUTTON_EVENT_IN_TOP_M:
 	case BUTTON_EVENT_IN_TOP_L:
-		if (event != t->button.curr)
+		if (event != t->cold->button.curr)
 			tp_button_set_state(tp,
 					    t,
 					    BUTTON_STATE_TOP_NEW,
@@ -327,7 +327,7 @@ tp_button_top_new_handle_event(struct tp_dispatch *tp,
 	case BUTTON_EVENT_IN_TOP_R:
 	case BUTTON_EVENT_IN_TOP_M:
 	case BUTTON_EVENT_IN_TOP_L:
-		if (event != t->button.curr)
+		if (event != t->cold->button.curr)
 			tp_button_set_state(tp,
 					    t,
 					    BUTTON_STATE_TOP_NEW,
@@ -359,7 +359,7 @@ tp_button_top_to_ignore_handle_event(struct tp_dispatch *tp,
 	case BUTTON_EVENT_IN_TOP_R:
 	case BUTTON_EVENT_IN_TOP_M:
 	case BUTTON_EVENT_IN_TOP_L:
-		if (event == t->button.curr)
+		if (event == t->cold->button.curr)
 			tp_button_set_state(tp,
 					    t,
 					    BUTTON_STATE_TOP,
@@ -417,9 +417,9 @@ tp_button_handle_event(struct tp_dispatch *tp,
 		       enum button_event event,
 		       uint64_t time)
 {
-	enum button_state current = t->button.state;
+	enum button_state current = t->cold->button.state;
 
-	switch(t->button.state) {
+	switch(t->cold->button.state) {
 	case BUTTON_STATE_NONE:
 		tp_button_none_handle_event(tp, t, event);
 		break;
@@ -443,12 +443,12 @@ tp_button_handle_event(struct tp_dispatch *tp,
 		break;
 	}
 
-	if (current != t->button.state)
+	if (current != t->cold->button.state)
 		evdev_log_debug(tp->device,
 				"button state: from %s, event %s to %s\n",
 				button_state_to_str(current),
 				button_event_to_str(event),
-				button_state_to_str(t->button.state));
+				button_state_to_str(t->cold->button.state));
 }
 
 void
@@ -456,8 +456,8 @@ tp_button_handle_state(struct tp_dispatch *tp, uint64_t time)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE || t->state == TOUCH_HOVERING)
+	tp_for_each_touch_in_use(tp, t) {
+		if (t->state == TOUCH_HOVERING)
 			continue;
 
 		if (t->state == TOUCH_END) {
@@ -489,12 +489,12 @@ tp_button_handle_state(struct tp_dispatch *tp, uint64_t time)
 	}
 }
 
-static void
-tp_button_handle_timeout(uint64_t now, void *data)
+void
+tp_button_handle_timeout(struct tp_dispatch *tp,
+			 struct tp_touch *t,
+			 uint64_t now)
 {
-	struct tp_touch *t = data;
-
-	tp_button_handle_event(t->tp, t, BUTTON_EVENT_TIMEOUT, now);
+	tp_button_handle_event(tp, t, BUTTON_EVENT_TIMEOUT, now);
 }
 
 void
@@ -870,12 +870,8 @@ tp_init_buttons(struct tp_dispatch *tp,
 
 	tp_init_middlebutton_emulation(tp, device);
 
-	tp_for_each_touch(tp, t) {
-		t->button.state = BUTTON_STATE_NONE;
-		libinput_timer_init(&t->button.timer,
-				    tp_libinput_context(tp),
-				    tp_button_handle_timeout, t);
-	}
+	tp_for_each_touch(tp, t)
+		t->cold->button.state = BUTTON_STATE_NONE;
 }
 
 void
@@ -884,7 +880,7 @@ tp_remove_buttons(struct tp_dispatch *tp)
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t)
-		libinput_timer_cancel(&t->button.timer);
+		tp_touch_cancel_timeout(tp, t, TP_TOUCH_TIMEOUT_BUTTON);
 }
 
 static int
@@ -935,8 +931,8 @@ tp_clickfinger_within_distance(struct tp_dispatch *tp,
 	if (!t1 || !t2)
 		return 0;
 
-	if (t1->thumb.state == THUMB_STATE_YES ||
-	    t2->thumb.state == THUMB_STATE_YES)
+	if (t1->cold->thumb.state == THUMB_STATE_YES ||
+	    t2->cold->thumb.state == THUMB_STATE_YES)
 		return 0;
 
 	x = abs(t1->point.x - t2->point.x);
@@ -992,11 +988,11 @@ tp_clickfinger_set_button(struct tp_dispatch *tp)
 
 	/* two fingers down on the touchpad. Check for distance
 	 * between the fingers. */
-	tp_for_each_touch(tp, t) {
+	tp_for_each_touch_in_use(tp, t) {
 		if (t->state != TOUCH_BEGIN && t->state != TOUCH_UPDATE)
 			continue;
 
-		if (t->thumb.state == THUMB_STATE_YES)
+		if (t->cold->thumb.state == THUMB_STATE_YES)
 			continue;
 
 		if (!first)
@@ -1096,8 +1092,8 @@ tp_post_clickpadbutton_buttons(struct tp_dispatch *tp, uint64_t time)
 		struct tp_touch *t;
 		uint32_t area = 0;
 
-		tp_for_each_touch(tp, t) {
-			switch (t->button.curr) {
+		tp_for_each_touch_in_use(tp, t) {
+			switch (t->cold->button.curr) {
 			case BUTTON_EVENT_IN_AREA:
 				area |= AREA;
 				break;
@@ -1187,7 +1183,7 @@ bool
 tp_button_touch_active(const struct tp_dispatch *tp,
 		       const struct tp_touch *t)
 {
-	return t->button.state == BUTTON_STATE_AREA;
+	return t->cold->button.state == BUTTON_STATE_AREA;
 }
 
 bool
@@ -45,13 +45,18 @@ gesture_state_to_str(enum tp_gesture_state state)
 	return NULL;
 }
 
+/* Returns the delta of the active touches and sets velocity to the
+ * velocity of the same touches, in normalized units/us */
 static struct normalized_coords
-tp_get_touches_delta(struct tp_dispatch *tp, bool average)
+tp_get_touches_delta(struct tp_dispatch *tp,
+		     bool average,
+		     struct normalized_coords *velocity)
 {
 	struct tp_touch *t;
 	unsigned int i, nactive = 0;
 	struct normalized_coords normalized;
 	struct normalized_coords delta = {0.0, 0.0};
+	struct device_float_coords v = {0.0, 0.0};
 
 	for (i = 0; i < tp->num_slots; i++) {
 		t = &tp->touches[i];
@@ -66,28 +71,71 @@ tp_get_touches_delta(struct tp_dispatch *tp, bool average)
 
 			delta.x += normalized.x;
 			delta.y += normalized.y;
+
+			v.x += tp_get_velocity(t).x;
+			v.y += tp_get_velocity(t).y;
 		}
 	}
 
-	if (!average || nactive == 0)
-		return delta;
+	if (average && nactive > 0) {
+		delta.x /= nactive;
+		delta.y /= nactive;
+		v.x /= nactive;
+		v.y /= nactive;
+	}
 
-	delta.x /= nactive;
-	delta.y /= nactive;
+	*velocity = tp_normalize_delta(tp, v);
 
 	return delta;
 }
 
 static inline struct normalized_coords
-tp_get_combined_touches_delta(struct tp_dispatch *tp)
+tp_get_combined_touches_delta(struct tp_dispatch *tp,
+			      struct normalized_coords *velocity)
 {
-	return tp_get_touches_delta(tp, false);
+	return tp_get_touches_delta(tp, false, velocity);
 }
 
 static inline struct normalized_coords
-tp_get_average_touches_delta(struct tp_dispatch *tp)
+tp_get_average_touches_delta(struct tp_dispatch *tp,
+			     struct normalized_coords *velocity)
 {
-	return tp_get_touches_delta(tp, true);
+	return tp_get_touches_delta(tp, true, velocity);
+}
+
+/* The acceleration of the touches tp_get_touches_delta() uses, in
+ * normalized units/us^2. Only needed for motion prediction, fitting the
+ * acceleration is more expensive than the velocity. */
+static struct normalized_coords
+tp_get_touches_acceleration(struct tp_dispatch *tp, bool average)
+{
+	struct tp_touch *t;
+	unsigned int i, nactive = 0;
+	struct device_float_coords a = {0.0, 0.0};
+
+	for (i = 0; i < tp->num_slots; i++) {
+		t = &tp->touches[i];
+
+		if (!tp_touch_active(tp, t))
+			continue;
+
+		nactive++;
+
+		if (t->dirty) {
+			struct device_float_coords acceleration;
+
+			acceleration = tp_get_acceleration(t);
+			a.x += acceleration.x;
+			a.y += acceleration.y;
+		}
+	}
+
+	if (average && nactive > 0) {
+		a.x /= nactive;
+		a.y /= nactive;
+	}
+
+	return tp_normalize_delta(tp, a);
 }
 
 static void
@@ -128,23 +176,34 @@ tp_gesture_start(struct tp_dispatch *tp, uint64_t time)
 static void
 tp_gesture_post_pointer_motion(struct tp_dispatch *tp, uint64_t time)
 {
-	struct normalized_coords delta, unaccel;
-	struct device_float_coords raw;
-
+	struct normalized_coords delta, unaccel, velocity;
+	struct normalized_coords acceleration = {0.0, 0.0};
+	struct device_float_coords raw, raw_velocity, raw_acceleration;
 	/* When a clickpad is clicked, combine motion of all active touches */
-	if (tp->buttons.is_clickpad && tp->buttons.state)
-		unaccel = tp_get_combined_touches_delta(tp);
+	bool combined = tp->buttons.is_clickpad && tp->buttons.state;
+
+	if (combined)
+		unaccel = tp_get_combined_touches_delta(tp, &velocity);
 	else
-		unaccel = tp_get_average_touches_delta(tp);
+		unaccel = tp_get_average_touches_delta(tp, &velocity);
 
-	delta = tp_filter_motion(tp, &unaccel, time);
+	delta = tp_filter_motion(tp, &unaccel, &velocity, time);
 
 	if (!normalized_is_zero(delta) || !normalized_is_zero(unaccel)) {
+		if (tp_libinput_context(tp)->prediction_horizon != 0)
+			acceleration = tp_get_touches_acceleration(tp,
+								   !combined);
+
+		/* the event wants everything in raw units */
 		raw = tp_unnormalize_for_xaxis(tp, unaccel);
+		raw_velocity = tp_unnormalize_for_xaxis(tp, velocity);
+		raw_acceleration = tp_unnormalize_for_xaxis(tp, acceleration);
 		pointer_notify_motion(&tp->device->base,
 				      time,
 				      &delta,
-				      &raw);
+				      &raw,
+				      &raw_velocity,
+				      &raw_acceleration);
 	}
 }
 
@@ -158,7 +217,7 @@ tp_gesture_get_active_touches(const struct tp_dispatch *tp,
 
 	memset(touches, 0, count * sizeof(struct tp_touch *));
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_touch_in_use(tp, t) {
 		if (tp_touch_active(tp, t)) {
 			touches[n++] = t;
 			if (n == count)
@@ -189,7 +248,7 @@ tp_gesture_get_direction(struct tp_dispatch *tp, struct tp_touch *touch,
 
 	move_threshold *= (nfingers - 1);
 
-	delta = device_delta(touch->point, touch->gesture.initial);
+	delta = device_delta(touch->point, touch->cold->gesture.initial);
 	mm = tp_phys_delta(tp, delta);
 
 	if (length_in_mm(mm) < move_threshold)
@@ -225,8 +284,8 @@ tp_gesture_set_scroll_buildup(struct tp_dispatch *tp)
 	struct tp_touch *first = tp->gesture.touches[0],
 			*second = tp->gesture.touches[1];
 
-	d0 = device_delta(first->point, first->gesture.initial);
-	d1 = device_delta(second->point, second->gesture.initial);
+	d0 = device_delta(first->point, first->cold->gesture.initial);
+	d1 = device_delta(second->point, second->cold->gesture.initial);
 
 	average = device_float_average(d0, d1);
 	tp->device->scroll.buildup = tp_normalize_delta(tp, average);
@@ -285,8 +344,8 @@ tp_gesture_handle_state_none(struct tp_dispatch *tp, uint64_t time)
 	}
 
 	tp->gesture.initial_time = time;
-	first->gesture.initial = first->point;
-	second->gesture.initial = second->point;
+	first->cold->gesture.initial = first->point;
+	second->cold->gesture.initial = second->point;
 	tp->gesture.touches[0] = first;
 	tp->gesture.touches[1] = second;
 
@@ -374,12 +433,12 @@ tp_gesture_handle_state_unknown(struct tp_dispatch *tp, uint64_t time)
 static enum tp_gesture_state
 tp_gesture_handle_state_scroll(struct tp_dispatch *tp, uint64_t time)
 {
-	struct normalized_coords delta;
+	struct normalized_coords delta, velocity;
 
 	if (tp->scroll.method != LIBINPUT_CONFIG_SCROLL_2FG)
 		return GESTURE_STATE_SCROLL;
 
-	delta = tp_get_average_touches_delta(tp);
+	delta = tp_get_average_touches_delta(tp, &velocity);
 
 	/* scroll is not accelerated */
 	delta = tp_filter_motion_unaccelerated(tp, &delta, time);
@@ -399,10 +458,10 @@ tp_gesture_handle_state_scroll(struct tp_dispatch *tp, uint64_t time)
 static enum tp_gesture_state
 tp_gesture_handle_state_swipe(struct tp_dispatch *tp, uint64_t time)
 {
-	struct normalized_coords delta, unaccel;
+	struct normalized_coords delta, unaccel, velocity;
 
-	unaccel = tp_get_average_touches_delta(tp);
-	delta = tp_filter_motion(tp, &unaccel, time);
+	unaccel = tp_get_average_touches_delta(tp, &velocity);
+	delta = tp_filter_motion(tp, &unaccel, &velocity, time);
 
 	if (!normalized_is_zero(delta) || !normalized_is_zero(unaccel)) {
 		tp_gesture_start(tp, time);
@@ -419,8 +478,8 @@ static enum tp_gesture_state
 tp_gesture_handle_state_pinch(struct tp_dispatch *tp, uint64_t time)
 {
 	double angle, angle_delta, distance, scale;
-	struct device_float_coords center, fdelta;
-	struct normalized_coords delta, unaccel;
+	struct device_float_coords center, fdelta, v;
+	struct normalized_coords delta, unaccel, velocity;
 
 	tp_gesture_get_pinch_info(tp, &distance, &angle, &center);
 
@@ -436,7 +495,10 @@ tp_gesture_handle_state_pinch(struct tp_dispatch *tp, uint64_t time)
 	fdelta = device_float_delta(center, tp->gesture.center);
 	tp->gesture.center = center;
 	unaccel = tp_normalize_delta(tp, fdelta);
-	delta = tp_filter_motion(tp, &unaccel, time);
+	v = device_float_average(tp_get_velocity(tp->gesture.touches[0]),
+				 tp_get_velocity(tp->gesture.touches[1]));
+	velocity = tp_normalize_delta(tp, v);
+	delta = tp_filter_motion(tp, &unaccel, &velocity, time);
 
 	if (normalized_is_zero(delta) && normalized_is_zero(unaccel) &&
 	    scale == tp->gesture.prev_scale && angle_delta == 0.0)
@@ -593,7 +655,7 @@ tp_gesture_handle_state(struct tp_dispatch *tp, uint64_t time)
 	unsigned int active_touches = 0;
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_touch_in_use(tp, t) {
 		if (tp_touch_active(tp, t))
 			active_touches++;
 	}
@@ -632,6 +694,8 @@ tp_init_gesture(struct tp_dispatch *tp)
 	libinput_timer_init(&tp->gesture.finger_count_switch_timer,
 			    tp_libinput_context(tp),
 			    tp_gesture_finger_count_switch_timeout, tp);
+	libinput_timer_set_slack(&tp->gesture.finger_count_switch_timer,
+				 TIMER_SLACK_DEFAULT);
 }
 
 void
@@ -212,8 +212,8 @@ tp_tap_touch_handle_event(struct tp_dispatch *tp,
 		break;
 	case TAP_EVENT_THUMB:
 		tp->tap.state = TAP_STATE_IDLE;
-		t->tap.is_thumb = true;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
+		t->cold->tap.is_thumb = true;
+		t->cold->tap.state = TAP_TOUCH_STATE_DEAD;
 		tp_tap_clear_timer(tp);
 		break;
 	}
@@ -242,8 +242,8 @@ tp_tap_hold_handle_event(struct tp_dispatch *tp,
 		break;
 	case TAP_EVENT_THUMB:
 		tp->tap.state = TAP_STATE_IDLE;
-		t->tap.is_thumb = true;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
+		t->cold->tap.is_thumb = true;
+		t->cold->tap.state = TAP_TOUCH_STATE_DEAD;
 		break;
 	}
 }
@@ -350,7 +350,7 @@ tp_tap_touch2_release_handle_event(struct tp_dispatch *tp,
 	switch (event) {
 	case TAP_EVENT_TOUCH:
 		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
+		t->cold->tap.state = TAP_TOUCH_STATE_DEAD;
 		tp_tap_clear_timer(tp);
 		break;
 	case TAP_EVENT_RELEASE:
@@ -394,7 +394,7 @@ tp_tap_touch3_handle_event(struct tp_dispatch *tp,
 		break;
 	case TAP_EVENT_RELEASE:
 		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		if (t->tap.state == TAP_TOUCH_STATE_TOUCH) {
+		if (t->cold->tap.state == TAP_TOUCH_STATE_TOUCH) {
 			tp_tap_notify(tp,
 				      tp->tap.saved_press_time,
 				      3,
@@ -766,7 +766,7 @@ tp_tap_exceeds_motion_threshold(struct tp_dispatch *tp,
 				struct tp_touch *t)
 {
 	struct phys_coords mm =
-		tp_phys_delta(tp, device_delta(t->point, t->tap.initial));
+		tp_phys_delta(tp, device_delta(t->point, t->cold->tap.initial));
 
 	return length_in_mm(mm) > DEFAULT_TAP_MOVE_THRESHOLD;
 }
@@ -792,17 +792,17 @@ tp_tap_handle_state(struct tp_dispatch *tp, uint64_t time)
 	if (tp->buttons.is_clickpad && tp->queued & TOUCHPAD_EVENT_BUTTON_PRESS)
 		tp_tap_handle_event(tp, NULL, TAP_EVENT_BUTTON, time);
 
-	tp_for_each_touch(tp, t) {
-		if (!t->dirty || t->state == TOUCH_NONE)
+	tp_for_each_dirty_touch(tp, t) {
+		if (t->state == TOUCH_NONE)
 			continue;
 
 		if (tp->buttons.is_clickpad &&
 		    tp->queued & TOUCHPAD_EVENT_BUTTON_PRESS)
-			t->tap.state = TAP_TOUCH_STATE_DEAD;
+			t->cold->tap.state = TAP_TOUCH_STATE_DEAD;
 
 		/* If a touch was considered thumb for tapping once, we
 		 * ignore it for the rest of lifetime */
-		if (t->tap.is_thumb)
+		if (t->cold->tap.is_thumb)
 			continue;
 
 		if (t->state == TOUCH_HOVERING)
@@ -812,13 +812,13 @@ tp_tap_handle_state(struct tp_dispatch *tp, uint64_t time)
 			/* The simple version: if a touch is a thumb on
 			 * begin we ignore it. All other thumb touches
 			 * follow the normal tap state for now */
-			if (t->thumb.state == THUMB_STATE_YES) {
-				t->tap.is_thumb = true;
+			if (t->cold->thumb.state == THUMB_STATE_YES) {
+				t->cold->tap.is_thumb = true;
 				continue;
 			}
 
-			t->tap.state = TAP_TOUCH_STATE_TOUCH;
-			t->tap.initial = t->point;
+			t->cold->tap.state = TAP_TOUCH_STATE_TOUCH;
+			t->cold->tap.initial = t->point;
 			tp_tap_handle_event(tp, t, TAP_EVENT_TOUCH, time);
 
 			/* If we think this is a palm, pretend there's a
@@ -831,22 +831,22 @@ tp_tap_handle_state(struct tp_dispatch *tp, uint64_t time)
 		} else if (t->state == TOUCH_END) {
 			if (t->was_down)
 				tp_tap_handle_event(tp, t, TAP_EVENT_RELEASE, time);
-			t->tap.state = TAP_TOUCH_STATE_IDLE;
+			t->cold->tap.state = TAP_TOUCH_STATE_IDLE;
 		} else if (tp->tap.state != TAP_STATE_IDLE &&
 			   tp_tap_exceeds_motion_threshold(tp, t)) {
 			struct tp_touch *tmp;
 
 			/* Any touch exceeding the threshold turns all
 			 * touches into DEAD */
-			tp_for_each_touch(tp, tmp) {
-				if (tmp->tap.state == TAP_TOUCH_STATE_TOUCH)
-					tmp->tap.state = TAP_TOUCH_STATE_DEAD;
+			tp_for_each_touch_in_use(tp, tmp) {
+				if (tmp->cold->tap.state == TAP_TOUCH_STATE_TOUCH)
+					tmp->cold->tap.state = TAP_TOUCH_STATE_DEAD;
 			}
 
 			tp_tap_handle_event(tp, t, TAP_EVENT_MOTION, time);
 		} else if (tp->tap.state != TAP_STATE_IDLE &&
-			   t->thumb.state == THUMB_STATE_YES &&
-			   !t->tap.is_thumb) {
+			   t->cold->thumb.state == THUMB_STATE_YES &&
+			   !t->cold->tap.is_thumb) {
 			tp_tap_handle_event(tp, t, TAP_EVENT_THUMB, time);
 		}
 	}
@@ -900,12 +900,11 @@ tp_tap_handle_timeout(uint64_t time, void *data)
 
 	tp_tap_handle_event(tp, NULL, TAP_EVENT_TIMEOUT, time);
 
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE ||
-		    t->tap.state == TAP_TOUCH_STATE_IDLE)
+	tp_for_each_touch_in_use(tp, t) {
+		if (t->cold->tap.state == TAP_TOUCH_STATE_IDLE)
 			continue;
 
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
+		t->cold->tap.state = TAP_TOUCH_STATE_DEAD;
 	}
 }
 
@@ -1119,6 +1118,7 @@ tp_init_tap(struct tp_dispatch *tp)
 	libinput_timer_init(&tp->tap.timer,
 			    tp_libinput_context(tp),
 			    tp_tap_handle_timeout, tp);
+	libinput_timer_set_slack(&tp->tap.timer, TIMER_SLACK_DEFAULT);
 }
 
 void
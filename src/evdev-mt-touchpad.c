@@ -36,22 +36,29 @@
 #define THUMB_MOVE_TIMEOUT ms2us(300)
 #define FAKE_FINGER_OVERFLOW (1 << 7)
 
-static inline struct device_coords *
-tp_motion_history_offset(struct tp_touch *t, int offset)
+static inline struct tp_history_point *
+tp_motion_history_sample(struct tp_touch *t, unsigned int offset)
 {
-	int offset_index =
-		(t->history.index - offset + TOUCHPAD_HISTORY_LENGTH) %
-		TOUCHPAD_HISTORY_LENGTH;
+	struct tp_motion_history *h = &t->history;
+	unsigned int offset_index = (h->index + h->length - offset) %
+				    h->length;
+
+	return &h->samples[offset_index];
+}
 
-	return &t->history.samples[offset_index];
+static inline struct device_coords *
+tp_motion_history_offset(struct tp_touch *t, unsigned int offset)
+{
+	return &tp_motion_history_sample(t, offset)->point;
 }
 
 struct normalized_coords
 tp_filter_motion(struct tp_dispatch *tp,
 		 const struct normalized_coords *unaccelerated,
+		 const struct normalized_coords *velocity,
 		 uint64_t time)
 {
-	struct device_float_coords raw;
+	struct device_float_coords raw, raw_velocity;
 
 	if (normalized_is_zero(*unaccelerated))
 		return *unaccelerated;
@@ -60,8 +67,21 @@ tp_filter_motion(struct tp_dispatch *tp,
 	 * make sure we're on the same resolution for both axes */
 	raw = tp_unnormalize_for_xaxis(tp, *unaccelerated);
 
-	return filter_dispatch(tp->device->pointer.filter,
-			       &raw, tp, time);
+	/* The history has no velocity yet after a reset, e.g. when the
+	 * finger count changes. The trackers do. */
+	if (!tp->history_velocity || normalized_is_zero(*velocity))
+		return filter_dispatch(tp->device->pointer.filter,
+				       &raw,
+				       tp,
+				       time);
+
+	raw_velocity = tp_unnormalize_for_xaxis(tp, *velocity);
+
+	return filter_dispatch_velocity(tp->device->pointer.filter,
+					&raw,
+					hypot(raw_velocity.x, raw_velocity.y),
+					tp,
+					time);
 }
 
 struct normalized_coords
@@ -83,15 +103,89 @@ tp_filter_motion_unaccelerated(struct tp_dispatch *tp,
 }
 
 static inline void
-tp_motion_history_push(struct tp_touch *t)
+tp_motion_history_add_sample(struct tp_motion_history *h,
+			     const struct tp_history_point *p,
+			     double weight)
+{
+	double t = (int64_t)(p->time - h->origin) / 1000.0; /* ms */
+	double tk = weight;
+	int k;
+
+	for (k = 0; k < 5; k++) {
+		h->st[k] += tk;
+		if (k < 3) {
+			h->sx[k] += tk * p->point.x;
+			h->sy[k] += tk * p->point.y;
+		}
+		tk *= t;
+	}
+}
+
+/* Rebuild the sums from the samples, relative to the oldest one.
+ * Removing samples from the sums accumulates rounding errors and the
+ * powers of t lose precision as t grows, rebuilding every length
+ * pushes keeps both in check at an amortized O(1). */
+static void
+tp_motion_history_rebuild(struct tp_motion_history *h)
+{
+	unsigned int i, oldest;
+
+	oldest = (h->index + h->length + 1 - h->count) % h->length;
+	h->origin = h->samples[oldest].time;
+	h->pushes = 0;
+
+	memset(h->st, 0, sizeof(h->st));
+	memset(h->sx, 0, sizeof(h->sx));
+	memset(h->sy, 0, sizeof(h->sy));
+
+	for (i = 0; i < h->count; i++)
+		tp_motion_history_add_sample(h,
+					     &h->samples[(oldest + i) % h->length],
+					     1.0);
+}
+
+/* The slope of the least-squares line through the samples, in
+ * units/us */
+static struct device_float_coords
+tp_motion_history_fit_velocity(const struct tp_motion_history *h)
+{
+	struct device_float_coords v = { 0.0, 0.0 };
+	double n = h->st[0],
+	       d = h->st[0] * h->st[2] - h->st[1] * h->st[1];
+
+	/* less than two distinct timestamps */
+	if (h->count < 2 || d < 1e-6)
+		return v;
+
+	v.x = (n * h->sx[1] - h->st[1] * h->sx[0]) / d / 1000.0;
+	v.y = (n * h->sy[1] - h->st[1] * h->sy[0]) / d / 1000.0;
+
+	return v;
+}
+
+static inline void
+tp_motion_history_push(struct tp_touch *t, uint64_t time)
 {
-	int motion_index = (t->history.index + 1) % TOUCHPAD_HISTORY_LENGTH;
+	struct tp_motion_history *h = &t->history;
+	unsigned int motion_index = (h->index + 1) % h->length;
+	struct tp_history_point *p = &h->samples[motion_index];
+
+	/* Overwriting the oldest sample */
+	if (h->count == h->length)
+		tp_motion_history_add_sample(h, p, -1.0);
+	else
+		h->count++;
+
+	p->time = time;
+	p->point = t->point;
+	h->index = motion_index;
 
-	if (t->history.count < TOUCHPAD_HISTORY_LENGTH)
-		t->history.count++;
+	if (h->count == 1 || ++h->pushes >= h->length)
+		tp_motion_history_rebuild(h);
+	else
+		tp_motion_history_add_sample(h, p, 1.0);
 
-	t->history.samples[motion_index] = t->point;
-	t->history.index = motion_index;
+	h->velocity = tp_motion_history_fit_velocity(h);
 }
 
 static inline void
@@ -102,16 +196,16 @@ tp_motion_hysteresis(struct tp_dispatch *tp,
 	    y = t->point.y;
 
 	if (t->history.count == 0) {
-		t->hysteresis_center = t->point;
+		t->cold->hysteresis_center = t->point;
 	} else {
 		x = evdev_hysteresis(x,
-				     t->hysteresis_center.x,
+				     t->cold->hysteresis_center.x,
 				     tp->hysteresis_margin.x);
 		y = evdev_hysteresis(y,
-				     t->hysteresis_center.y,
+				     t->cold->hysteresis_center.y,
 				     tp->hysteresis_margin.y);
-		t->hysteresis_center.x = x;
-		t->hysteresis_center.y = y;
+		t->cold->hysteresis_center.x = x;
+		t->cold->hysteresis_center.y = y;
 		t->point.x = x;
 		t->point.y = y;
 	}
@@ -121,6 +215,41 @@ static inline void
 tp_motion_history_reset(struct tp_touch *t)
 {
 	t->history.count = 0;
+	t->history.velocity.x = 0.0;
+	t->history.velocity.y = 0.0;
+}
+
+/* The second derivative of the least-squares parabola through the
+ * samples, in units/us^2 */
+struct device_float_coords
+tp_get_acceleration(const struct tp_touch *t)
+{
+	const struct tp_motion_history *h = &t->history;
+	struct device_float_coords a = { 0.0, 0.0 };
+	const double *s = h->st;
+	double det, cx, cy;
+
+	if (h->count < 3)
+		return a;
+
+	/* Cramer's rule for the t^2 coefficient of the normal equations */
+	det = s[0] * (s[2] * s[4] - s[3] * s[3]) -
+	      s[1] * (s[1] * s[4] - s[3] * s[2]) +
+	      s[2] * (s[1] * s[3] - s[2] * s[2]);
+	if (fabs(det) < 1e-6)
+		return a;
+
+	cx = s[0] * (s[2] * h->sx[2] - h->sx[1] * s[3]) -
+	     s[1] * (s[1] * h->sx[2] - h->sx[1] * s[2]) +
+	     h->sx[0] * (s[1] * s[3] - s[2] * s[2]);
+	cy = s[0] * (s[2] * h->sy[2] - h->sy[1] * s[3]) -
+	     s[1] * (s[1] * h->sy[2] - h->sy[1] * s[2]) +
+	     h->sy[0] * (s[1] * s[3] - s[2] * s[2]);
+
+	a.x = 2 * cx / det / 1e6;
+	a.y = 2 * cy / det / 1e6;
+
+	return a;
 }
 
 static inline struct tp_touch *
@@ -212,11 +341,12 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	 * don't know if it's a touch down or not. And BTN_TOUCH may happen
 	 * after ABS_MT_TRACKING_ID */
 	tp_motion_history_reset(t);
-	t->dirty = true;
+	tp_touch_set_dirty(t);
 	t->has_ended = false;
 	t->was_down = false;
 	t->state = TOUCH_HOVERING;
-	t->pinned.is_pinned = false;
+	tp->touches_in_use |= tp_touch_bit(t);
+	t->cold->pinned.is_pinned = false;
 	t->millis = time;
 	tp->queued |= TOUCHPAD_EVENT_MOTION;
 }
@@ -224,15 +354,15 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 static inline void
 tp_begin_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
-	t->dirty = true;
+	tp_touch_set_dirty(t);
 	t->state = TOUCH_BEGIN;
 	t->millis = time;
 	t->was_down = true;
 	tp->nfingers_down++;
-	t->palm.time = time;
-	t->thumb.state = THUMB_STATE_MAYBE;
-	t->thumb.first_touch_time = time;
-	t->tap.is_thumb = false;
+	t->cold->palm.time = time;
+	t->cold->thumb.state = THUMB_STATE_MAYBE;
+	t->cold->thumb.first_touch_time = time;
+	t->cold->tap.is_thumb = false;
 	assert(tp->nfingers_down >= 1);
 }
 
@@ -245,6 +375,7 @@ tp_end_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	switch (t->state) {
 	case TOUCH_HOVERING:
 		t->state = TOUCH_NONE;
+		tp->touches_in_use &= ~tp_touch_bit(t);
 		/* fallthough */
 	case TOUCH_NONE:
 	case TOUCH_END:
@@ -255,12 +386,12 @@ tp_end_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 
 	}
 
-	t->dirty = true;
-	t->palm.state = PALM_NONE;
+	tp_touch_set_dirty(t);
+	t->cold->palm.state = PALM_NONE;
 	t->state = TOUCH_END;
-	t->pinned.is_pinned = false;
+	t->cold->pinned.is_pinned = false;
 	t->millis = time;
-	t->palm.time = 0;
+	t->cold->palm.time = 0;
 	assert(tp->nfingers_down >= 1);
 	tp->nfingers_down--;
 	tp->queued |= TOUCHPAD_EVENT_MOTION;
@@ -303,11 +434,10 @@ tp_get_delta(struct tp_touch *t)
 
 static void
 tp_process_absolute(struct tp_dispatch *tp,
+		    struct tp_touch *t,
 		    const struct input_event *e,
 		    uint64_t time)
 {
-	struct tp_touch *t = tp_current_touch(tp);
-
 	switch(e->code) {
 	case ABS_MT_POSITION_X:
 		evdev_device_check_abs_axis_range(tp->device,
@@ -315,7 +445,7 @@ tp_process_absolute(struct tp_dispatch *tp,
 						  e->value);
 		t->point.x = e->value;
 		t->millis = time;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_MT_POSITION_Y:
@@ -324,7 +454,7 @@ tp_process_absolute(struct tp_dispatch *tp,
 						  e->value);
 		t->point.y = e->value;
 		t->millis = time;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_MT_SLOT:
@@ -338,12 +468,12 @@ tp_process_absolute(struct tp_dispatch *tp,
 		break;
 	case ABS_MT_PRESSURE:
 		t->pressure = e->value;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case ABS_MT_TOOL_TYPE:
 		t->is_tool_palm = e->value == MT_TOOL_PALM;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	}
@@ -363,7 +493,7 @@ tp_process_absolute_st(struct tp_dispatch *tp,
 						  e->value);
 		t->point.x = e->value;
 		t->millis = time;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_Y:
@@ -372,12 +502,12 @@ tp_process_absolute_st(struct tp_dispatch *tp,
 						  e->value);
 		t->point.y = e->value;
 		t->millis = time;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_PRESSURE:
 		t->pressure = e->value;
-		t->dirty = true;
+		tp_touch_set_dirty(t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	}
@@ -510,17 +640,17 @@ tp_unpin_finger(const struct tp_dispatch *tp, struct tp_touch *t)
 	struct phys_coords mm;
 	struct device_coords delta;
 
-	if (!t->pinned.is_pinned)
+	if (!t->cold->pinned.is_pinned)
 		return;
 
-	delta.x = abs(t->point.x - t->pinned.center.x);
-	delta.y = abs(t->point.y - t->pinned.center.y);
+	delta.x = abs(t->point.x - t->cold->pinned.center.x);
+	delta.y = abs(t->point.y - t->cold->pinned.center.y);
 
 	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
 
 	/* 1.5mm movement -> unpin */
 	if (hypot(mm.x, mm.y) >= 1.5) {
-		t->pinned.is_pinned = false;
+		t->cold->pinned.is_pinned = false;
 		return;
 	}
 }
@@ -530,9 +660,9 @@ tp_pin_fingers(struct tp_dispatch *tp)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
-		t->pinned.is_pinned = true;
-		t->pinned.center = t->point;
+	tp_for_each_touch_in_use(tp, t) {
+		t->cold->pinned.is_pinned = true;
+		t->cold->pinned.center = t->point;
 	}
 }
 
@@ -540,9 +670,9 @@ bool
 tp_touch_active(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
 	return (t->state == TOUCH_BEGIN || t->state == TOUCH_UPDATE) &&
-		t->palm.state == PALM_NONE &&
-		!t->pinned.is_pinned &&
-		t->thumb.state != THUMB_STATE_YES &&
+		t->cold->palm.state == PALM_NONE &&
+		!t->cold->pinned.is_pinned &&
+		t->cold->thumb.state != THUMB_STATE_YES &&
 		tp_button_touch_active(tp, t) &&
 		tp_edge_scroll_touch_active(tp, t);
 }
@@ -569,21 +699,21 @@ tp_palm_detect_dwt_triggered(struct tp_dispatch *tp,
 	if (tp->dwt.dwt_enabled &&
 	    tp->dwt.keyboard_active &&
 	    t->state == TOUCH_BEGIN) {
-		t->palm.state = PALM_TYPING;
-		t->palm.first = t->point;
+		t->cold->palm.state = PALM_TYPING;
+		t->cold->palm.first = t->point;
 		return true;
 	} else if (!tp->dwt.keyboard_active &&
 		   t->state == TOUCH_UPDATE &&
-		   t->palm.state == PALM_TYPING) {
+		   t->cold->palm.state == PALM_TYPING) {
 		/* If a touch has started before the first or after the last
 		   key press, release it on timeout. Benefit: a palm rested
 		   while typing on the touchpad will be ignored, but a touch
 		   started once we stop typing will be able to control the
 		   pointer (alas not tap, etc.).
 		   */
-		if (t->palm.time == 0 ||
-		    t->palm.time > tp->dwt.keyboard_last_press_time) {
-			t->palm.state = PALM_NONE;
+		if (t->cold->palm.time == 0 ||
+		    t->cold->palm.time > tp->dwt.keyboard_last_press_time) {
+			t->cold->palm.state = PALM_NONE;
 			evdev_log_debug(tp->device,
 					"palm: touch released, timeout after typing\n");
 		}
@@ -600,18 +730,18 @@ tp_palm_detect_trackpoint_triggered(struct tp_dispatch *tp,
 	if (!tp->palm.monitor_trackpoint)
 		return false;
 
-	if (t->palm.state == PALM_NONE &&
+	if (t->cold->palm.state == PALM_NONE &&
 	    t->state == TOUCH_BEGIN &&
 	    tp->palm.trackpoint_active) {
-		t->palm.state = PALM_TRACKPOINT;
+		t->cold->palm.state = PALM_TRACKPOINT;
 		return true;
-	} else if (t->palm.state == PALM_TRACKPOINT &&
+	} else if (t->cold->palm.state == PALM_TRACKPOINT &&
 		   t->state == TOUCH_UPDATE &&
 		   !tp->palm.trackpoint_active) {
 
-		if (t->palm.time == 0 ||
-		    t->palm.time > tp->palm.trackpoint_last_event_time) {
-			t->palm.state = PALM_NONE;
+		if (t->cold->palm.time == 0 ||
+		    t->cold->palm.time > tp->palm.trackpoint_last_event_time) {
+			t->cold->palm.state = PALM_NONE;
 			evdev_log_debug(tp->device,
 				       "palm: touch released, timeout after trackpoint\n");
 		}
@@ -628,21 +758,21 @@ tp_palm_detect_tool_triggered(struct tp_dispatch *tp,
 	if (!tp->palm.use_mt_tool)
 		return false;
 
-	if (t->palm.state != PALM_NONE &&
-	    t->palm.state != PALM_TOOL_PALM)
+	if (t->cold->palm.state != PALM_NONE &&
+	    t->cold->palm.state != PALM_TOOL_PALM)
 		return false;
 
-	if (t->palm.state == PALM_NONE &&
+	if (t->cold->palm.state == PALM_NONE &&
 	    t->is_tool_palm)
-		t->palm.state = PALM_TOOL_PALM;
-	else if (t->palm.state == PALM_TOOL_PALM &&
+		t->cold->palm.state = PALM_TOOL_PALM;
+	else if (t->cold->palm.state == PALM_TOOL_PALM &&
 		 !t->is_tool_palm)
-		t->palm.state = PALM_NONE;
+		t->cold->palm.state = PALM_NONE;
 
-	if (t->palm.state == PALM_TOOL_PALM)
+	if (t->cold->palm.state == PALM_TOOL_PALM)
 		tp_stop_actions(tp, time);
 
-	return t->palm.state == PALM_TOOL_PALM;
+	return t->cold->palm.state == PALM_TOOL_PALM;
 }
 
 static inline bool
@@ -655,9 +785,9 @@ tp_palm_detect_move_out_of_edge(struct tp_dispatch *tp,
 	struct device_float_coords delta;
 	int dirs;
 
-	if (time < t->palm.time + PALM_TIMEOUT &&
+	if (time < t->cold->palm.time + PALM_TIMEOUT &&
 	    (t->point.x > tp->palm.left_edge && t->point.x < tp->palm.right_edge)) {
-		delta = device_delta(t->point, t->palm.first);
+		delta = device_delta(t->point, t->cold->palm.first);
 		dirs = phys_get_direction(tp_phys_delta(tp, delta));
 		if ((dirs & DIRECTIONS) && !(dirs & ~DIRECTIONS))
 			return true;
@@ -682,12 +812,12 @@ tp_palm_detect_multifinger(struct tp_dispatch *tp, struct tp_touch *t, uint64_t
 	 * frame the second touch will still be PALM_NONE and thus detected
 	 * here as non-palm touch. This is too niche to worry about for now.
 	 */
-	tp_for_each_touch(tp, other) {
+	tp_for_each_touch_in_use(tp, other) {
 		if (other == t)
 			continue;
 
 		if (tp_touch_active(tp, other) &&
-		    other->palm.state == PALM_NONE) {
+		    other->cold->palm.state == PALM_NONE) {
 			return true;
 		}
 	}
@@ -700,9 +830,9 @@ tp_palm_detect_edge(struct tp_dispatch *tp,
 		    struct tp_touch *t,
 		    uint64_t time)
 {
-	if (t->palm.state == PALM_EDGE) {
+	if (t->cold->palm.state == PALM_EDGE) {
 		if (tp_palm_detect_multifinger(tp, t, time)) {
-			t->palm.state = PALM_NONE;
+			t->cold->palm.state = PALM_NONE;
 			evdev_log_debug(tp->device,
 				  "palm: touch released, multiple fingers\n");
 
@@ -711,7 +841,7 @@ tp_palm_detect_edge(struct tp_dispatch *tp,
 		   the direction is within 45 degrees of the horizontal.
 		 */
 		} else if (tp_palm_detect_move_out_of_edge(tp, t, time)) {
-			t->palm.state = PALM_NONE;
+			t->cold->palm.state = PALM_NONE;
 			evdev_log_debug(tp->device,
 				  "palm: touch released, out of edge zone\n");
 		}
@@ -736,9 +866,9 @@ tp_palm_detect_edge(struct tp_dispatch *tp,
 	if (tp_touch_get_edge(tp, t) & EDGE_RIGHT)
 		return false;
 
-	t->palm.state = PALM_EDGE;
-	t->palm.time = time;
-	t->palm.first = t->point;
+	t->cold->palm.state = PALM_EDGE;
+	t->cold->palm.time = time;
+	t->cold->palm.first = t->point;
 
 	return true;
 }
@@ -747,7 +877,7 @@ static void
 tp_palm_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
 	const char *palm_state;
-	enum touch_palm_state oldstate = t->palm.state;
+	enum touch_palm_state oldstate = t->cold->palm.state;
 
 	if (tp_palm_detect_dwt_triggered(tp, t, time))
 		goto out;
@@ -763,10 +893,10 @@ tp_palm_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 
 	return;
 out:
-	if (oldstate == t->palm.state)
+	if (oldstate == t->cold->palm.state)
 		return;
 
-	switch (t->palm.state) {
+	switch (t->cold->palm.state) {
 	case PALM_EDGE:
 		palm_state = "edge";
 		break;
@@ -804,31 +934,31 @@ thumb_state_to_str(enum tp_thumb_state state)
 static void
 tp_thumb_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
-	enum tp_thumb_state state = t->thumb.state;
+	enum tp_thumb_state state = t->cold->thumb.state;
 
 	/* once a thumb, always a thumb, once ruled out always ruled out */
 	if (!tp->thumb.detect_thumbs ||
-	    t->thumb.state != THUMB_STATE_MAYBE)
+	    t->cold->thumb.state != THUMB_STATE_MAYBE)
 		return;
 
 	if (t->point.y < tp->thumb.upper_thumb_line) {
 		/* if a potential thumb is above the line, it won't ever
 		 * label as thumb */
-		t->thumb.state = THUMB_STATE_NO;
+		t->cold->thumb.state = THUMB_STATE_NO;
 		goto out;
 	}
 
 	/* If the thumb moves by more than 7mm, it's not a resting thumb */
 	if (t->state == TOUCH_BEGIN)
-		t->thumb.initial = t->point;
+		t->cold->thumb.initial = t->point;
 	else if (t->state == TOUCH_UPDATE) {
 		struct device_float_coords delta;
 		struct phys_coords mm;
 
-		delta = device_delta(t->point, t->thumb.initial);
+		delta = device_delta(t->point, t->cold->thumb.initial);
 		mm = tp_phys_delta(tp, delta);
 		if (length_in_mm(mm) > 7) {
-			t->thumb.state = THUMB_STATE_NO;
+			t->cold->thumb.state = THUMB_STATE_NO;
 			goto out;
 		}
 	}
@@ -840,11 +970,11 @@ tp_thumb_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	 * a thumb.
 	 */
 	if (t->pressure > tp->thumb.threshold)
-		t->thumb.state = THUMB_STATE_YES;
+		t->cold->thumb.state = THUMB_STATE_YES;
 	else if (t->point.y > tp->thumb.lower_thumb_line &&
 		 tp->scroll.method != LIBINPUT_CONFIG_SCROLL_EDGE &&
-		 t->thumb.first_touch_time + THUMB_MOVE_TIMEOUT < time)
-		t->thumb.state = THUMB_STATE_YES;
+		 t->cold->thumb.first_touch_time + THUMB_MOVE_TIMEOUT < time)
+		t->cold->thumb.state = THUMB_STATE_YES;
 
 	/* now what? we marked it as thumb, so:
 	 *
@@ -857,11 +987,11 @@ tp_thumb_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	 *   this gets a tad complicated otherwise
 	 */
 out:
-	if (t->thumb.state != state)
+	if (t->cold->thumb.state != state)
 		evdev_log_debug(tp->device,
 			  "thumb state: %s → %s\n",
 			  thumb_state_to_str(state),
-			  thumb_state_to_str(t->thumb.state));
+			  thumb_state_to_str(t->cold->thumb.state));
 }
 
 static void
@@ -913,7 +1043,7 @@ tp_unhover_pressure(struct tp_dispatch *tp, uint64_t time)
 	 * _all_ fingers have enough pressure, even if some of the slotted
 	 * ones don't. Anything else gets insane quickly.
 	 */
-	tp_for_each_touch(tp, t) {
+	tp_for_each_touch_in_use(tp, t) {
 		if (t->state == TOUCH_HOVERING) {
 			/* avoid jumps when landing a finger */
 			tp_motion_history_reset(t);
@@ -967,7 +1097,7 @@ tp_unhover_fake_touches(struct tp_dispatch *tp, uint64_t time)
 	 */
 	if (tp_fake_finger_is_touching(tp) &&
 	    tp->nfingers_down < nfake_touches) {
-		tp_for_each_touch(tp, t) {
+		tp_for_each_touch_in_use(tp, t) {
 			if (t->state == TOUCH_HOVERING) {
 				tp_begin_touch(tp, t, time);
 
@@ -1048,8 +1178,8 @@ tp_position_fake_touches(struct tp_dispatch *tp)
 
 		t->point = topmost->point;
 		t->pressure = topmost->pressure;
-		if (!t->dirty)
-			t->dirty = topmost->dirty;
+		if (!t->dirty && topmost->dirty)
+			tp_touch_set_dirty(t);
 	}
 }
 
@@ -1096,10 +1226,15 @@ tp_need_motion_history_reset(struct tp_dispatch *tp)
 }
 
 static bool
-tp_detect_jumps(const struct tp_dispatch *tp, struct tp_touch *t)
+tp_detect_jumps(const struct tp_dispatch *tp,
+		struct tp_touch *t,
+		uint64_t time)
 {
-	struct device_coords *last, delta;
+	struct tp_history_point *last;
+	struct device_coords delta;
+	struct device_float_coords predicted;
 	struct phys_coords mm;
+	double dt;
 	const int JUMP_THRESHOLD_MM = 20;
 
 	/* We haven't seen pointer jumps on Wacom tablets yet, so exclude
@@ -1113,9 +1248,20 @@ tp_detect_jumps(const struct tp_dispatch *tp, struct tp_touch *t)
 
 	/* called before tp_motion_history_push, so offset 0 is the most
 	 * recent coordinate */
-	last = tp_motion_history_offset(t, 0);
-	delta.x = abs(t->point.x - last->x);
-	delta.y = abs(t->point.y - last->y);
+	last = tp_motion_history_sample(t, 0);
+	delta.x = abs(t->point.x - last->point.x);
+	delta.y = abs(t->point.y - last->point.y);
+	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
+	if (hypot(mm.x, mm.y) <= JUMP_THRESHOLD_MM)
+		return false;
+
+	/* A fast swipe can cover the distance too, it's only a jump if
+	 * the touch is that far from where its velocity would put it */
+	dt = (int64_t)(time - last->time);
+	predicted.x = last->point.x + t->history.velocity.x * dt;
+	predicted.y = last->point.y + t->history.velocity.y * dt;
+	delta.x = fabs(t->point.x - predicted.x);
+	delta.y = fabs(t->point.y - predicted.y);
 	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
 
 	return hypot(mm.x, mm.y) > JUMP_THRESHOLD_MM;
@@ -1134,19 +1280,19 @@ tp_process_state(struct tp_dispatch *tp, uint64_t time)
 
 	want_motion_reset = tp_need_motion_history_reset(tp);
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_touch_in_use(tp, t) {
 		if (want_motion_reset) {
 			tp_motion_history_reset(t);
-			t->quirks.reset_motion_history = true;
-		} else if (t->quirks.reset_motion_history) {
+			t->cold->quirks.reset_motion_history = true;
+		} else if (t->cold->quirks.reset_motion_history) {
 			tp_motion_history_reset(t);
-			t->quirks.reset_motion_history = false;
+			t->cold->quirks.reset_motion_history = false;
 		}
 
 		if (!t->dirty)
 			continue;
 
-		if (tp_detect_jumps(tp, t)) {
+		if (tp_detect_jumps(tp, t, time)) {
 			if (!tp->semi_mt)
 				evdev_log_bug_kernel(tp->device,
 					       "Touch jump detected and discarded.\n"
@@ -1159,7 +1305,7 @@ tp_process_state(struct tp_dispatch *tp, uint64_t time)
 		tp_palm_detect(tp, t, time);
 
 		tp_motion_hysteresis(tp, t);
-		tp_motion_history_push(t);
+		tp_motion_history_push(t, time);
 
 		tp_unpin_finger(tp, t);
 
@@ -1191,22 +1337,21 @@ tp_post_process_state(struct tp_dispatch *tp, uint64_t time)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
-
-		if (!t->dirty)
-			continue;
-
+	tp_for_each_dirty_touch(tp, t) {
 		if (t->state == TOUCH_END) {
-			if (t->has_ended)
+			if (t->has_ended) {
 				t->state = TOUCH_NONE;
-			else
+				tp->touches_in_use &= ~tp_touch_bit(t);
+			} else {
 				t->state = TOUCH_HOVERING;
+			}
 		} else if (t->state == TOUCH_BEGIN) {
 			t->state = TOUCH_UPDATE;
 		}
 
 		t->dirty = false;
 	}
+	tp->touches_dirty = 0;
 
 	tp->old_nfingers_down = tp->nfingers_down;
 	tp->buttons.old_state = tp->buttons.state;
@@ -1277,21 +1422,18 @@ tp_debug_touch_state(struct tp_dispatch *tp,
 	evdev_log_debug(device, "touch state: %s\n", buf);
 }
 
-static void
-tp_interface_process(struct evdev_dispatch *dispatch,
-		     struct evdev_device *device,
-		     struct input_event *e,
-		     uint64_t time)
+/* t is the current touch, only used on MT devices */
+static inline void
+tp_process_event(struct tp_dispatch *tp,
+		 struct evdev_device *device,
+		 struct tp_touch *t,
+		 struct input_event *e,
+		 uint64_t time)
 {
-	struct tp_dispatch *tp = tp_dispatch(dispatch);
-
-	if (tp->ignore_events)
-		return;
-
 	switch (e->type) {
 	case EV_ABS:
 		if (tp->has_mt)
-			tp_process_absolute(tp, e, time);
+			tp_process_absolute(tp, t, e, time);
 		else
 			tp_process_absolute_st(tp, e, time);
 		break;
@@ -1307,6 +1449,189 @@ tp_interface_process(struct evdev_dispatch *dispatch,
 	}
 }
 
+static void
+tp_interface_process(struct evdev_dispatch *dispatch,
+		     struct evdev_device *device,
+		     struct input_event *e,
+		     uint64_t time)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+
+	if (tp->ignore_events)
+		return;
+
+	tp_process_event(tp, device, tp_current_touch(tp), e, time);
+}
+
+static void
+tp_interface_process_frame(struct evdev_dispatch *dispatch,
+			   struct evdev_device *device,
+			   struct input_event *events,
+			   size_t nevents)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+	struct tp_touch *t;
+	size_t i;
+
+	if (tp->ignore_events)
+		return;
+
+	/* the current touch only changes with ABS_MT_SLOT, no need to
+	 * look it up for every ABS_MT_* event */
+	t = tp_current_touch(tp);
+
+	for (i = 0; i < nevents; i++) {
+		struct input_event *e = &events[i];
+
+		tp_process_event(tp, device, t, e, tv2us(&e->time));
+		if (e->type == EV_ABS && e->code == ABS_MT_SLOT)
+			t = tp_current_touch(tp);
+	}
+}
+
+/* Set the timer to the earliest pending timeout or cancel it if there is
+ * none */
+static void
+tp_update_touch_timeouts(struct tp_dispatch *tp)
+{
+	uint64_t next = 0;
+	struct tp_touch *t;
+	unsigned int i;
+
+	tp_for_each_touch(tp, t) {
+		const uint64_t *timeouts = t->cold->timeouts;
+
+		for (i = 0; i < TP_TOUCH_TIMEOUT_COUNT; i++) {
+			if (timeouts[i] && (!next || timeouts[i] < next))
+				next = timeouts[i];
+		}
+	}
+
+	if (next == tp->touch_timeouts.expire)
+		return;
+
+	tp->touch_timeouts.expire = next;
+	if (next)
+		libinput_timer_set(&tp->touch_timeouts.timer, next);
+	else
+		libinput_timer_cancel(&tp->touch_timeouts.timer);
+}
+
+void
+tp_touch_set_timeout(struct tp_dispatch *tp,
+		     struct tp_touch *t,
+		     enum tp_touch_timeout which,
+		     uint64_t expire)
+{
+	uint64_t old = t->cold->timeouts[which];
+
+	t->cold->timeouts[which] = expire;
+
+	if (!tp->touch_timeouts.expire || expire < tp->touch_timeouts.expire) {
+		tp->touch_timeouts.expire = expire;
+		libinput_timer_set(&tp->touch_timeouts.timer, expire);
+	} else if (old == tp->touch_timeouts.expire) {
+		/* the timer was set for the timeout we just moved */
+		tp_update_touch_timeouts(tp);
+	}
+}
+
+void
+tp_touch_cancel_timeout(struct tp_dispatch *tp,
+			struct tp_touch *t,
+			enum tp_touch_timeout which)
+{
+	uint64_t old = t->cold->timeouts[which];
+
+	t->cold->timeouts[which] = 0;
+
+	if (old && old == tp->touch_timeouts.expire)
+		tp_update_touch_timeouts(tp);
+}
+
+static void
+tp_handle_touch_timeouts(uint64_t now, void *data)
+{
+	struct tp_dispatch *tp = data;
+	uint64_t due[TP_TOUCH_TIMEOUT_COUNT] = { 0 };
+	struct tp_touch *t;
+	unsigned int i;
+
+	tp->touch_timeouts.expire = 0;
+
+	/* Collect the due timeouts first, like the timer code does. A
+	 * timeout set by a handler runs on the next call, even if it's
+	 * already in the past */
+	tp_for_each_touch(tp, t) {
+		const uint64_t *timeouts = t->cold->timeouts;
+
+		for (i = 0; i < TP_TOUCH_TIMEOUT_COUNT; i++) {
+			if (timeouts[i] && timeouts[i] <= now)
+				due[i] |= tp_touch_bit(t);
+		}
+	}
+
+	/* Earliest first. A handler may set or cancel any timeout,
+	 * including other due ones. */
+	while (true) {
+		struct tp_touch *first = NULL;
+		enum tp_touch_timeout which = TP_TOUCH_TIMEOUT_BUTTON;
+
+		for (i = 0; i < TP_TOUCH_TIMEOUT_COUNT; i++) {
+			tp_for_each_touch_in_mask(tp, t, due[i]) {
+				uint64_t timeout = t->cold->timeouts[i];
+
+				if (timeout == 0 || timeout > now) {
+					due[i] &= ~tp_touch_bit(t);
+					continue;
+				}
+
+				if (!first ||
+				    timeout < first->cold->timeouts[which]) {
+					first = t;
+					which = i;
+				}
+			}
+		}
+
+		if (!first)
+			break;
+
+		due[which] &= ~tp_touch_bit(first);
+		first->cold->timeouts[which] = 0;
+
+		switch (which) {
+		case TP_TOUCH_TIMEOUT_BUTTON:
+			tp_button_handle_timeout(tp, first, now);
+			break;
+		case TP_TOUCH_TIMEOUT_SCROLL:
+			tp_edge_scroll_handle_timeout(tp, first, now);
+			break;
+		case TP_TOUCH_TIMEOUT_COUNT:
+			abort();
+		}
+	}
+
+	tp_update_touch_timeouts(tp);
+}
+
+static void
+tp_init_touch_timeouts(struct tp_dispatch *tp)
+{
+	libinput_timer_init(&tp->touch_timeouts.timer,
+			    tp_libinput_context(tp),
+			    tp_handle_touch_timeouts, tp);
+	libinput_timer_set_slack(&tp->touch_timeouts.timer,
+				 TIMER_SLACK_DEFAULT);
+}
+
+static void
+tp_remove_touch_timeouts(struct tp_dispatch *tp)
+{
+	libinput_timer_cancel(&tp->touch_timeouts.timer);
+	tp->touch_timeouts.expire = 0;
+}
+
 static void
 tp_remove_sendevents(struct tp_dispatch *tp)
 {
@@ -1337,6 +1662,7 @@ tp_interface_remove(struct evdev_dispatch *dispatch)
 	tp_remove_sendevents(tp);
 	tp_remove_edge_scroll(tp);
 	tp_remove_gesture(tp);
+	tp_remove_touch_timeouts(tp);
 }
 
 static void
@@ -1344,7 +1670,9 @@ tp_interface_destroy(struct evdev_dispatch *dispatch)
 {
 	struct tp_dispatch *tp = tp_dispatch(dispatch);
 
+	free(tp->history_samples);
 	free(tp->touches);
+	free(tp->touches_cold);
 	free(tp);
 }
 
@@ -1886,6 +2214,7 @@ static struct evdev_dispatch_interface tp_interface = {
 	tp_interface_device_added,   /* device_resumed, treat as add */
 	NULL,                        /* post_added */
 	tp_interface_toggle_touch,
+	tp_interface_process_frame,
 };
 
 static void
@@ -1893,6 +2222,7 @@ tp_init_touch(struct tp_dispatch *tp,
 	      struct tp_touch *t)
 {
 	t->tp = tp;
+	t->cold = &tp->touches_cold[t - tp->touches];
 	t->has_ended = true;
 }
 
@@ -1934,6 +2264,53 @@ tp_disable_abs_mt(struct evdev_device *device)
 		libevdev_disable_event_code(evdev, EV_ABS, code);
 }
 
+static bool
+tp_init_motion_history(struct tp_dispatch *tp,
+		       struct evdev_device *device)
+{
+	const char *prop;
+	int length = TOUCHPAD_HISTORY_LENGTH;
+	unsigned int i;
+
+	prop = udev_device_get_property_value(device->udev_device,
+					      "LIBINPUT_ATTR_TOUCHPAD_HISTORY_LENGTH");
+	if (prop) {
+		if (!safe_atoi(prop, &length) ||
+		    length < 2 ||
+		    length > TOUCHPAD_HISTORY_MAX_LENGTH) {
+			evdev_log_bug_client(device,
+					     "discarding invalid history length '%s'\n",
+					     prop);
+			length = TOUCHPAD_HISTORY_LENGTH;
+		}
+	}
+
+	prop = udev_device_get_property_value(device->udev_device,
+					      "LIBINPUT_ATTR_TOUCHPAD_HISTORY_VELOCITY");
+	if (prop) {
+		if (streq(prop, "1"))
+			tp->history_velocity = true;
+		else if (!streq(prop, "0"))
+			evdev_log_bug_client(device,
+					     "discarding invalid history velocity '%s'\n",
+					     prop);
+	}
+
+	tp->history_samples = calloc(tp->ntouches * length,
+				     sizeof(*tp->history_samples));
+	if (!tp->history_samples)
+		return false;
+
+	for (i = 0; i < tp->ntouches; i++) {
+		struct tp_motion_history *h = &tp->touches[i].history;
+
+		h->samples = &tp->history_samples[i * length];
+		h->length = length;
+	}
+
+	return true;
+}
+
 static bool
 tp_init_slots(struct tp_dispatch *tp,
 	      struct evdev_device *device)
@@ -2001,14 +2378,26 @@ tp_init_slots(struct tp_dispatch *tp,
 		}
 	}
 
+	if (tp->num_slots > TP_MAX_TOUCHES) {
+		evdev_log_info(device,
+			       "touchpad has %u slots, using only %d\n",
+			       tp->num_slots,
+			       TP_MAX_TOUCHES);
+		tp->num_slots = TP_MAX_TOUCHES;
+	}
+
 	tp->ntouches = max(tp->num_slots, n_btn_tool_touches);
 	tp->touches = calloc(tp->ntouches, sizeof(struct tp_touch));
-	if (!tp->touches)
+	tp->touches_cold = calloc(tp->ntouches, sizeof(struct tp_touch_cold));
+	if (!tp->touches || !tp->touches_cold)
 		return false;
 
 	for (i = 0; i < tp->ntouches; i++)
 		tp_init_touch(tp, &tp->touches[i]);
 
+	if (!tp_init_motion_history(tp, device))
+		return false;
+
 	/* Always sync the first touch so we get ABS_X/Y synced on
 	 * single-touch touchpads */
 	tp_sync_touch(tp, device, &tp->touches[0], 0);
@@ -2335,10 +2724,14 @@ tp_init_sendevents(struct tp_dispatch *tp,
 	libinput_timer_init(&tp->palm.trackpoint_timer,
 			    tp_libinput_context(tp),
 			    tp_trackpoint_timeout, tp);
+	libinput_timer_set_slack(&tp->palm.trackpoint_timer,
+				 TIMER_SLACK_DEFAULT);
 
 	libinput_timer_init(&tp->dwt.keyboard_timer,
 			    tp_libinput_context(tp),
 			    tp_keyboard_timeout, tp);
+	libinput_timer_set_slack(&tp->dwt.keyboard_timer,
+				 TIMER_SLACK_DEFAULT);
 }
 
 static void
@@ -2556,6 +2949,7 @@ tp_init(struct tp_dispatch *tp,
 	if (!tp_init_accel(tp))
 		return false;
 
+	tp_init_touch_timeouts(tp);
 	tp_init_tap(tp);
 	tp_init_buttons(tp, device);
 	tp_init_dwt(tp, device);
@@ -30,7 +30,8 @@
 #include "filter.h"
 #include "timer.h"
 
-#define TOUCHPAD_HISTORY_LENGTH 4
+#define TOUCHPAD_HISTORY_LENGTH 4		/* default */
+#define TOUCHPAD_HISTORY_MAX_LENGTH 64
 #define TOUCHPAD_MIN_SAMPLES 4
 
 /* Convert mm to a distance normalized to DEFAULT_MOUSE_DPI */
@@ -138,19 +139,39 @@ enum tp_thumb_state {
 	THUMB_STATE_MAYBE,
 };
 
-struct tp_touch {
-	struct tp_dispatch *tp;
-	enum touch_state state;
-	bool has_ended;				/* TRACKING_ID == -1 */
-	bool dirty;
+struct tp_history_point {
+	uint64_t time;
 	struct device_coords point;
-	uint64_t millis;
-	int pressure;
-	bool is_tool_palm; /* MT_TOOL_PALM */
+};
 
-	bool was_down; /* if distance == 0, false for pure hovering
-			  touches */
+/* The last positions of a touch. The sums are the terms of a
+ * least-squares fit over the samples, updated on every push, with t in
+ * ms relative to origin. */
+struct tp_motion_history {
+	struct tp_history_point *samples;	/* len == length */
+	unsigned int length;
+	unsigned int index;			/* the most recent sample */
+	unsigned int count;
+	unsigned int pushes;			/* since the sums were rebuilt */
+	uint64_t origin;
+	double st[5];				/* sum of t^k */
+	double sx[3], sy[3];			/* sum of x * t^k, y * t^k */
+	struct device_float_coords velocity;	/* units/us, see
+						   tp_motion_history_push() */
+};
+
+/* Per-touch timeouts, see tp_touch_set_timeout() */
+enum tp_touch_timeout {
+	TP_TOUCH_TIMEOUT_BUTTON,
+	TP_TOUCH_TIMEOUT_SCROLL,
+	TP_TOUCH_TIMEOUT_COUNT,
+};
 
+/* Per-touch state of the individual features: palm, thumb, tap,
+ * software buttons, edge scrolling, gestures and the timeouts. Only
+ * read when the feature handles the touch, it lives in a separate
+ * array to keep struct tp_touch small. */
+struct tp_touch_cold {
 	struct {
 		/* A quirk mostly used on Synaptics touchpads. In a
 		   transition to/from fake touches > num_slots, the current
@@ -160,12 +181,6 @@ struct tp_touch {
 		bool reset_motion_history;
 	} quirks;
 
-	struct {
-		struct device_coords samples[TOUCHPAD_HISTORY_LENGTH];
-		unsigned int index;
-		unsigned int count;
-	} history;
-
 	struct device_coords hysteresis_center;
 
 	/* A pinned touchpoint is the one that pressed the physical button
@@ -177,12 +192,17 @@ struct tp_touch {
 		struct device_coords center;
 	} pinned;
 
+	struct {
+		enum touch_palm_state state;
+		struct device_coords first; /* first coordinates if is_palm == true */
+		uint64_t time; /* first timestamp if is_palm == true */
+	} palm;
+
 	/* Software-button state and timeout if applicable */
 	struct {
 		enum button_state state;
 		/* We use button_event here so we can use == on events */
 		enum button_event curr;
-		struct libinput_timer timer;
 	} button;
 
 	struct {
@@ -195,25 +215,40 @@ struct tp_touch {
 		enum tp_edge_scroll_touch_state edge_state;
 		uint32_t edge;
 		int direction;
-		struct libinput_timer timer;
 		struct device_coords initial;
 	} scroll;
 
 	struct {
-		enum touch_palm_state state;
-		struct device_coords first; /* first coordinates if is_palm == true */
-		uint64_t time; /* first timestamp if is_palm == true */
-	} palm;
+		enum tp_thumb_state state;
+		uint64_t first_touch_time;
+		struct device_coords initial;
+	} thumb;
 
 	struct {
 		struct device_coords initial;
 	} gesture;
 
-	struct {
-		enum tp_thumb_state state;
-		uint64_t first_touch_time;
-		struct device_coords initial;
-	} thumb;
+	/* in absolute us CLOCK_MONOTONIC, 0 if unset */
+	uint64_t timeouts[TP_TOUCH_TIMEOUT_COUNT];
+};
+
+/* The fields every frame reads for each touch in use. The rest is in
+ * struct tp_touch_cold. */
+struct tp_touch {
+	struct tp_dispatch *tp;
+	enum touch_state state;
+	bool has_ended;				/* TRACKING_ID == -1 */
+	bool dirty;
+	bool is_tool_palm; /* MT_TOOL_PALM */
+	bool was_down; /* if distance == 0, false for pure hovering
+			  touches */
+	struct device_coords point;
+	int pressure;
+	uint64_t millis;
+
+	struct tp_motion_history history;
+
+	struct tp_touch_cold *cold;		/* in tp->touches_cold */
 };
 
 struct tp_dispatch {
@@ -232,6 +267,22 @@ struct tp_dispatch {
 	unsigned int num_slots;			/* number of slots */
 	unsigned int ntouches;			/* no slots inc. fakes */
 	struct tp_touch *touches;		/* len == ntouches */
+	struct tp_touch_cold *touches_cold;	/* len == ntouches */
+	struct tp_history_point *history_samples; /* for all touches */
+	/* accelerate on the history velocity instead of the filter's
+	 * trackers, see LIBINPUT_ATTR_TOUCHPAD_HISTORY_VELOCITY */
+	bool history_velocity;
+	/* Bitmasks by index into touches: touches not in TOUCH_NONE and
+	 * touches that are dirty in the current frame */
+	uint64_t touches_in_use;
+	uint64_t touches_dirty;
+
+	/* A single timer for the timeouts of all touches, always set to
+	 * the earliest one and cancelled when there is none */
+	struct {
+		struct libinput_timer timer;
+		uint64_t expire; /* of the timer, 0 if unset */
+	} touch_timeouts;
 	/* bit 0: BTN_TOUCH
 	 * bit 1: BTN_TOOL_FINGER
 	 * bit 2: BTN_TOOL_DOUBLETAP
@@ -396,9 +447,36 @@ tp_dispatch(struct evdev_dispatch *dispatch)
 	return container_of(dispatch, struct tp_dispatch, base);
 }
 
+/* The touch bitmasks limit the number of touches */
+#define TP_MAX_TOUCHES 64
+
 #define tp_for_each_touch(_tp, _t) \
 	for (unsigned int _i = 0; _i < (_tp)->ntouches && (_t = &(_tp)->touches[_i]); _i++)
 
+#define tp_for_each_touch_in_mask(_tp, _t, _mask) \
+	for (uint64_t _m = (_mask); _m && (_t = &(_tp)->touches[__builtin_ctzll(_m)]); _m &= _m - 1)
+
+/* Like tp_for_each_touch but skips touches in TOUCH_NONE */
+#define tp_for_each_touch_in_use(_tp, _t) \
+	tp_for_each_touch_in_mask(_tp, _t, (_tp)->touches_in_use)
+
+/* Like tp_for_each_touch but skips touches that aren't dirty */
+#define tp_for_each_dirty_touch(_tp, _t) \
+	tp_for_each_touch_in_mask(_tp, _t, (_tp)->touches_dirty)
+
+static inline uint64_t
+tp_touch_bit(const struct tp_touch *t)
+{
+	return 1ULL << (t - t->tp->touches);
+}
+
+static inline void
+tp_touch_set_dirty(struct tp_touch *t)
+{
+	t->dirty = true;
+	t->tp->touches_dirty |= tp_touch_bit(t);
+}
+
 static inline struct libinput*
 tp_libinput_context(const struct tp_dispatch *tp)
 {
@@ -448,9 +526,26 @@ tp_unnormalize_for_xaxis(const struct tp_dispatch *tp,
 struct normalized_coords
 tp_get_delta(struct tp_touch *t);
 
+/**
+ * The velocity of the touch in device units/us, from a least-squares
+ * line through the motion history. Zero with less than two samples.
+ */
+static inline struct device_float_coords
+tp_get_velocity(const struct tp_touch *t)
+{
+	return t->history.velocity;
+}
+
+struct device_float_coords
+tp_get_acceleration(const struct tp_touch *t);
+
+/**
+ * @param velocity The velocity of the motion in normalized units/us
+ */
 struct normalized_coords
 tp_filter_motion(struct tp_dispatch *tp,
 		 const struct normalized_coords *unaccelerated,
+		 const struct normalized_coords *velocity,
 		 uint64_t time);
 
 struct normalized_coords
@@ -461,6 +556,17 @@ tp_filter_motion_unaccelerated(struct tp_dispatch *tp,
 bool
 tp_touch_active(const struct tp_dispatch *tp, const struct tp_touch *t);
 
+void
+tp_touch_set_timeout(struct tp_dispatch *tp,
+		     struct tp_touch *t,
+		     enum tp_touch_timeout which,
+		     uint64_t expire);
+
+void
+tp_touch_cancel_timeout(struct tp_dispatch *tp,
+			struct tp_touch *t,
+			enum tp_touch_timeout which);
+
 int
 tp_tap_handle_state(struct tp_dispatch *tp, uint64_t time);
 
@@ -499,6 +605,11 @@ tp_post_button_events(struct tp_dispatch *tp, uint64_t time);
 void
 tp_button_handle_state(struct tp_dispatch *tp, uint64_t time);
 
+void
+tp_button_handle_timeout(struct tp_dispatch *tp,
+			 struct tp_touch *t,
+			 uint64_t now);
+
 bool
 tp_button_touch_active(const struct tp_dispatch *tp,
 		       const struct tp_touch *t);
@@ -535,6 +646,11 @@ tp_edge_scroll_post_events(struct tp_dispatch *tp, uint64_t time);
 void
 tp_edge_scroll_stop_events(struct tp_dispatch *tp, uint64_t time);
 
+void
+tp_edge_scroll_handle_timeout(struct tp_dispatch *tp,
+			      struct tp_touch *t,
+			      uint64_t now);
+
 int
 tp_edge_scroll_touch_active(const struct tp_dispatch *tp,
 			    const struct tp_touch *t);
@@ -181,6 +181,7 @@ pad_group_new_basic(struct pad_dispatch *pad,
 	if (!group)
 		return NULL;
 
+	group->base.libinput = pad_libinput_context(pad);
 	group->base.device = &pad->device->base;
 	group->base.refcount = 1;
 	group->base.index = group_index;
@@ -1038,6 +1038,7 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 		if (!tool)
 			return NULL;
 		*tool = (struct libinput_tablet_tool) {
+			.libinput = libinput,
 			.type = type,
 			.serial = serial,
 			.tool_id = tool_id,
@@ -1634,14 +1635,12 @@ tablet_reset_state(struct tablet_dispatch *tablet)
 	       sizeof(tablet->button_state));
 }
 
-static void
-tablet_process(struct evdev_dispatch *dispatch,
-	       struct evdev_device *device,
-	       struct input_event *e,
-	       uint64_t time)
+static inline void
+tablet_process_event(struct tablet_dispatch *tablet,
+		     struct evdev_device *device,
+		     struct input_event *e,
+		     uint64_t time)
 {
-	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
-
 	switch (e->type) {
 	case EV_ABS:
 		tablet_process_absolute(tablet, device, e, time);
@@ -1669,6 +1668,33 @@ tablet_process(struct evdev_dispatch *dispatch,
 	}
 }
 
+static void
+tablet_process(struct evdev_dispatch *dispatch,
+	       struct evdev_device *device,
+	       struct input_event *e,
+	       uint64_t time)
+{
+	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
+
+	tablet_process_event(tablet, device, e, time);
+}
+
+static void
+tablet_process_frame(struct evdev_dispatch *dispatch,
+		     struct evdev_device *device,
+		     struct input_event *events,
+		     size_t nevents)
+{
+	struct tablet_dispatch *tablet = tablet_dispatch(dispatch);
+	size_t i;
+
+	for (i = 0; i < nevents; i++)
+		tablet_process_event(tablet,
+				     device,
+				     &events[i],
+				     tv2us(&events[i].time));
+}
+
 static void
 tablet_suspend(struct evdev_dispatch *dispatch,
 	       struct evdev_device *device)
@@ -1768,6 +1794,7 @@ static struct evdev_dispatch_interface tablet_interface = {
 	NULL, /* device_resumed */
 	tablet_check_initial_proximity,
 	NULL, /* toggle_touch */
+	tablet_process_frame,
 };
 
 static void
@@ -29,11 +29,11 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include "linux/input.h"
 #include <unistd.h>
 #include <fcntl.h>
-#include <mtdev-plumbing.h>
 #include <assert.h>
 #include <time.h>
 #include <math.h>
@@ -451,6 +451,29 @@ fallback_rotate_relative(struct fallback_dispatch *dispatch,
 	dispatch->rel = rel;
 }
 
+/* The filter's velocity is a speed only, for prediction we assume the
+ * motion continues in the direction of the current delta */
+static inline struct device_float_coords
+fallback_motion_velocity(struct evdev_device *device,
+			 const struct device_float_coords *raw)
+{
+	struct device_float_coords velocity = { 0.0, 0.0 };
+	double length, speed;
+
+	if (evdev_libinput_context(device)->prediction_horizon == 0)
+		return velocity;
+
+	length = hypot(raw->x, raw->y);
+	if (length == 0.0)
+		return velocity;
+
+	speed = filter_get_velocity(device->pointer.filter);
+	velocity.x = raw->x/length * speed;
+	velocity.y = raw->y/length * speed;
+
+	return velocity;
+}
+
 static void
 fallback_flush_relative_motion(struct fallback_dispatch *dispatch,
 			       struct evdev_device *device,
@@ -458,7 +481,7 @@ fallback_flush_relative_motion(struct fallback_dispatch *dispatch,
 {
 	struct libinput_device *base = &device->base;
 	struct normalized_coords accel, unaccel;
-	struct device_float_coords raw;
+	struct device_float_coords raw, velocity = { 0.0, 0.0 };
 
 	if (!(device->seat_caps & EVDEV_DEVICE_POINTER))
 		return;
@@ -481,6 +504,7 @@ fallback_flush_relative_motion(struct fallback_dispatch *dispatch,
 					&raw,
 					device,
 					time);
+		velocity = fallback_motion_velocity(device, &raw);
 	} else {
 		evdev_log_bug_libinput(device,
 				       "accel filter missing\n");
@@ -490,7 +514,7 @@ fallback_flush_relative_motion(struct fallback_dispatch *dispatch,
 	if (normalized_is_zero(accel) && normalized_is_zero(unaccel))
 		return;
 
-	pointer_notify_motion(base, time, &accel, &raw);
+	pointer_notify_motion(base, time, &accel, &raw, &velocity, NULL);
 }
 
 static void
@@ -1145,18 +1169,14 @@ evdev_tag_lid_switch(struct evdev_device *device,
 	device->tags |= EVDEV_TAG_LID_SWITCH;
 }
 
-static void
-fallback_process(struct evdev_dispatch *evdev_dispatch,
-		 struct evdev_device *device,
-		 struct input_event *event,
-		 uint64_t time)
+static inline void
+fallback_process_event(struct fallback_dispatch *dispatch,
+		       struct evdev_device *device,
+		       struct input_event *event,
+		       uint64_t time)
 {
-	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
 	enum evdev_event_type sent;
 
-	if (dispatch->ignore_events)
-		return;
-
 	switch (event->type) {
 	case EV_REL:
 		fallback_process_relative(dispatch, device, event, time);
@@ -1186,6 +1206,39 @@ fallback_process(struct evdev_dispatch *evdev_dispatch,
 	}
 }
 
+static void
+fallback_process(struct evdev_dispatch *evdev_dispatch,
+		 struct evdev_device *device,
+		 struct input_event *event,
+		 uint64_t time)
+{
+	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
+
+	if (dispatch->ignore_events)
+		return;
+
+	fallback_process_event(dispatch, device, event, time);
+}
+
+static void
+fallback_process_frame(struct evdev_dispatch *evdev_dispatch,
+		       struct evdev_device *device,
+		       struct input_event *events,
+		       size_t nevents)
+{
+	struct fallback_dispatch *dispatch = fallback_dispatch(evdev_dispatch);
+	size_t i;
+
+	if (dispatch->ignore_events)
+		return;
+
+	for (i = 0; i < nevents; i++)
+		fallback_process_event(dispatch,
+				       device,
+				       &events[i],
+				       tv2us(&events[i].time));
+}
+
 static void
 release_touches(struct fallback_dispatch *dispatch,
 		struct evdev_device *device,
@@ -1362,6 +1415,7 @@ struct evdev_dispatch_interface fallback_interface = {
 	NULL, /* device_resumed */
 	NULL, /* post_added */
 	fallback_toggle_touch, /* toggle_touch */
+	fallback_process_frame,
 };
 
 static uint32_t
@@ -1586,6 +1640,7 @@ evdev_init_button_scroll(struct evdev_device *device,
 	libinput_timer_init(&device->scroll.timer,
 			    evdev_libinput_context(device),
 			    evdev_button_scroll_timeout, device);
+	libinput_timer_set_slack(&device->scroll.timer, TIMER_SLACK_DEFAULT);
 	device->scroll.config.get_methods = evdev_scroll_get_methods;
 	device->scroll.config.set_method = evdev_scroll_set_method;
 	device->scroll.config.get_method = evdev_scroll_get_method;
@@ -1722,7 +1777,7 @@ evdev_init_rotation(struct evdev_device *device,
 }
 
 static inline int
-evdev_need_mtdev(struct evdev_device *device)
+evdev_is_protocol_a(struct evdev_device *device)
 {
 	struct libevdev *evdev = device->evdev;
 
@@ -1760,16 +1815,14 @@ fallback_dispatch_init_slots(struct fallback_dispatch *dispatch,
 
 	/* We only handle the slotted Protocol B in libinput.
 	   Devices with ABS_MT_POSITION_* but not ABS_MT_SLOT
-	   require mtdev for conversion. */
-	if (evdev_need_mtdev(device)) {
-		device->mtdev = mtdev_new_open(device->fd);
-		if (!device->mtdev)
+	   are converted to protocol B before processing. */
+	if (evdev_is_protocol_a(device)) {
+		device->mt_a = evdev_mt_a_new(device);
+		if (!device->mt_a)
 			return -1;
 
-		/* pick 10 slots as default for type A
-		   devices. */
-		num_slots = 10;
-		active_slot = device->mtdev->caps.slot.value;
+		num_slots = EVDEV_MT_A_MAX_SLOTS;
+		active_slot = 0;
 	} else {
 		num_slots = libevdev_get_num_slots(device->evdev);
 		active_slot = libevdev_get_current_slot(evdev);
@@ -1782,7 +1835,7 @@ fallback_dispatch_init_slots(struct fallback_dispatch *dispatch,
 	for (slot = 0; slot < num_slots; ++slot) {
 		slots[slot].seat_slot = -1;
 
-		if (evdev_need_mtdev(device))
+		if (evdev_is_protocol_a(device))
 			continue;
 
 		slots[slot].point.x = libevdev_get_slot_value(evdev,
@@ -1901,42 +1954,360 @@ evdev_process_event(struct evdev_device *device, struct input_event *e)
 			  e->value);
 #endif
 
-	dispatch->interface->process(dispatch, device, e, time);
+	if (!dispatch->interface->process_frame) {
+		dispatch->interface->process(dispatch, device, e, time);
+		return;
+	}
+
+	device->frame.events[device->frame.count++] = *e;
+
+	if (e->type == EV_SYN ||
+	    device->frame.count == EVDEV_FRAME_MAX_EVENTS) {
+		dispatch->interface->process_frame(dispatch,
+						   device,
+						   device->frame.events,
+						   device->frame.count);
+		device->frame.count = 0;
+	}
 }
 
 static inline void
 evdev_device_dispatch_one(struct evdev_device *device,
 			  struct input_event *ev)
 {
-	if (!device->mtdev) {
+	struct input_event events[EVDEV_MT_A_MAX_EVENTS];
+	size_t i, nevents;
+
+	if (!device->mt_a) {
 		evdev_process_event(device, ev);
-	} else {
-		mtdev_put_event(device->mtdev, ev);
-		if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT)) {
-			while (!mtdev_empty(device->mtdev)) {
-				struct input_event e;
-				mtdev_get_event(device->mtdev, &e);
-				evdev_process_event(device, &e);
+		return;
+	}
+
+	nevents = evdev_mt_a_process(device->mt_a, ev, events);
+	for (i = 0; i < nevents; i++)
+		evdev_process_event(device, &events[i]);
+}
+
+/* Events are read from the fd directly, libevdev's view of the device is
+ * updated from those events so it is correct when we need it to resync
+ * after a SYN_DROPPED. Returns false for events libevdev would have
+ * discarded, e.g. codes disabled with libevdev_disable_event_code().
+ */
+static inline bool
+evdev_update_libevdev_state(struct evdev_device *device,
+			    const struct input_event *e)
+{
+	if (e->type == EV_SYN)
+		return true;
+
+	if (!libevdev_has_event_code(device->evdev, e->type, e->code))
+		return false;
+
+	switch (e->type) {
+	case EV_KEY:
+	case EV_ABS:
+	case EV_SW:
+	case EV_LED:
+		libevdev_set_event_value(device->evdev,
+					 e->type,
+					 e->code,
+					 e->value);
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+static int
+evdev_device_read(struct evdev_device *device)
+{
+	ssize_t len;
+
+	len = read(device->fd,
+		   device->read_buffer.events,
+		   sizeof(device->read_buffer.events));
+	if (len < 0)
+		return -errno;
+
+	if (len == 0 || len % sizeof(struct input_event) != 0)
+		return -EINVAL;
+
+	device->read_buffer.head = 0;
+	device->read_buffer.count = len / sizeof(struct input_event);
+
+	return 0;
+}
+
+/* Maximum number of reads to discard the events queued before a resync,
+ * a device flooding us must not stall the resync */
+#define EVDEV_SYNC_MAX_DRAIN 16
+
+#define EVDEV_MT_NCODES (ABS_MT_TOOL_Y - ABS_MT_SLOT)
+
+static inline bool
+evdev_is_mt_code(unsigned int code)
+{
+	return code >= ABS_MT_SLOT && code <= ABS_MT_TOOL_Y;
+}
+
+/* Process one event of the synthesized resync frames. These go past the
+ * protocol A conversion, the state is already in protocol B form. */
+static inline void
+evdev_sync_event(struct evdev_device *device,
+		 const struct timeval *time,
+		 unsigned int type,
+		 unsigned int code,
+		 int value)
+{
+	struct input_event ev = {
+		.time = *time,
+		.type = type,
+		.code = code,
+		.value = value,
+	};
+
+	evdev_update_libevdev_state(device, &ev);
+	evdev_process_event(device, &ev);
+}
+
+static int
+evdev_sync_drain(struct evdev_device *device)
+{
+	int i, rc = 0;
+
+	for (i = 0; i < EVDEV_SYNC_MAX_DRAIN; i++) {
+		rc = evdev_device_read(device);
+		if (rc < 0)
+			break;
+	}
+
+	device->read_buffer.head = 0;
+	device->read_buffer.count = 0;
+
+	return rc == -EAGAIN || rc == 0 ? 0 : rc;
+}
+
+/* Fetch the slot state of all ABS_MT_* axes, one ioctl per axis.
+ * values[code - ABS_MT_SLOT - 1][slot], unavailable axes are left
+ * as-is in libevdev's state. */
+static int
+evdev_sync_fetch_slots(struct evdev_device *device,
+		       int num_slots,
+		       int32_t *values)
+{
+	int32_t *request;
+	unsigned int code;
+	int rc = 0;
+
+	request = zalloc((num_slots + 1) * sizeof(*request));
+	if (!request)
+		return -ENOMEM;
+
+	for (code = ABS_MT_SLOT + 1; code <= ABS_MT_TOOL_Y; code++) {
+		int32_t *v = &values[(code - ABS_MT_SLOT - 1) * num_slots];
+		int slot;
+
+		if (!libevdev_has_event_code(device->evdev, EV_ABS, code))
+			continue;
+
+		request[0] = code;
+		if (ioctl(device->fd,
+			  EVIOCGMTSLOTS((num_slots + 1) * sizeof(*request)),
+			  request) < 0) {
+			rc = -errno;
+			break;
+		}
+
+		for (slot = 0; slot < num_slots; slot++)
+			v[slot] = request[slot + 1];
+	}
+
+	free(request);
+
+	return rc;
+}
+
+static void
+evdev_sync_slots(struct evdev_device *device,
+		 const struct timeval *time,
+		 int num_slots,
+		 const int32_t *values)
+{
+	struct libevdev *evdev = device->evdev;
+	const int32_t *tracking_ids;
+	bool restarted = false;
+	unsigned int code;
+	int slot;
+
+	tracking_ids = &values[(ABS_MT_TRACKING_ID - ABS_MT_SLOT - 1) * num_slots];
+
+	/* A touch that was replaced by a different one while we weren't
+	 * looking ends in a frame of its own, the new touch starts in the
+	 * next frame */
+	for (slot = 0; slot < num_slots; slot++) {
+		int id = libevdev_get_slot_value(evdev,
+						 slot,
+						 ABS_MT_TRACKING_ID);
+
+		if (id == -1 || id == tracking_ids[slot])
+			continue;
+
+		evdev_sync_event(device, time, EV_ABS, ABS_MT_SLOT, slot);
+		evdev_sync_event(device, time, EV_ABS, ABS_MT_TRACKING_ID, -1);
+		restarted = true;
+	}
+
+	if (restarted)
+		evdev_sync_event(device, time, EV_SYN, SYN_REPORT, 0);
+
+	for (slot = 0; slot < num_slots; slot++) {
+		bool slot_selected = false;
+
+		/* ABS_MT_SLOT + 1 is replaced by the tracking ID so the
+		 * tracking ID is sent before the other axes of a slot */
+		for (code = ABS_MT_SLOT + 1; code <= ABS_MT_TOOL_Y; code++) {
+			unsigned int c = code;
+			int32_t value;
+
+			if (c == ABS_MT_SLOT + 1)
+				c = ABS_MT_TRACKING_ID;
+			else if (c == ABS_MT_TRACKING_ID)
+				c = ABS_MT_SLOT + 1;
+
+			value = values[(c - ABS_MT_SLOT - 1) * num_slots + slot];
+			if (!libevdev_has_event_code(evdev, EV_ABS, c) ||
+			    libevdev_get_slot_value(evdev, slot, c) == value)
+				continue;
+
+			if (!slot_selected) {
+				evdev_sync_event(device, time,
+						 EV_ABS, ABS_MT_SLOT, slot);
+				slot_selected = true;
 			}
+
+			evdev_sync_event(device, time, EV_ABS, c, value);
 		}
 	}
 }
 
+/* Recover from a SYN_DROPPED: discard what's queued, fetch the current
+ * device state from the kernel in bulk and process the difference to
+ * the last known state as one frame (two if touches were replaced).
+ * libevdev's state is the last known state, see
+ * evdev_update_libevdev_state(). */
 static int
-evdev_sync_device(struct evdev_device *device)
+evdev_sync_device(struct evdev_device *device,
+		  const struct timeval *sync_time)
 {
-	struct input_event ev;
+	struct libinput *libinput = evdev_libinput_context(device);
+	struct libevdev *evdev = device->evdev;
+	unsigned char keys[NCHARS(KEY_CNT)] = {0};
+	unsigned char switches[NCHARS(SW_CNT)] = {0};
+	struct input_absinfo absinfo;
+	int num_slots = device->mt_a ? -1 : libevdev_get_num_slots(evdev);
+	int32_t *slot_values = NULL;
+	/* the time points into the read buffer we're about to drain */
+	const struct timeval time_copy = *sync_time,
+			     *time = &time_copy;
+	uint64_t start, duration;
+	unsigned int code;
 	int rc;
 
-	do {
-		rc = libevdev_next_event(device->evdev,
-					 LIBEVDEV_READ_FLAG_SYNC, &ev);
+	start = libinput_now(libinput);
+
+	rc = evdev_sync_drain(device);
+	if (rc < 0)
+		goto out;
+
+	if (libevdev_has_event_type(evdev, EV_KEY) &&
+	    ioctl(device->fd, EVIOCGKEY(sizeof(keys)), keys) < 0) {
+		rc = -errno;
+		goto out;
+	}
+
+	if (libevdev_has_event_type(evdev, EV_SW) &&
+	    ioctl(device->fd, EVIOCGSW(sizeof(switches)), switches) < 0) {
+		rc = -errno;
+		goto out;
+	}
+
+	if (num_slots > 0) {
+		slot_values = zalloc(EVDEV_MT_NCODES * num_slots *
+				     sizeof(*slot_values));
+		if (!slot_values) {
+			rc = -ENOMEM;
+			goto out;
+		}
+
+		rc = evdev_sync_fetch_slots(device, num_slots, slot_values);
 		if (rc < 0)
-			break;
-		evdev_device_dispatch_one(device, &ev);
-	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
+			goto out;
+
+		evdev_sync_slots(device, time, num_slots, slot_values);
+	}
+
+	for (code = 0; code <= KEY_MAX; code++) {
+		int value = bit_is_set(keys, code);
+
+		if (libevdev_has_event_code(evdev, EV_KEY, code) &&
+		    libevdev_get_event_value(evdev, EV_KEY, code) != value)
+			evdev_sync_event(device, time, EV_KEY, code, value);
+	}
+
+	for (code = 0; code <= SW_MAX; code++) {
+		int value = bit_is_set(switches, code);
+
+		if (libevdev_has_event_code(evdev, EV_SW, code) &&
+		    libevdev_get_event_value(evdev, EV_SW, code) != value)
+			evdev_sync_event(device, time, EV_SW, code, value);
+	}
+
+	for (code = 0; code <= ABS_MAX; code++) {
+		/* the slots were handled above, protocol A devices have
+		 * no queryable per-touch state */
+		if (evdev_is_mt_code(code) &&
+		    (num_slots > 0 || device->mt_a))
+			continue;
+
+		if (!libevdev_has_event_code(evdev, EV_ABS, code))
+			continue;
+
+		if (ioctl(device->fd, EVIOCGABS(code), &absinfo) < 0) {
+			rc = -errno;
+			goto out;
+		}
+
+		if (libevdev_get_event_value(evdev, EV_ABS, code) != absinfo.value)
+			evdev_sync_event(device, time, EV_ABS, code, absinfo.value);
+	}
+
+	/* leave the dispatch on the slot the kernel continues with */
+	if (num_slots > 0) {
+		if (ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT), &absinfo) < 0) {
+			rc = -errno;
+			goto out;
+		}
+
+		if (libevdev_get_current_slot(evdev) != absinfo.value)
+			evdev_sync_event(device, time,
+					 EV_ABS, ABS_MT_SLOT, absinfo.value);
+	}
+
+	evdev_sync_event(device, time, EV_SYN, SYN_REPORT, 0);
 
-	return rc == -EAGAIN ? 0 : rc;
+out:
+	/* a failed resync counts too, it held up the event processing
+	 * just the same */
+	duration = libinput_now(libinput) - start;
+	device->resync.last_duration = duration;
+	device->resync.max_duration = max(device->resync.max_duration,
+					   duration);
+
+	free(slot_values);
+
+	return rc;
 }
 
 static void
@@ -1944,16 +2315,22 @@ evdev_device_dispatch(void *data)
 {
 	struct evdev_device *device = data;
 	struct libinput *libinput = evdev_libinput_context(device);
-	struct input_event ev;
+	struct input_event *ev;
 	int rc;
 
 	/* If the compositor is repainting, this function is called only once
 	 * per frame and we have to process all the events available on the
 	 * fd, otherwise there will be input lag. */
-	do {
-		rc = libevdev_next_event(device->evdev,
-					 LIBEVDEV_READ_FLAG_NORMAL, &ev);
-		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+	while (true) {
+		if (device->read_buffer.head == device->read_buffer.count) {
+			rc = evdev_device_read(device);
+			if (rc < 0)
+				break;
+		}
+
+		ev = &device->read_buffer.events[device->read_buffer.head++];
+
+		if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
 			evdev_log_info_ratelimit(device,
 						 &device->syn_drop_limit,
 						 "SYN_DROPPED event - some input events have been lost.\n");
@@ -1961,16 +2338,35 @@ evdev_device_dispatch(void *data)
 			/* send one more sync event so we handle all
 			   currently pending events before we sync up
 			   to the current state */
-			ev.code = SYN_REPORT;
-			evdev_device_dispatch_one(device, &ev);
-
-			rc = evdev_sync_device(device);
-			if (rc == 0)
-				rc = LIBEVDEV_READ_STATUS_SUCCESS;
-		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
-			evdev_device_dispatch_one(device, &ev);
+			ev->code = SYN_REPORT;
+			evdev_device_dispatch_one(device, ev);
+
+			/* anything after the SYN_DROPPED is superseded by
+			 * the state we fetch from the kernel */
+			device->read_buffer.head = device->read_buffer.count;
+			device->resync.syn_dropped++;
+
+			rc = evdev_sync_device(device, &ev->time);
+			if (rc < 0)
+				break;
+			continue;
 		}
-	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
+
+		if (!evdev_update_libevdev_state(device, ev))
+			continue;
+
+		evdev_device_dispatch_one(device, ev);
+
+		/* In round-robin mode or with a dispatch budget, stop at a
+		 * frame boundary and let the other sources catch up. The
+		 * rest of the buffer is processed on the next call. */
+		if (ev->type == EV_SYN && ev->code == SYN_REPORT &&
+		    libinput_dispatch_should_yield(libinput)) {
+			libinput_source_set_pending(libinput,
+						    device->source);
+			return;
+		}
+	}
 
 	if (rc != -EAGAIN && rc != -EINTR) {
 		libinput_remove_source(libinput, device->source);
@@ -2913,7 +3309,7 @@ evdev_device_create(struct libinput_seat *seat,
 
 	/* Use non-blocking mode so that we can loop on read on
 	 * evdev_device_data() until all events on the fd are
-	 * read.  mtdev_get() also expects this. */
+	 * read. */
 	fd = open_restricted(libinput, devnode,
 			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
 	if (fd < 0) {
@@ -2948,7 +3344,7 @@ evdev_device_create(struct libinput_seat *seat,
 					 libinput);
 	device->seat_caps = 0;
 	device->is_mt = 0;
-	device->mtdev = NULL;
+	device->mt_a = NULL;
 	device->udev_device = udev_device_ref(udev_device);
 	device->dispatch = NULL;
 	device->fd = fd;
@@ -3375,15 +3771,19 @@ evdev_device_suspend(struct evdev_device *device)
 		device->source = NULL;
 	}
 
-	if (device->mtdev) {
-		mtdev_close_delete(device->mtdev);
-		device->mtdev = NULL;
-	}
+	/* the touches were released by the dispatch */
+	if (device->mt_a)
+		evdev_mt_a_reset(device->mt_a);
 
 	if (device->fd != -1) {
 		close_restricted(libinput, device->fd);
 		device->fd = -1;
 	}
+
+	/* events of the old fd no longer match the device state */
+	device->read_buffer.head = 0;
+	device->read_buffer.count = 0;
+	device->frame.count = 0;
 }
 
 int
@@ -3417,12 +3817,6 @@ evdev_device_resume(struct evdev_device *device)
 
 	device->fd = fd;
 
-	if (evdev_need_mtdev(device)) {
-		device->mtdev = mtdev_new_open(device->fd);
-		if (!device->mtdev)
-			return -ENODEV;
-	}
-
 	libevdev_change_fd(device->evdev, fd);
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 
@@ -3439,10 +3833,8 @@ evdev_device_resume(struct evdev_device *device)
 
 	device->source =
 		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
-	if (!device->source) {
-		mtdev_close_delete(device->mtdev);
+	if (!device->source)
 		return -ENOMEM;
-	}
 
 	evdev_notify_resumed_device(device);
 
@@ -3493,6 +3885,7 @@ evdev_device_destroy(struct evdev_device *device)
 		libinput_device_group_unref(device->base.group);
 
 	free(device->output_name);
+	evdev_mt_a_destroy(device->mt_a);
 	filter_destroy(device->pointer.filter);
 	libinput_seat_unref(device->base.seat);
 	libevdev_free(device->evdev);
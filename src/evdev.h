@@ -141,6 +141,12 @@ struct mt_slot {
 	struct device_coords hysteresis_center;
 };
 
+/* Maximum number of events read from the fd with one read() */
+#define EVDEV_READ_BUFFER_SIZE 64
+
+/* Maximum number of events passed to process_frame() at once */
+#define EVDEV_FRAME_MAX_EVENTS 128
+
 struct evdev_device {
 	struct libinput_device base;
 
@@ -161,7 +167,28 @@ struct evdev_device {
 	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
 	struct ratelimit nonpointer_rel_limit; /* ratelimit for REL_* events from non-pointer devices */
 	uint32_t model_flags;
-	struct mtdev *mtdev;
+	struct evdev_mt_a *mt_a; /* protocol A to B conversion */
+
+	/* events read from the fd but not processed yet, see
+	 * evdev_device_dispatch() */
+	struct {
+		struct input_event events[EVDEV_READ_BUFFER_SIZE];
+		unsigned int head;
+		unsigned int count;
+	} read_buffer;
+
+	/* the current frame, if the dispatch implements process_frame */
+	struct {
+		struct input_event events[EVDEV_FRAME_MAX_EVENTS];
+		size_t count;
+	} frame;
+
+	/* SYN_DROPPED recovery, see evdev_sync_device(). Durations in us */
+	struct {
+		uint64_t syn_dropped;
+		uint64_t last_duration;
+		uint64_t max_duration;
+	} resync;
 
 	struct {
 		const struct input_absinfo *absinfo_x, *absinfo_y;
@@ -295,6 +322,16 @@ struct evdev_dispatch_interface {
 	void (*toggle_touch)(struct evdev_dispatch *dispatch,
 			     struct evdev_device *device,
 			     bool enable);
+
+	/* Process a frame of evdev input events, the last event is the
+	 * EV_SYN terminating the frame. Frames larger than
+	 * EVDEV_FRAME_MAX_EVENTS are passed in several pieces, only the
+	 * last of those ends in EV_SYN. If NULL, process() is called for
+	 * each event instead. */
+	void (*process_frame)(struct evdev_dispatch *dispatch,
+			      struct evdev_device *device,
+			      struct input_event *events,
+			      size_t nevents);
 };
 
 enum evdev_dispatch_type {
@@ -416,6 +453,37 @@ evdev_tablet_pad_create(struct evdev_device *device);
 struct evdev_dispatch *
 evdev_lid_switch_dispatch_create(struct evdev_device *device);
 
+/* Number of slots for protocol A devices, contacts beyond that are
+ * ignored */
+#define EVDEV_MT_A_MAX_SLOTS 10
+
+/* The per-contact axes of protocol A, ABS_MT_TOUCH_MAJOR to
+ * ABS_MT_TOOL_Y */
+#define EVDEV_MT_A_NAXES (ABS_MT_TOOL_Y - ABS_MT_TOUCH_MAJOR + 1)
+
+/* The maximum number of events evdev_mt_a_process() writes at once: slot,
+ * the end of the previous touch, tracking ID and the other axes for each
+ * slot plus the SYN_REPORT */
+#define EVDEV_MT_A_MAX_EVENTS \
+	(EVDEV_MT_A_MAX_SLOTS * (EVDEV_MT_A_NAXES + 2) + 1)
+
+struct evdev_mt_a *
+evdev_mt_a_new(struct evdev_device *device);
+
+void
+evdev_mt_a_destroy(struct evdev_mt_a *mt);
+
+void
+evdev_mt_a_reset(struct evdev_mt_a *mt);
+
+/* Feed one event of a protocol A device, the protocol B events to
+ * process are written to out. Returns the number of events written.
+ */
+size_t
+evdev_mt_a_process(struct evdev_mt_a *mt,
+		   const struct input_event *e,
+		   struct input_event *out);
+
 void
 evdev_device_led_update(struct evdev_device *device, enum libinput_led leds);
 
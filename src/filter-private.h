@@ -34,6 +34,17 @@ struct motion_filter_interface {
 			   struct motion_filter *filter,
 			   const struct device_float_coords *unaccelerated,
 			   void *data, uint64_t time);
+	struct normalized_coords (*filter_velocity)(
+			   struct motion_filter *filter,
+			   const struct device_float_coords *unaccelerated,
+			   double velocity,
+			   void *data, uint64_t time);
+	void (*filter_batch)(struct motion_filter *filter,
+			     size_t count,
+			     const double *dx, const double *dy,
+			     const uint64_t *time,
+			     void *data,
+			     double *x, double *y);
 	struct normalized_coords (*filter_constant)(
 			   struct motion_filter *filter,
 			   const struct device_float_coords *unaccelerated,
@@ -73,6 +73,21 @@ normalize_for_dpi(const struct device_float_coords *coords, int dpi)
 	return norm;
 }
 
+static inline void
+normalize_for_dpi_batch(size_t count,
+			const double *dx, const double *dy,
+			int dpi,
+			double *x, double *y)
+{
+	size_t i;
+
+	/* Same calculation as normalize_for_dpi() */
+	for (i = 0; i < count; i++) {
+		x[i] = dx[i] * DEFAULT_MOUSE_DPI/dpi;
+		y[i] = dy[i] * DEFAULT_MOUSE_DPI/dpi;
+	}
+}
+
 struct normalized_coords
 filter_dispatch(struct motion_filter *filter,
 		const struct device_float_coords *unaccelerated,
@@ -81,6 +96,58 @@ filter_dispatch(struct motion_filter *filter,
 	return filter->interface->filter(filter, unaccelerated, data, time);
 }
 
+struct normalized_coords
+filter_dispatch_velocity(struct motion_filter *filter,
+			 const struct device_float_coords *unaccelerated,
+			 double velocity,
+			 void *data, uint64_t time)
+{
+	if (!filter->interface->filter_velocity)
+		return filter->interface->filter(filter,
+						 unaccelerated,
+						 data,
+						 time);
+
+	return filter->interface->filter_velocity(filter,
+						  unaccelerated,
+						  velocity,
+						  data,
+						  time);
+}
+
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      size_t count,
+		      const double *dx, const double *dy,
+		      const uint64_t *time,
+		      void *data,
+		      double *x, double *y)
+{
+	size_t i;
+
+	if (filter->interface->filter_batch) {
+		filter->interface->filter_batch(filter,
+						count,
+						dx, dy,
+						time,
+						data,
+						x, y);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct device_float_coords delta = { dx[i], dy[i] };
+		struct normalized_coords accelerated;
+
+		accelerated = filter->interface->filter(filter,
+							&delta,
+							data,
+							time[i]);
+		x[i] = accelerated.x;
+		y[i] = accelerated.y;
+	}
+}
+
 struct normalized_coords
 filter_dispatch_constant(struct motion_filter *filter,
 			 const struct device_float_coords *unaccelerated,
@@ -154,23 +221,44 @@ filter_get_type(struct motion_filter *filter)
 #define MAX_VELOCITY_DIFF	v_ms2us(1) /* units/us */
 #define MOTION_TIMEOUT		ms2us(1000)
 #define NUM_POINTER_TRACKERS	16
+#define MAX_TRACKER_POSITION	1e6 /* units */
+#define FILTER_BATCH_SIZE	64
+
+/*
+ * Acceleration profile table constants
+ */
+
+#define ACCEL_TABLE_SIZE		2048
+#define ACCEL_TABLE_MIN_VELOCITY	v_ms2us(0.001) /* units/us */
+#define ACCEL_TABLE_MAX_VELOCITY	v_ms2us(1000) /* units/us */
 
 struct pointer_tracker {
-	struct device_float_coords delta; /* delta to most recent event */
+	struct device_float_coords position; /* sum of all deltas so far */
 	uint64_t time;  /* us */
 	uint32_t dir;
 };
 
+/* The profile sampled at ACCEL_TABLE_SIZE + 1 equidistant velocities in
+ * [0, max_velocity]. Velocities at or above max_velocity go to the
+ * profile function itself. */
+struct accel_profile_table {
+	double *factors;
+	double max_velocity;	/* units/us, 0 if the table is unused */
+	double scale;		/* table entries per units/us */
+};
+
 struct pointer_accelerator {
 	struct motion_filter base;
 
 	accel_profile_func_t profile;
+	struct accel_profile_table table;
 
 	double velocity;	/* units/us */
 	double last_velocity;	/* units/us */
 
 	struct pointer_tracker *trackers;
-	int cur_tracker;
+	unsigned int ntrackers;
+	unsigned int cur_tracker;
 
 	double threshold;	/* units/us */
 	double accel;		/* unitless factor */
@@ -195,46 +283,77 @@ struct tablet_accelerator_flat {
 	       yres_scale; /* 1000dpi : tablet res */
 };
 
+/* The trackers store the sum of all deltas up to their event, the motion
+ * since a tracker is the difference to the most recent tracker. Moving the
+ * origin every now and then keeps that difference precise. */
+static void
+rebase_trackers(struct pointer_accelerator *accel)
+{
+	struct device_float_coords origin;
+	unsigned int i;
+
+	origin = accel->trackers[accel->cur_tracker].position;
+
+	for (i = 0; i < accel->ntrackers; i++) {
+		accel->trackers[i].position.x -= origin.x;
+		accel->trackers[i].position.y -= origin.y;
+	}
+}
+
 static void
 feed_trackers(struct pointer_accelerator *accel,
 	      const struct device_float_coords *delta,
 	      uint64_t time)
 {
-	int i, current;
 	struct pointer_tracker *trackers = accel->trackers;
+	struct device_float_coords position;
+	unsigned int current;
 
-	for (i = 0; i < NUM_POINTER_TRACKERS; i++) {
-		trackers[i].delta.x += delta->x;
-		trackers[i].delta.y += delta->y;
-	}
+	position = trackers[accel->cur_tracker].position;
+	position.x += delta->x;
+	position.y += delta->y;
 
-	current = (accel->cur_tracker + 1) % NUM_POINTER_TRACKERS;
+	current = accel->cur_tracker + 1;
+	if (current == accel->ntrackers)
+		current = 0;
 	accel->cur_tracker = current;
 
-	trackers[current].delta.x = 0.0;
-	trackers[current].delta.y = 0.0;
+	trackers[current].position = position;
 	trackers[current].time = time;
 	trackers[current].dir = device_float_get_direction(*delta);
+
+	if (fabs(position.x) > MAX_TRACKER_POSITION ||
+	    fabs(position.y) > MAX_TRACKER_POSITION)
+		rebase_trackers(accel);
 }
 
 static struct pointer_tracker *
 tracker_by_offset(struct pointer_accelerator *accel, unsigned int offset)
 {
-	unsigned int index =
-		(accel->cur_tracker + NUM_POINTER_TRACKERS - offset)
-		% NUM_POINTER_TRACKERS;
-	return &accel->trackers[index];
+	unsigned int index = accel->cur_tracker;
+
+	if (index < offset)
+		index += accel->ntrackers;
+
+	return &accel->trackers[index - offset];
 }
 
 static double
-calculate_tracker_velocity(struct pointer_tracker *tracker, uint64_t time)
+calculate_tracker_velocity(struct pointer_accelerator *accel,
+			   struct pointer_tracker *tracker,
+			   uint64_t time)
 {
+	struct pointer_tracker *current = &accel->trackers[accel->cur_tracker];
+	double dx = current->position.x - tracker->position.x,
+	       dy = current->position.y - tracker->position.y;
 	double tdelta = time - tracker->time + 1;
-	return hypot(tracker->delta.x, tracker->delta.y) / tdelta; /* units/us */
+
+	return hypot(dx, dy) / tdelta; /* units/us */
 }
 
 static inline double
-calculate_velocity_after_timeout(struct pointer_tracker *tracker)
+calculate_velocity_after_timeout(struct pointer_accelerator *accel,
+				 struct pointer_tracker *tracker)
 {
 	/* First movement after timeout needs special handling.
 	 *
@@ -247,7 +366,8 @@ calculate_velocity_after_timeout(struct pointer_tracker *tracker)
 	 * for really slow movements but provides much more useful initial
 	 * movement in normal use-cases (pause, move, pause, move)
 	 */
-	return calculate_tracker_velocity(tracker,
+	return calculate_tracker_velocity(accel,
+					  tracker,
 					  tracker->time + MOTION_TIMEOUT);
 }
 
@@ -272,7 +392,7 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 
 	/* Find least recent vector within a timelimit, maximum velocity diff
 	 * and direction threshold. */
-	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+	for (offset = 1; offset < accel->ntrackers; offset++) {
 		tracker = tracker_by_offset(accel, offset);
 
 		/* Bug: time running backwards */
@@ -282,11 +402,12 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 		/* Stop if too far away in time */
 		if (time - tracker->time > MOTION_TIMEOUT) {
 			if (offset == 1)
-				result = calculate_velocity_after_timeout(tracker);
+				result = calculate_velocity_after_timeout(accel,
+									  tracker);
 			break;
 		}
 
-		velocity = calculate_tracker_velocity(tracker, time);
+		velocity = calculate_tracker_velocity(accel, tracker, time);
 
 		/* Stop if direction changed */
 		dir &= tracker->dir;
@@ -313,6 +434,57 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 	return result; /* units/us */
 }
 
+/**
+ * Sample the acceleration profile into the filter's lookup table. Must be
+ * called whenever the profile parameters change.
+ *
+ * The table covers the velocities from 0 up to where the profile reaches
+ * its maximum factor, beyond that the profile is evaluated directly.
+ * Profiles are sampled without caller-specific data and time, a profile
+ * that depends on either cannot be tabulated.
+ *
+ * @param accel The acceleration filter
+ */
+static void
+accelerator_update_profile_table(struct pointer_accelerator *accel)
+{
+	struct accel_profile_table *table = &accel->table;
+	double cap, lo, hi, step;
+	unsigned int i;
+
+	cap = accel->profile(&accel->base, NULL, ACCEL_TABLE_MAX_VELOCITY, 0);
+
+	/* Double the velocity until the profile is capped, then narrow it
+	 * down so the table doesn't waste entries on the flat part of the
+	 * curve. */
+	hi = ACCEL_TABLE_MIN_VELOCITY;
+	while (hi < ACCEL_TABLE_MAX_VELOCITY &&
+	       accel->profile(&accel->base, NULL, hi, 0) != cap)
+		hi *= 2;
+
+	lo = hi/2;
+	for (i = 0; i < 32; i++) {
+		double mid = (lo + hi)/2;
+
+		if (accel->profile(&accel->base, NULL, mid, 0) == cap)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	step = hi/ACCEL_TABLE_SIZE;
+	for (i = 0; i <= ACCEL_TABLE_SIZE; i++)
+		table->factors[i] = accel->profile(&accel->base,
+						   NULL,
+						   i * step,
+						   0);
+	/* For velocities that round up to the last entry */
+	table->factors[ACCEL_TABLE_SIZE + 1] = table->factors[ACCEL_TABLE_SIZE];
+
+	table->max_velocity = hi;
+	table->scale = ACCEL_TABLE_SIZE/hi;
+}
+
 /**
  * Apply the acceleration profile to the given velocity.
  *
@@ -323,11 +495,60 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
  *
  * @return A unitless acceleration factor, to be applied to the delta
  */
-static double
+static inline double
 acceleration_profile(struct pointer_accelerator *accel,
 		     void *data, double velocity, uint64_t time)
 {
-	return accel->profile(&accel->base, data, velocity, time);
+	const struct accel_profile_table *table = &accel->table;
+	double pos, frac;
+	unsigned int i;
+
+	if (velocity >= table->max_velocity)
+		return accel->profile(&accel->base, data, velocity, time);
+
+	/* Linear interpolation between the two closest entries */
+	pos = velocity * table->scale;
+	i = (unsigned int)pos;
+	frac = pos - i;
+
+	return table->factors[i] +
+		frac * (table->factors[i + 1] - table->factors[i]);
+}
+
+double
+filter_get_accel_factor(struct motion_filter *filter, double velocity)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+
+	assert(filter->interface->type == LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE);
+
+	return acceleration_profile(accel, NULL, velocity, 0);
+}
+
+bool
+filter_set_tracker_count(struct motion_filter *filter,
+			 unsigned int ntrackers)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	struct pointer_tracker *trackers;
+
+	assert(filter->interface->type == LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE);
+
+	if (ntrackers < 2)
+		return false;
+
+	trackers = calloc(ntrackers, sizeof *trackers);
+	if (!trackers)
+		return false;
+
+	free(accel->trackers);
+	accel->trackers = trackers;
+	accel->ntrackers = ntrackers;
+	accel->cur_tracker = 0;
+
+	return true;
 }
 
 /**
@@ -396,6 +617,45 @@ calculate_acceleration_factor(struct pointer_accelerator *accel,
 	return accel_factor;
 }
 
+/**
+ * Filter that uses the caller's velocity instead of the one calculated
+ * from the trackers. The trackers are still fed so filter_dispatch()
+ * works as usual afterwards.
+ *
+ * @param filter The acceleration filter
+ * @param unaccelerated The raw delta in the device's dpi
+ * @param velocity The velocity in units/us in the device's dpi
+ * @param data Caller-specific data
+ * @param time Current time in µs
+ *
+ * @return An accelerated tuple of coordinates representing accelerated
+ * motion, still in device units.
+ */
+static struct device_float_coords
+accelerator_filter_generic_velocity(struct motion_filter *filter,
+				    const struct device_float_coords *unaccelerated,
+				    double velocity,
+				    void *data, uint64_t time)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	double accel_value; /* unitless factor */
+	struct device_float_coords accelerated;
+
+	feed_trackers(accel, unaccelerated, time);
+	accel_value = calculate_acceleration(accel,
+					     data,
+					     velocity,
+					     accel->last_velocity,
+					     time);
+	accel->last_velocity = velocity;
+
+	accelerated.x = accel_value * unaccelerated->x;
+	accelerated.y = accel_value * unaccelerated->y;
+
+	return accelerated;
+}
+
 /**
  * Generic filter that calculates the acceleration factor and applies it to
  * the coordinates.
@@ -429,6 +689,58 @@ accelerator_filter_generic(struct motion_filter *filter,
 	return accelerated;
 }
 
+/**
+ * Batch version of accelerator_filter_generic(). The acceleration factors
+ * depend on the velocity and are calculated event by event, applying them
+ * is a separate loop the compiler can vectorize. dx/dy and x/y may be the
+ * same arrays.
+ *
+ * @param accel The acceleration filter
+ * @param count The number of deltas
+ * @param dx The raw x deltas in the device's dpi
+ * @param dy The raw y deltas in the device's dpi
+ * @param time The timestamps of the deltas in µs
+ * @param data Caller-specific data
+ * @param x Returns the accelerated x deltas, still in device units
+ * @param y Returns the accelerated y deltas, still in device units
+ */
+static void
+accelerator_filter_generic_batch(struct pointer_accelerator *accel,
+				 size_t count,
+				 const double *dx, const double *dy,
+				 const uint64_t *time,
+				 void *data,
+				 double *x, double *y)
+{
+	double factors[FILTER_BATCH_SIZE]; /* unitless factor */
+	size_t i, n;
+
+	while (count > 0) {
+		n = min(count, FILTER_BATCH_SIZE);
+
+		for (i = 0; i < n; i++) {
+			struct device_float_coords delta = { dx[i], dy[i] };
+
+			factors[i] = calculate_acceleration_factor(accel,
+								   &delta,
+								   data,
+								   time[i]);
+		}
+
+		for (i = 0; i < n; i++) {
+			x[i] = factors[i] * dx[i];
+			y[i] = factors[i] * dy[i];
+		}
+
+		count -= n;
+		dx += n;
+		dy += n;
+		time += n;
+		x += n;
+		y += n;
+	}
+}
+
 static struct normalized_coords
 accelerator_filter_post_normalized(struct motion_filter *filter,
 				   const struct device_float_coords *unaccelerated,
@@ -446,6 +758,39 @@ accelerator_filter_post_normalized(struct motion_filter *filter,
 	return normalize_for_dpi(&accelerated, accel->dpi);
 }
 
+static struct normalized_coords
+accelerator_filter_post_normalized_velocity(struct motion_filter *filter,
+					    const struct device_float_coords *unaccelerated,
+					    double velocity,
+					    void *data, uint64_t time)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	struct device_float_coords accelerated;
+
+	accelerated = accelerator_filter_generic_velocity(filter,
+							  unaccelerated,
+							  velocity,
+							  data,
+							  time);
+	return normalize_for_dpi(&accelerated, accel->dpi);
+}
+
+static void
+accelerator_filter_post_normalized_batch(struct motion_filter *filter,
+					 size_t count,
+					 const double *dx, const double *dy,
+					 const uint64_t *time,
+					 void *data,
+					 double *x, double *y)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+
+	accelerator_filter_generic_batch(accel, count, dx, dy, time, data, x, y);
+	normalize_for_dpi_batch(count, x, y, accel->dpi, x, y);
+}
+
 static struct normalized_coords
 accelerator_filter_pre_normalized(struct motion_filter *filter,
 				  const struct device_float_coords *unaccelerated,
@@ -471,6 +816,21 @@ accelerator_filter_pre_normalized(struct motion_filter *filter,
 	return normalized;
 }
 
+static void
+accelerator_filter_pre_normalized_batch(struct motion_filter *filter,
+					size_t count,
+					const double *dx, const double *dy,
+					const uint64_t *time,
+					void *data,
+					double *x, double *y)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+
+	normalize_for_dpi_batch(count, dx, dy, accel->dpi, x, y);
+	accelerator_filter_generic_batch(accel, count, x, y, time, data, x, y);
+}
+
 static struct normalized_coords
 accelerator_filter_unnormalized(struct motion_filter *filter,
 				const struct device_float_coords *unaccelerated,
@@ -489,6 +849,20 @@ accelerator_filter_unnormalized(struct motion_filter *filter,
 	return normalized;
 }
 
+static void
+accelerator_filter_unnormalized_batch(struct motion_filter *filter,
+				      size_t count,
+				      const double *dx, const double *dy,
+				      const uint64_t *time,
+				      void *data,
+				      double *x, double *y)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+
+	accelerator_filter_generic_batch(accel, count, dx, dy, time, data, x, y);
+}
+
 /**
  * Generic filter that does nothing beyond converting from the device's
  * native dpi into normalized coordinates.
@@ -588,6 +962,8 @@ touchpad_accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = TOUCHPAD_INCLINE;
 	filter->speed_adjustment = speed_adjustment;
 
+	accelerator_update_profile_table(accel_filter);
+
 	return true;
 }
 
@@ -617,17 +993,19 @@ accelerator_restart(struct motion_filter *filter,
 	unsigned int offset;
 	struct pointer_tracker *tracker;
 
-	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+	for (offset = 1; offset < accel->ntrackers; offset++) {
 		tracker = tracker_by_offset(accel, offset);
 		tracker->time = 0;
 		tracker->dir = 0;
-		tracker->delta.x = 0;
-		tracker->delta.y = 0;
+		tracker->position.x = 0;
+		tracker->position.y = 0;
 	}
 
 	tracker = tracker_by_offset(accel, 0);
 	tracker->time = time;
 	tracker->dir = UNDEFINED_DIRECTION;
+	tracker->position.x = 0;
+	tracker->position.y = 0;
 }
 
 static void
@@ -637,6 +1015,7 @@ accelerator_destroy(struct motion_filter *filter)
 		(struct pointer_accelerator *) filter;
 
 	free(accel->trackers);
+	free(accel->table.factors);
 	free(accel);
 }
 
@@ -665,6 +1044,9 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+
+	accelerator_update_profile_table(accel_filter);
+
 	return true;
 }
 
@@ -939,6 +1321,7 @@ trackpoint_accel_profile(struct motion_filter *filter,
 struct motion_filter_interface accelerator_interface = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_pre_normalized,
+	.filter_batch = accelerator_filter_pre_normalized_batch,
 	.filter_constant = accelerator_filter_noop,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
@@ -958,8 +1341,18 @@ create_default_filter(int dpi)
 
 	filter->trackers =
 		calloc(NUM_POINTER_TRACKERS, sizeof *filter->trackers);
+	filter->ntrackers = NUM_POINTER_TRACKERS;
 	filter->cur_tracker = 0;
 
+	filter->table.factors =
+		calloc(ACCEL_TABLE_SIZE + 2, sizeof *filter->table.factors);
+	if (!filter->trackers || !filter->table.factors) {
+		free(filter->trackers);
+		free(filter->table.factors);
+		free(filter);
+		return NULL;
+	}
+
 	filter->threshold = DEFAULT_THRESHOLD;
 	filter->accel = DEFAULT_ACCELERATION;
 	filter->incline = DEFAULT_INCLINE;
@@ -986,6 +1379,7 @@ create_pointer_accelerator_filter_linear(int dpi)
 struct motion_filter_interface accelerator_interface_low_dpi = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_unnormalized,
+	.filter_batch = accelerator_filter_unnormalized_batch,
 	.filter_constant = accelerator_filter_noop,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
@@ -1010,6 +1404,8 @@ create_pointer_accelerator_filter_linear_low_dpi(int dpi)
 struct motion_filter_interface accelerator_interface_touchpad = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_post_normalized,
+	.filter_velocity = accelerator_filter_post_normalized_velocity,
+	.filter_batch = accelerator_filter_post_normalized_batch,
 	.filter_constant = touchpad_constant_filter,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
@@ -1034,6 +1430,8 @@ create_pointer_accelerator_filter_touchpad(int dpi)
 struct motion_filter_interface accelerator_interface_x230 = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_x230,
+	.filter_velocity = NULL,
+	.filter_batch = NULL,
 	.filter_constant = accelerator_filter_constant_x230,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
@@ -1059,8 +1457,18 @@ create_pointer_accelerator_filter_lenovo_x230(int dpi)
 
 	filter->trackers =
 		calloc(NUM_POINTER_TRACKERS, sizeof *filter->trackers);
+	filter->ntrackers = NUM_POINTER_TRACKERS;
 	filter->cur_tracker = 0;
 
+	filter->table.factors =
+		calloc(ACCEL_TABLE_SIZE + 2, sizeof *filter->table.factors);
+	if (!filter->trackers || !filter->table.factors) {
+		free(filter->trackers);
+		free(filter->table.factors);
+		free(filter);
+		return NULL;
+	}
+
 	filter->threshold = X230_THRESHOLD;
 	filter->accel = X230_ACCELERATION; /* unitless factor */
 	filter->incline = X230_INCLINE; /* incline of the acceleration function */
@@ -1072,6 +1480,7 @@ create_pointer_accelerator_filter_lenovo_x230(int dpi)
 struct motion_filter_interface accelerator_interface_trackpoint = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_unnormalized,
+	.filter_batch = accelerator_filter_unnormalized_batch,
 	.filter_constant = accelerator_filter_noop,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
@@ -1116,6 +1525,25 @@ accelerator_filter_flat(struct motion_filter *filter,
 	return accelerated;
 }
 
+static void
+accelerator_filter_flat_batch(struct motion_filter *filter,
+			      size_t count,
+			      const double *dx, const double *dy,
+			      const uint64_t *time,
+			      void *data,
+			      double *x, double *y)
+{
+	struct pointer_accelerator_flat *accel_filter =
+		(struct pointer_accelerator_flat *)filter;
+	const double factor = accel_filter->factor; /* unitless factor */
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		x[i] = factor * dx[i];
+		y[i] = factor * dy[i];
+	}
+}
+
 static bool
 accelerator_set_speed_flat(struct motion_filter *filter,
 			   double speed_adjustment)
@@ -1148,6 +1576,7 @@ accelerator_destroy_flat(struct motion_filter *filter)
 struct motion_filter_interface accelerator_interface_flat = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT,
 	.filter = accelerator_filter_flat,
+	.filter_batch = accelerator_filter_flat_batch,
 	.filter_constant = accelerator_filter_noop,
 	.restart = NULL,
 	.destroy = accelerator_destroy_flat,
@@ -1169,6 +1598,9 @@ create_pointer_accelerator_filter_flat(int dpi)
 	return &filter->base;
 }
 
+/* see tablet_accelerator_filter_flat_pen() */
+#define TABLET_PEN_DPI_CONVERSION (96.0/25.4 * 2.5) /* unitless factor */
+
 static inline struct normalized_coords
 tablet_accelerator_filter_flat_mouse(struct tablet_accelerator_flat *filter,
 				     const struct device_float_coords *units)
@@ -1207,13 +1639,12 @@ tablet_accelerator_filter_flat_pen(struct tablet_accelerator_flat *filter,
 	 * is almost identical to the tablet mapped to screen in absolute
 	 * mode. Tested on a Intuos5, other tablets may vary.
 	 */
-       const double DPI_CONVERSION = 96.0/25.4 * 2.5; /* unitless factor */
        struct normalized_coords mm;
 
        mm.x = 1.0 * units->x/filter->xres;
        mm.y = 1.0 * units->y/filter->yres;
-       accelerated.x = mm.x * filter->factor * DPI_CONVERSION;
-       accelerated.y = mm.y * filter->factor * DPI_CONVERSION;
+       accelerated.x = mm.x * filter->factor * TABLET_PEN_DPI_CONVERSION;
+       accelerated.y = mm.y * filter->factor * TABLET_PEN_DPI_CONVERSION;
 
        return accelerated;
 }
@@ -1246,6 +1677,46 @@ tablet_accelerator_filter_flat(struct motion_filter *filter,
 	return accel;
 }
 
+static void
+tablet_accelerator_filter_flat_batch(struct motion_filter *filter,
+				     size_t count,
+				     const double *dx, const double *dy,
+				     const uint64_t *time,
+				     void *data,
+				     double *x, double *y)
+{
+	struct tablet_accelerator_flat *accel_filter =
+		(struct tablet_accelerator_flat *)filter;
+	struct libinput_tablet_tool *tool = (struct libinput_tablet_tool*)data;
+	const double factor = accel_filter->factor;
+	size_t i;
+
+	/* Same calculations as the _mouse and _pen functions above */
+	switch (libinput_tablet_tool_get_type(tool)) {
+	case LIBINPUT_TABLET_TOOL_TYPE_MOUSE:
+	case LIBINPUT_TABLET_TOOL_TYPE_LENS: {
+		const double xscale = accel_filter->xres_scale,
+			     yscale = accel_filter->yres_scale;
+
+		for (i = 0; i < count; i++) {
+			x[i] = dx[i] * xscale * factor;
+			y[i] = dy[i] * yscale * factor;
+		}
+		break;
+	}
+	default: {
+		const int xres = accel_filter->xres,
+			  yres = accel_filter->yres;
+
+		for (i = 0; i < count; i++) {
+			x[i] = 1.0 * dx[i]/xres * factor * TABLET_PEN_DPI_CONVERSION;
+			y[i] = 1.0 * dy[i]/yres * factor * TABLET_PEN_DPI_CONVERSION;
+		}
+		break;
+	}
+	}
+}
+
 static bool
 tablet_accelerator_set_speed(struct motion_filter *filter,
 			     double speed_adjustment)
@@ -1272,6 +1743,7 @@ tablet_accelerator_destroy(struct motion_filter *filter)
 struct motion_filter_interface accelerator_interface_tablet = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT,
 	.filter = tablet_accelerator_filter_flat,
+	.filter_batch = tablet_accelerator_filter_flat_batch,
 	.filter_constant = NULL,
 	.restart = NULL,
 	.destroy = tablet_accelerator_destroy,
@@ -1309,3 +1781,49 @@ create_pointer_accelerator_filter_tablet(int xres, int yres)
 
 	return &filter->base;
 }
+
+double
+filter_get_velocity(struct motion_filter *filter)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+
+	if (filter->interface->type != LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE)
+		return 0.0;
+
+	/* These filters feed 1000dpi-normalized data into the trackers */
+	if (filter->interface == &accelerator_interface ||
+	    filter->interface == &accelerator_interface_x230)
+		return accel->last_velocity * accel->dpi/DEFAULT_MOUSE_DPI;
+
+	return accel->last_velocity;
+}
+
+struct normalized_coords
+filter_predict_motion(const struct normalized_coords *delta,
+		      const struct device_float_coords *raw,
+		      const struct device_float_coords *velocity,
+		      const struct device_float_coords *acceleration,
+		      uint64_t horizon)
+{
+	struct normalized_coords predicted = { 0.0, 0.0 };
+	double h = horizon;
+	double raw_length, factor;
+
+	raw_length = hypot(raw->x, raw->y);
+	if (raw_length == 0.0 || horizon == 0)
+		return predicted;
+
+	/* accelerated units per raw unit, includes the normalization */
+	factor = hypot(delta->x, delta->y)/raw_length;
+
+	predicted.x += factor * velocity->x * h;
+	predicted.y += factor * velocity->y * h;
+
+	if (acceleration) {
+		predicted.x += factor * 0.5 * acceleration->x * h * h;
+		predicted.y += factor * 0.5 * acceleration->y * h * h;
+	}
+
+	return predicted;
+}
@@ -61,6 +61,59 @@ filter_dispatch(struct motion_filter *filter,
 		const struct device_float_coords *unaccelerated,
 		void *data, uint64_t time);
 
+/**
+ * Accelerate the given coordinates for a velocity the caller already
+ * knows, e.g. from a fit over the motion history of a touch. The filter
+ * uses this velocity instead of the one from its own motion trackers.
+ * Filters that don't use a velocity ignore it, this is then the same as
+ * filter_dispatch().
+ *
+ * @param filter The device's motion filter
+ * @param unaccelerated The unaccelerated delta in the device's dpi
+ * resolution, see filter_dispatch()
+ * @param velocity The velocity of the motion in units/us, in the same
+ * resolution as unaccelerated
+ * @param data Custom data
+ * @param time The time of the delta
+ *
+ * @return A set of normalized coordinates that can be used for pixel
+ * movement.
+ *
+ * @see filter_dispatch
+ */
+struct normalized_coords
+filter_dispatch_velocity(struct motion_filter *filter,
+			 const struct device_float_coords *unaccelerated,
+			 double velocity,
+			 void *data, uint64_t time);
+
+/**
+ * Accelerate a sequence of deltas, e.g. when events were queued up or
+ * when replaying a recording. The result is identical to calling
+ * filter_dispatch() for each delta in order, but the deltas and their
+ * results are passed as separate arrays for x and y so the filter can
+ * process them in bulk.
+ *
+ * @param filter The device's motion filter
+ * @param count The number of deltas
+ * @param dx The unaccelerated x deltas in the device's dpi resolution, see
+ * filter_dispatch()
+ * @param dy The unaccelerated y deltas in the device's dpi resolution
+ * @param time The time of each delta
+ * @param data Custom data, the same for all deltas
+ * @param x Returns the accelerated x deltas in normalized coordinates
+ * @param y Returns the accelerated y deltas in normalized coordinates
+ *
+ * @see filter_dispatch
+ */
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      size_t count,
+		      const double *dx, const double *dy,
+		      const uint64_t *time,
+		      void *data,
+		      double *x, double *y);
+
 /**
  * Apply constant motion filters, but no acceleration.
  *
@@ -98,6 +151,81 @@ filter_get_speed(struct motion_filter *filter);
 enum libinput_config_accel_profile
 filter_get_type(struct motion_filter *filter);
 
+/**
+ * Return the acceleration factor the filter applies at the given
+ * velocity. The factor is interpolated from a table of the filter's
+ * acceleration profile, built whenever the speed changes, and is within a
+ * small tolerance of the profile function itself. Where the profile has a
+ * step, the factor changes linearly across one table entry instead.
+ *
+ * This function may only be called for filters of type
+ * LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE.
+ *
+ * @param filter The device's motion filter
+ * @param velocity The velocity in device units/µs
+ *
+ * @return A unitless acceleration factor
+ */
+double
+filter_get_accel_factor(struct motion_filter *filter, double velocity);
+
+/**
+ * Set the number of motion events the filter keeps to calculate the
+ * velocity. The velocity is averaged over up to this many recent events,
+ * devices with a high event rate need more events to cover the same time
+ * span. The cost per event does not depend on the number of trackers.
+ *
+ * Changing the number of trackers discards the motion history.
+ *
+ * This function may only be called for filters of type
+ * LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE.
+ *
+ * @param filter The device's motion filter
+ * @param ntrackers The number of trackers, at least 2
+ *
+ * @return true on success or false if the number is invalid or the
+ * allocation failed
+ */
+bool
+filter_set_tracker_count(struct motion_filter *filter,
+			 unsigned int ntrackers);
+
+/**
+ * Return the velocity the filter used for the most recent motion event.
+ * This is a speed without a direction, the direction is that of the
+ * event's delta.
+ *
+ * Filters of a type other than LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE do
+ * not calculate a velocity and return 0.
+ *
+ * @param filter The device's motion filter
+ *
+ * @return The velocity in device units/µs
+ */
+double
+filter_get_velocity(struct motion_filter *filter);
+
+/**
+ * Extrapolate the accelerated motion horizon µs past a motion event. The
+ * velocity and acceleration are those of the unaccelerated motion, they
+ * are accelerated with the ratio between delta and raw.
+ *
+ * @param delta The accelerated delta
+ * @param raw The unaccelerated delta
+ * @param velocity The velocity in raw units/µs
+ * @param acceleration The acceleration in raw units/µs², may be NULL
+ * @param horizon The time to extrapolate for in µs
+ *
+ * @return The accelerated motion expected within horizon, not including
+ * delta
+ */
+struct normalized_coords
+filter_predict_motion(const struct normalized_coords *delta,
+		      const struct device_float_coords *raw,
+		      const struct device_float_coords *velocity,
+		      const struct device_float_coords *acceleration,
+		      uint64_t horizon);
+
 typedef double (*accel_profile_func_t)(struct motion_filter *filter,
 				       void *data,
 				       double velocity,
@@ -29,6 +29,8 @@
 
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 
 #include "linux/input.h"
 
@@ -107,16 +109,88 @@ struct libinput_interface_backend {
 				  const char *seat_name);
 };
 
+/* One free-list per libinput_event_* struct, see libinput.c */
+enum libinput_event_pool_type {
+	EVENT_POOL_DEVICE_NOTIFY,
+	EVENT_POOL_KEYBOARD,
+	EVENT_POOL_POINTER,
+	EVENT_POOL_TOUCH,
+	EVENT_POOL_GESTURE,
+	EVENT_POOL_TABLET_TOOL,
+	EVENT_POOL_TABLET_PAD,
+	EVENT_POOL_SWITCH,
+
+	EVENT_POOL_COUNT,
+};
+
+struct libinput_event_pool_entry;
+
+/* Lock-free queue of events between exactly one producer and one
+ * consumer thread */
+struct libinput_event_handoff {
+	struct libinput_event **slots;
+	unsigned int size; /* power of two */
+	unsigned int head; /* only written by the producer */
+	unsigned int tail; /* only written by the consumer */
+};
+
+struct libinput_event_pool {
+	struct libinput_event_pool_entry *free_list;
+	unsigned int nfree;
+};
+
+/* binary min-heap of armed timers, see timer.c */
+struct libinput_timer_heap {
+	struct libinput_timer **timers;
+	size_t count;
+	size_t size;
+	bool by_deadline; /* ordered by deadline instead of expiry */
+};
+
+struct libinput_timer_wheel;
+
 struct libinput {
 	int epoll_fd;
 	struct list source_destroy_list;
+	struct list source_pending_list; /* yielded with data left */
+	enum libinput_dispatch_mode dispatch_mode;
+
+	/* see libinput_start_input_thread() */
+	struct {
+		bool running;
+		bool stop;
+		bool stalled; /* events wait for space in the handoff */
+		pthread_t thread;
+		pthread_mutex_t lock; /* held by the thread while processing */
+		int wake_fd; /* eventfd, wakes up the input thread */
+		int notify_fd; /* eventfd, returned by libinput_get_fd() */
+		struct libinput_event_handoff events; /* to the caller */
+		struct libinput_event_handoff release; /* back to the thread */
+	} thread;
+
+	struct {
+		bool active;
+		unsigned int max_events; /* 0 for unlimited */
+		uint64_t deadline; /* 0 for none */
+		unsigned int nevents;
+	} dispatch_budget;
 
 	struct list seat_list;
 
 	struct {
-		struct list list;
+		/* armed timers, see timer.c */
+		enum libinput_timer_mode mode;
+		struct libinput_timer_heap expire_heap;
+		struct libinput_timer_heap deadline_heap;
+		struct libinput_timer_wheel *wheel; /* LIBINPUT_TIMER_MODE_WHEEL */
 		struct libinput_source *source;
 		int fd;
+		uint64_t fd_expire; /* 0 if the timerfd is disarmed */
+		bool in_handler; /* the timerfd is updated once afterwards */
+		bool slack_enabled; /* see libinput_set_timer_slack_enabled() */
+		uint64_t fd_updates;
+		uint64_t wakeups;
+		uint64_t expiries;
 	} timer;
 
 	struct libinput_event **events;
@@ -125,6 +199,42 @@ struct libinput {
 	size_t events_in;
 	size_t events_out;
 
+	struct libinput_event_pool event_pools[EVENT_POOL_COUNT];
+	struct {
+		uint64_t hits;
+		uint64_t misses;
+	} event_pool_stats;
+
+	/* LIBINPUT_EVENT_QUEUE_MODE_INLINE, events are stored by value in
+	 * fixed-size chunks, events_count is shared with the pointer ring */
+	struct {
+		bool enabled;
+		struct list chunks; /* chunks that are written or read */
+		struct list free_chunks;
+		unsigned int nfree_chunks;
+	} event_ring;
+
+	uint32_t event_coalesce; /* enum libinput_event_coalesce */
+	struct {
+		uint64_t pointer_motion;
+		uint64_t pointer_axis;
+		uint64_t tablet_tool_axis;
+	} coalesce_stats;
+
+	/* event types not queued, see libinput_set_event_type_enabled() */
+	unsigned char event_mask_disabled[NCHARS(LIBINPUT_EVENT_SWITCH_TOGGLE + 1)];
+	uint64_t events_masked;
+
+	unsigned int event_queue_limit; /* 0 for unlimited */
+	enum libinput_event_overflow_policy event_overflow_policy;
+	struct {
+		uint64_t high_water;
+		uint64_t dropped;
+	} event_queue_stats;
+
+	bool latency_tracking;
+	uint64_t prediction_horizon; /* max horizon in us, 0 if disabled */
+
 	struct list tool_list;
 
 	const struct libinput_interface *interface;
@@ -294,6 +404,7 @@ struct libinput_device_config {
 };
 
 struct libinput_device_group {
+	struct libinput *libinput;
 	int refcount;
 	void *user_data;
 	char *identifier; /* unique identifier or NULL for singletons */
@@ -309,6 +420,7 @@ struct libinput_device {
 	void *user_data;
 	int refcount;
 	struct libinput_device_config config;
+	struct list latency_list; /* struct libinput_latency_histogram */
 };
 
 enum libinput_tablet_tool_axis {
@@ -338,6 +450,7 @@ struct tablet_axes {
 };
 
 struct libinput_tablet_tool {
+	struct libinput *libinput;
 	struct list link;
 	uint32_t serial;
 	uint32_t tool_id;
@@ -354,6 +467,7 @@ struct libinput_tablet_tool {
 };
 
 struct libinput_tablet_pad_mode_group {
+	struct libinput *libinput;
 	struct libinput_device *device;
 	struct list link;
 	int refcount;
@@ -375,6 +489,8 @@ struct libinput_tablet_pad_mode_group {
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	bool in_ring; /* stored in libinput->event_ring */
+	uint64_t queued_time; /* 0 unless latency tracking is enabled */
 };
 
 struct libinput_event_listener {
@@ -435,6 +551,16 @@ void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source);
 
+void
+libinput_source_set_pending(struct libinput *libinput,
+			    struct libinput_source *source);
+
+bool
+libinput_dispatch_budget_exhausted(struct libinput *libinput);
+
+bool
+libinput_dispatch_should_yield(struct libinput *libinput);
+
 int
 open_restricted(struct libinput *libinput,
 		const char *path, int flags);
@@ -499,7 +625,9 @@ void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
 		      const struct normalized_coords *delta,
-		      const struct device_float_coords *raw);
+		      const struct device_float_coords *raw,
+		      const struct device_float_coords *velocity,
+		      const struct device_float_coords *acceleration);
 
 void
 pointer_notify_motion_absolute(struct libinput_device *device,
@@ -634,6 +762,32 @@ switch_notify_toggle(struct libinput_device *device,
 		     enum libinput_switch sw,
 		     enum libinput_switch_state state);
 
+/* Serialize calls from the caller's thread with the input thread, a no-op
+ * unless libinput_start_input_thread() was called */
+static inline void
+libinput_lock(struct libinput *libinput)
+{
+	if (libinput->thread.running)
+		pthread_mutex_lock(&libinput->thread.lock);
+}
+
+static inline void
+libinput_unlock(struct libinput *libinput)
+{
+	bool queued;
+
+	if (!libinput->thread.running)
+		return;
+
+	/* Events posted from the caller's thread, e.g. DEVICE_ADDED, are
+	 * only handed off by the input thread, wake it up */
+	queued = libinput->events_count > 0;
+	pthread_mutex_unlock(&libinput->thread.lock);
+
+	if (queued)
+		eventfd_write(libinput->thread.wake_fd, 1);
+}
+
 static inline uint64_t
 libinput_now(struct libinput *libinput)
 {
@@ -26,10 +26,14 @@
 
 #include <errno.h>
 #include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <assert.h>
 
@@ -73,6 +77,14 @@ ASSERT_INT_SIZE(enum libinput_config_click_method);
 ASSERT_INT_SIZE(enum libinput_config_middle_emulation_state);
 ASSERT_INT_SIZE(enum libinput_config_scroll_method);
 ASSERT_INT_SIZE(enum libinput_config_dwt_state);
+ASSERT_INT_SIZE(enum libinput_event_queue_mode);
+ASSERT_INT_SIZE(enum libinput_event_coalesce);
+ASSERT_INT_SIZE(enum libinput_event_overflow_policy);
+ASSERT_INT_SIZE(enum libinput_dispatch_mode);
+ASSERT_INT_SIZE(enum libinput_timer_mode);
+ASSERT_INT_SIZE(enum libinput_statistic);
+ASSERT_INT_SIZE(enum libinput_latency_stage);
+ASSERT_INT_SIZE(enum libinput_device_statistic);
 
 static inline bool
 check_event_type(struct libinput *libinput,
@@ -147,6 +159,8 @@ struct libinput_source {
 	void *user_data;
 	int fd;
 	struct list link;
+	bool pending;
+	struct list pending_link;
 };
 
 struct libinput_event_device_notify {
@@ -166,6 +180,8 @@ struct libinput_event_pointer {
 	uint64_t time;
 	struct normalized_coords delta;
 	struct device_float_coords delta_raw;
+	struct device_float_coords velocity; /* raw units/us */
+	struct device_float_coords acceleration; /* raw units/us^2 */
 	struct device_coords absolute;
 	struct discrete_coords discrete;
 	uint32_t button;
@@ -235,6 +251,401 @@ struct libinput_event_switch {
 	enum libinput_switch_state state;
 };
 
+/* Latency histograms use 4 buckets per power of two, the upper bound of
+ * a bucket is at most 25% larger than its lower bound. Latencies of
+ * 2^LATENCY_MAX_SHIFT us (~9.5h) and more go into the last bucket. */
+#define LATENCY_SUB_BUCKETS 4
+#define LATENCY_SUB_SHIFT 2
+#define LATENCY_MAX_SHIFT 35
+#define LATENCY_NBUCKETS ((LATENCY_MAX_SHIFT - 1) * LATENCY_SUB_BUCKETS)
+#define LATENCY_NSTAGES LIBINPUT_LATENCY_STAGE_TOTAL
+
+struct libinput_latency_histogram {
+	struct list link;
+	enum libinput_event_type type;
+	uint64_t count;
+	struct {
+		uint64_t max;
+		uint64_t buckets[LATENCY_NBUCKETS];
+	} stages[LATENCY_NSTAGES];
+};
+
+/* Destroyed events go onto a per-type free-list and are handed out again
+ * by the next notify call, so the common case doesn't need a malloc/free
+ * pair per event. The lists are capped so that a large burst of queued
+ * events doesn't pin that memory forever.
+ */
+#define EVENT_POOL_MAX_FREE 64
+
+struct libinput_event_pool_entry {
+	struct libinput_event_pool_entry *next;
+};
+
+static const size_t event_pool_sizes[EVENT_POOL_COUNT] = {
+	[EVENT_POOL_DEVICE_NOTIFY] = sizeof(struct libinput_event_device_notify),
+	[EVENT_POOL_KEYBOARD] = sizeof(struct libinput_event_keyboard),
+	[EVENT_POOL_POINTER] = sizeof(struct libinput_event_pointer),
+	[EVENT_POOL_TOUCH] = sizeof(struct libinput_event_touch),
+	[EVENT_POOL_GESTURE] = sizeof(struct libinput_event_gesture),
+	[EVENT_POOL_TABLET_TOOL] = sizeof(struct libinput_event_tablet_tool),
+	[EVENT_POOL_TABLET_PAD] = sizeof(struct libinput_event_tablet_pad),
+	[EVENT_POOL_SWITCH] = sizeof(struct libinput_event_switch),
+};
+
+static inline enum libinput_event_pool_type
+event_pool_type(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return EVENT_POOL_DEVICE_NOTIFY;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return EVENT_POOL_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return EVENT_POOL_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return EVENT_POOL_TOUCH;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return EVENT_POOL_TABLET_TOOL;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+		return EVENT_POOL_TABLET_PAD;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return EVENT_POOL_GESTURE;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return EVENT_POOL_SWITCH;
+	}
+
+	abort();
+}
+
+static void *
+libinput_event_pool_get(struct libinput *libinput,
+			enum libinput_event_pool_type type)
+{
+	struct libinput_event_pool *pool = &libinput->event_pools[type];
+	struct libinput_event_pool_entry *entry;
+
+	entry = pool->free_list;
+	if (!entry) {
+		libinput->event_pool_stats.misses++;
+		return zalloc(event_pool_sizes[type]);
+	}
+
+	pool->free_list = entry->next;
+	pool->nfree--;
+	libinput->event_pool_stats.hits++;
+
+	return entry;
+}
+
+static void
+libinput_event_pool_put(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	struct libinput_event_pool *pool;
+	struct libinput_event_pool_entry *entry;
+
+	pool = &libinput->event_pools[event_pool_type(event->type)];
+	if (pool->nfree >= EVENT_POOL_MAX_FREE) {
+		free(event);
+		return;
+	}
+
+	entry = (struct libinput_event_pool_entry *)event;
+	entry->next = pool->free_list;
+	pool->free_list = entry;
+	pool->nfree++;
+}
+
+static void
+libinput_event_pools_destroy(struct libinput *libinput)
+{
+	struct libinput_event_pool *pool;
+	struct libinput_event_pool_entry *entry;
+
+	ARRAY_FOR_EACH(libinput->event_pools, pool) {
+		while ((entry = pool->free_list)) {
+			pool->free_list = entry->next;
+			free(entry);
+		}
+		pool->nfree = 0;
+	}
+}
+
+/* In LIBINPUT_EVENT_QUEUE_MODE_INLINE, events are copied by value into
+ * fixed-size slots. Slots are grouped into chunks, new chunks are appended
+ * when the last one is full so the queue never has to be moved around.
+ * A chunk leaves the ring once all its slots were read and is recycled
+ * once the caller destroyed all the events in it.
+ */
+#define EVENT_RING_CHUNK_SLOTS 64
+#define EVENT_RING_MAX_FREE_CHUNKS 4
+
+union libinput_event_storage {
+	struct libinput_event base;
+	struct libinput_event_device_notify device_notify;
+	struct libinput_event_keyboard keyboard;
+	struct libinput_event_pointer pointer;
+	struct libinput_event_touch touch;
+	struct libinput_event_gesture gesture;
+	struct libinput_event_tablet_tool tablet_tool;
+	struct libinput_event_tablet_pad tablet_pad;
+	struct libinput_event_switch sw;
+};
+
+struct event_ring_chunk;
+
+struct event_ring_slot {
+	struct event_ring_chunk *chunk;
+	union libinput_event_storage event;
+};
+
+struct event_ring_chunk {
+	struct list link;
+	unsigned int nwritten;
+	unsigned int nread;
+	unsigned int nreleased;
+	struct event_ring_slot slots[EVENT_RING_CHUNK_SLOTS];
+};
+
+static struct event_ring_chunk *
+event_ring_new_chunk(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk;
+
+	if (list_empty(&libinput->event_ring.free_chunks)) {
+		chunk = zalloc(sizeof *chunk);
+		if (!chunk)
+			return NULL;
+	} else {
+		chunk = container_of(libinput->event_ring.free_chunks.next,
+				     struct event_ring_chunk,
+				     link);
+		list_remove(&chunk->link);
+		libinput->event_ring.nfree_chunks--;
+	}
+
+	chunk->nwritten = 0;
+	chunk->nread = 0;
+	chunk->nreleased = 0;
+	list_insert(libinput->event_ring.chunks.prev, &chunk->link);
+
+	return chunk;
+}
+
+static void
+event_ring_recycle_chunk(struct libinput *libinput,
+			 struct event_ring_chunk *chunk)
+{
+	if (libinput->event_ring.nfree_chunks >= EVENT_RING_MAX_FREE_CHUNKS) {
+		free(chunk);
+		return;
+	}
+
+	list_insert(&libinput->event_ring.free_chunks, &chunk->link);
+	libinput->event_ring.nfree_chunks++;
+}
+
+static struct libinput_event *
+event_ring_push(struct libinput *libinput,
+		const struct libinput_event *event,
+		size_t size)
+{
+	struct event_ring_chunk *chunk = NULL;
+	struct event_ring_slot *slot;
+
+	if (!list_empty(&libinput->event_ring.chunks))
+		chunk = container_of(libinput->event_ring.chunks.prev,
+				     struct event_ring_chunk,
+				     link);
+
+	if (!chunk || chunk->nwritten == EVENT_RING_CHUNK_SLOTS) {
+		chunk = event_ring_new_chunk(libinput);
+		if (!chunk)
+			return NULL;
+	}
+
+	slot = &chunk->slots[chunk->nwritten++];
+	slot->chunk = chunk;
+	memcpy(&slot->event, event, size);
+
+	return &slot->event.base;
+}
+
+static inline struct libinput_event *
+event_ring_peek(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk;
+
+	chunk = container_of(libinput->event_ring.chunks.next,
+			     struct event_ring_chunk,
+			     link);
+	assert(chunk->nread < chunk->nwritten);
+
+	return &chunk->slots[chunk->nread].event.base;
+}
+
+static struct libinput_event *
+event_ring_pop(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk;
+	struct event_ring_slot *slot;
+
+	chunk = container_of(libinput->event_ring.chunks.next,
+			     struct event_ring_chunk,
+			     link);
+	assert(chunk->nread < chunk->nwritten);
+
+	slot = &chunk->slots[chunk->nread++];
+	if (chunk->nread == EVENT_RING_CHUNK_SLOTS)
+		list_remove(&chunk->link);
+
+	return &slot->event.base;
+}
+
+static void
+event_ring_release(struct libinput *libinput,
+		   struct libinput_event *event)
+{
+	struct event_ring_slot *slot;
+	struct event_ring_chunk *chunk;
+
+	slot = container_of(event, struct event_ring_slot, event.base);
+	chunk = slot->chunk;
+
+	chunk->nreleased++;
+	if (chunk->nreleased == EVENT_RING_CHUNK_SLOTS)
+		event_ring_recycle_chunk(libinput, chunk);
+}
+
+/* Take the remaining chunks off the ring, any unused slots count as
+ * already destroyed. The queue must be empty. */
+static void
+event_ring_seal(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk, *tmp;
+
+	list_for_each_safe(chunk, tmp, &libinput->event_ring.chunks, link) {
+		assert(chunk->nread == chunk->nwritten);
+
+		list_remove(&chunk->link);
+		chunk->nreleased += EVENT_RING_CHUNK_SLOTS - chunk->nwritten;
+		chunk->nwritten = EVENT_RING_CHUNK_SLOTS;
+		chunk->nread = EVENT_RING_CHUNK_SLOTS;
+		if (chunk->nreleased == EVENT_RING_CHUNK_SLOTS)
+			event_ring_recycle_chunk(libinput, chunk);
+	}
+}
+
+static void
+event_ring_destroy(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk, *tmp;
+
+	event_ring_seal(libinput);
+
+	list_for_each_safe(chunk, tmp, &libinput->event_ring.free_chunks, link)
+		free(chunk);
+	list_init(&libinput->event_ring.free_chunks);
+	libinput->event_ring.nfree_chunks = 0;
+}
+
+static int
+event_handoff_init(struct libinput_event_handoff *handoff,
+		   unsigned int size)
+{
+	assert((size & (size - 1)) == 0);
+
+	handoff->slots = zalloc(size * sizeof *handoff->slots);
+	if (!handoff->slots)
+		return -1;
+
+	handoff->size = size;
+	handoff->head = 0;
+	handoff->tail = 0;
+
+	return 0;
+}
+
+static void
+event_handoff_destroy(struct libinput_event_handoff *handoff)
+{
+	free(handoff->slots);
+	handoff->slots = NULL;
+	handoff->size = 0;
+}
+
+static inline unsigned int
+event_handoff_count(struct libinput_event_handoff *handoff)
+{
+	return __atomic_load_n(&handoff->head, __ATOMIC_ACQUIRE) -
+	       __atomic_load_n(&handoff->tail, __ATOMIC_ACQUIRE);
+}
+
+/* Producer side only */
+static inline bool
+event_handoff_push(struct libinput_event_handoff *handoff,
+		   struct libinput_event *event)
+{
+	unsigned int head = handoff->head;
+	unsigned int tail = __atomic_load_n(&handoff->tail, __ATOMIC_ACQUIRE);
+
+	if (head - tail == handoff->size)
+		return false;
+
+	handoff->slots[head & (handoff->size - 1)] = event;
+	__atomic_store_n(&handoff->head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/* Consumer side only */
+static inline struct libinput_event *
+event_handoff_peek(struct libinput_event_handoff *handoff)
+{
+	unsigned int tail = handoff->tail;
+	unsigned int head = __atomic_load_n(&handoff->head, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+		return NULL;
+
+	return handoff->slots[tail & (handoff->size - 1)];
+}
+
+/* Consumer side only */
+static inline struct libinput_event *
+event_handoff_pop(struct libinput_event_handoff *handoff)
+{
+	struct libinput_event *event;
+
+	event = event_handoff_peek(handoff);
+	if (event)
+		__atomic_store_n(&handoff->tail,
+				 handoff->tail + 1,
+				 __ATOMIC_RELEASE);
+
+	return event;
+}
+
 LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
 static void
 libinput_default_log_func(struct libinput *libinput,
@@ -558,6 +969,48 @@ libinput_event_pointer_get_dy(struct libinput_event_pointer *event)
 	return event->delta.y;
 }
 
+static struct normalized_coords
+pointer_predict_motion(struct libinput_event_pointer *event,
+		       uint64_t target_time)
+{
+	struct libinput *libinput = libinput_event_get_context(&event->base);
+	uint64_t horizon = 0;
+
+	if (target_time > event->time)
+		horizon = min(target_time - event->time,
+			      libinput->prediction_horizon);
+
+	return filter_predict_motion(&event->delta,
+				     &event->delta_raw,
+				     &event->velocity,
+				     &event->acceleration,
+				     horizon);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_predicted_dx(struct libinput_event_pointer *event,
+					uint64_t target_time)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
+
+	return pointer_predict_motion(event, target_time).x;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_predicted_dy(struct libinput_event_pointer *event,
+					uint64_t target_time)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
+
+	return pointer_predict_motion(event, target_time).y;
+}
+
 LIBINPUT_EXPORT double
 libinput_event_pointer_get_dx_unaccelerated(
 	struct libinput_event_pointer *event)
@@ -1565,22 +2018,32 @@ libinput_tablet_tool_get_user_data(struct libinput_tablet_tool *tool)
 LIBINPUT_EXPORT struct libinput_tablet_tool *
 libinput_tablet_tool_ref(struct libinput_tablet_tool *tool)
 {
+	libinput_lock(tool->libinput);
 	tool->refcount++;
+	libinput_unlock(tool->libinput);
+
 	return tool;
 }
 
 LIBINPUT_EXPORT struct libinput_tablet_tool *
 libinput_tablet_tool_unref(struct libinput_tablet_tool *tool)
 {
+	struct libinput *libinput = tool->libinput;
+
+	libinput_lock(libinput);
+
 	assert(tool->refcount > 0);
 
 	tool->refcount--;
-	if (tool->refcount > 0)
-		return tool;
+	if (tool->refcount == 0) {
+		list_remove(&tool->link);
+		free(tool);
+		tool = NULL;
+	}
 
-	list_remove(&tool->link);
-	free(tool);
-	return NULL;
+	libinput_unlock(libinput);
+
+	return tool;
 }
 
 LIBINPUT_EXPORT struct libinput_event *
@@ -1674,6 +2137,44 @@ libinput_remove_source(struct libinput *libinput,
 	epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
 	source->fd = -1;
 	list_insert(&libinput->source_destroy_list, &source->link);
+
+	if (source->pending) {
+		list_remove(&source->pending_link);
+		source->pending = false;
+	}
+}
+
+/* The source stopped processing because the dispatch budget ran out but
+ * has more data buffered, it is resumed first by the next dispatch. The
+ * fd may not be readable anymore, so epoll can't be relied on. */
+void
+libinput_source_set_pending(struct libinput *libinput,
+			    struct libinput_source *source)
+{
+	if (source->pending)
+		return;
+
+	source->pending = true;
+	list_insert(libinput->source_pending_list.prev,
+		    &source->pending_link);
+}
+
+bool
+libinput_dispatch_budget_exhausted(struct libinput *libinput)
+{
+	if (!libinput->dispatch_budget.active)
+		return false;
+
+	if (libinput->dispatch_budget.max_events &&
+	    libinput->dispatch_budget.nevents >=
+	    libinput->dispatch_budget.max_events)
+		return true;
+
+	if (libinput->dispatch_budget.deadline &&
+	    libinput_now(libinput) >= libinput->dispatch_budget.deadline)
+		return true;
+
+	return false;
 }
 
 int
@@ -1682,6 +2183,8 @@ libinput_init(struct libinput *libinput,
 	      const struct libinput_interface_backend *interface_backend,
 	      void *user_data)
 {
+	pthread_mutexattr_t attr;
+
 	assert(interface->open_restricted != NULL);
 	assert(interface->close_restricted != NULL);
 
@@ -1702,12 +2205,27 @@ libinput_init(struct libinput *libinput,
 	libinput->interface_backend = interface_backend;
 	libinput->user_data = user_data;
 	libinput->refcount = 1;
+	libinput->event_overflow_policy = LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST;
+	libinput->dispatch_mode = LIBINPUT_DISPATCH_MODE_DRAIN;
+	libinput->thread.wake_fd = -1;
+	libinput->thread.notify_fd = -1;
 	list_init(&libinput->source_destroy_list);
+	list_init(&libinput->source_pending_list);
 	list_init(&libinput->seat_list);
 	list_init(&libinput->device_group_list);
 	list_init(&libinput->tool_list);
+	list_init(&libinput->event_ring.chunks);
+	list_init(&libinput->event_ring.free_chunks);
+
+	/* Public functions that take the lock are also called internally
+	 * by the input thread while it holds the lock */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&libinput->thread.lock, &attr);
+	pthread_mutexattr_destroy(&attr);
 
 	if (libinput_timer_subsys_init(libinput) != 0) {
+		pthread_mutex_destroy(&libinput->thread.lock);
 		free(libinput->events);
 		close(libinput->epoll_fd);
 		return -1;
@@ -1756,6 +2274,7 @@ libinput_unref(struct libinput *libinput)
 	if (libinput->refcount > 0)
 		return libinput;
 
+	libinput_stop_input_thread(libinput);
 	libinput_suspend(libinput);
 
 	libinput->interface_backend->destroy(libinput);
@@ -1763,7 +2282,11 @@ libinput_unref(struct libinput *libinput)
 	while ((event = libinput_get_event(libinput)))
 	       libinput_event_destroy(event);
 
+	event_handoff_destroy(&libinput->thread.events);
+	event_handoff_destroy(&libinput->thread.release);
 	free(libinput->events);
+	libinput_event_pools_destroy(libinput);
+	event_ring_destroy(libinput);
 
 	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
 		list_for_each_safe(device, next_device,
@@ -1788,6 +2311,7 @@ libinput_unref(struct libinput *libinput)
 	libinput_timer_subsys_destroy(libinput);
 	libinput_drop_destroyed_sources(libinput);
 	close(libinput->epoll_fd);
+	pthread_mutex_destroy(&libinput->thread.lock);
 	free(libinput);
 
 	return NULL;
@@ -1805,12 +2329,9 @@ libinput_event_tablet_pad_destroy(struct libinput_event_tablet_pad *event)
 	libinput_tablet_pad_mode_group_unref(event->mode_group);
 }
 
-LIBINPUT_EXPORT void
-libinput_event_destroy(struct libinput_event *event)
+static void
+libinput_event_unref_data(struct libinput_event *event)
 {
-	if (event == NULL)
-		return;
-
 	switch(event->type) {
 	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
 	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
@@ -1828,11 +2349,75 @@ libinput_event_destroy(struct libinput_event *event)
 	default:
 		break;
 	}
+}
+
+static void
+libinput_event_free(struct libinput *libinput,
+		    struct libinput_event *event)
+{
+	libinput_event_unref_data(event);
 
 	if (event->device)
 		libinput_device_unref(event->device);
 
-	free(event);
+	if (event->in_ring)
+		event_ring_release(libinput, event);
+	else
+		libinput_event_pool_put(libinput, event);
+}
+
+/* Called with the thread lock held, or by the input thread */
+static void
+libinput_thread_release_events(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	while ((event = event_handoff_pop(&libinput->thread.release)))
+		libinput_event_free(libinput, event);
+}
+
+/* Events are freed by the input thread, the caller hands them back
+ * through the release queue. If that queue is full, the caller takes
+ * the lock and frees the event itself. */
+static void
+libinput_thread_release_event(struct libinput *libinput,
+			      struct libinput_event *event)
+{
+	if (event_handoff_push(&libinput->thread.release, event))
+		return;
+
+	pthread_mutex_lock(&libinput->thread.lock);
+	libinput_thread_release_events(libinput);
+	libinput_event_free(libinput, event);
+	pthread_mutex_unlock(&libinput->thread.lock);
+}
+
+LIBINPUT_EXPORT void
+libinput_event_destroy(struct libinput_event *event)
+{
+	struct libinput *libinput;
+
+	if (event == NULL)
+		return;
+
+	libinput = libinput_event_get_context(event);
+
+	if (libinput->thread.running) {
+		libinput_thread_release_event(libinput, event);
+		return;
+	}
+
+	libinput_event_free(libinput, event);
+}
+
+LIBINPUT_EXPORT void
+libinput_events_destroy(struct libinput_event **events,
+			unsigned int nevents)
+{
+	unsigned int i;
+
+	for (i = 0; i < nevents; i++)
+		libinput_event_destroy(events[i]);
 }
 
 int
@@ -1879,7 +2464,10 @@ libinput_seat_init(struct libinput_seat *seat,
 LIBINPUT_EXPORT struct libinput_seat *
 libinput_seat_ref(struct libinput_seat *seat)
 {
+	libinput_lock(seat->libinput);
 	seat->refcount++;
+	libinput_unlock(seat->libinput);
+
 	return seat;
 }
 
@@ -1895,14 +2483,20 @@ libinput_seat_destroy(struct libinput_seat *seat)
 LIBINPUT_EXPORT struct libinput_seat *
 libinput_seat_unref(struct libinput_seat *seat)
 {
+	struct libinput *libinput = seat->libinput;
+
+	libinput_lock(libinput);
+
 	assert(seat->refcount > 0);
 	seat->refcount--;
 	if (seat->refcount == 0) {
 		libinput_seat_destroy(seat);
-		return NULL;
-	} else {
-		return seat;
+		seat = NULL;
 	}
+
+	libinput_unlock(libinput);
+
+	return seat;
 }
 
 LIBINPUT_EXPORT void
@@ -1942,53 +2536,94 @@ libinput_device_init(struct libinput_device *device,
 	device->seat = seat;
 	device->refcount = 1;
 	list_init(&device->event_listeners);
+	list_init(&device->latency_list);
 }
 
 LIBINPUT_EXPORT struct libinput_device *
 libinput_device_ref(struct libinput_device *device)
 {
+	struct libinput *libinput = device->seat->libinput;
+
+	libinput_lock(libinput);
 	device->refcount++;
+	libinput_unlock(libinput);
+
 	return device;
 }
 
 static void
 libinput_device_destroy(struct libinput_device *device)
 {
+	struct libinput_latency_histogram *h, *tmp;
+
 	assert(list_empty(&device->event_listeners));
+
+	list_for_each_safe(h, tmp, &device->latency_list, link)
+		free(h);
+
 	evdev_device_destroy(evdev_device(device));
 }
 
 LIBINPUT_EXPORT struct libinput_device *
 libinput_device_unref(struct libinput_device *device)
 {
-	assert(device->refcount > 0);
-	device->refcount--;
+	struct libinput *libinput = device->seat->libinput;
+
+	libinput_lock(libinput);
+
+	assert(device->refcount > 0);
+	device->refcount--;
 	if (device->refcount == 0) {
 		libinput_device_destroy(device);
-		return NULL;
-	} else {
-		return device;
+		device = NULL;
 	}
+
+	libinput_unlock(libinput);
+
+	return device;
 }
 
 LIBINPUT_EXPORT int
 libinput_get_fd(struct libinput *libinput)
 {
+	if (libinput->thread.running)
+		return libinput->thread.notify_fd;
+
 	return libinput->epoll_fd;
 }
 
-LIBINPUT_EXPORT int
-libinput_dispatch(struct libinput *libinput)
+static int
+libinput_dispatch_sources(struct libinput *libinput)
 {
 	struct libinput_source *source;
 	struct epoll_event ep[32];
-	int i, count;
+	int i, j, count;
+
+	/* Sources interrupted by the previous budget go first, in the
+	 * order they were interrupted. A source that runs out of budget
+	 * again moves to the back of the list. The budget is checked after
+	 * each source so every call makes progress. */
+	while (!list_empty(&libinput->source_pending_list)) {
+		source = container_of(libinput->source_pending_list.next,
+				      struct libinput_source,
+				      pending_link);
+		list_remove(&source->pending_link);
+		source->pending = false;
+
+		source->dispatch(source->user_data);
+
+		if (libinput_dispatch_budget_exhausted(libinput))
+			return 0;
+	}
 
 	count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
 	if (count < 0)
 		return -errno;
 
 	for (i = 0; i < count; ++i) {
+		if (i > 0 && libinput_dispatch_budget_exhausted(libinput))
+			break;
+
 		source = ep[i].data.ptr;
 		if (source->fd == -1)
 			continue;
@@ -1996,11 +2631,145 @@ libinput_dispatch(struct libinput *libinput)
 		source->dispatch(source->user_data);
 	}
 
-	libinput_drop_destroyed_sources(libinput);
+	/* Sources we didn't get to go ahead of any source interrupted
+	 * during this call */
+	for (j = count - 1; j >= i; j--) {
+		source = ep[j].data.ptr;
+		if (source->fd == -1 || source->pending)
+			continue;
+
+		source->pending = true;
+		list_insert(&libinput->source_pending_list,
+			    &source->pending_link);
+	}
+
+	return 0;
+}
+
+/* Every ready source processes one frame per round, then newly
+ * readable sources join the back of the queue */
+static int
+libinput_dispatch_round_robin(struct libinput *libinput)
+{
+	struct libinput_source *source;
+	struct epoll_event ep[32];
+	unsigned int nsources;
+	int i, count;
+
+	while (true) {
+		count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
+		if (count < 0)
+			return -errno;
+
+		for (i = 0; i < count; ++i) {
+			source = ep[i].data.ptr;
+			if (source->fd == -1)
+				continue;
+
+			libinput_source_set_pending(libinput, source);
+		}
+
+		if (list_empty(&libinput->source_pending_list))
+			break;
+
+		nsources = 0;
+		list_for_each(source, &libinput->source_pending_list, pending_link)
+			nsources++;
+
+		while (nsources-- > 0 &&
+		       !list_empty(&libinput->source_pending_list)) {
+			source = container_of(libinput->source_pending_list.next,
+					      struct libinput_source,
+					      pending_link);
+			list_remove(&source->pending_link);
+			source->pending = false;
+
+			source->dispatch(source->user_data);
+
+			if (libinput_dispatch_budget_exhausted(libinput))
+				return 0;
+		}
+	}
+
+	return 0;
+}
+
+/* Sources call this at the end of each frame to find out whether to
+ * stop and let other sources run. A source that yields must register
+ * itself with libinput_source_set_pending(). */
+bool
+libinput_dispatch_should_yield(struct libinput *libinput)
+{
+	return libinput->dispatch_mode == LIBINPUT_DISPATCH_MODE_ROUND_ROBIN ||
+	       libinput_dispatch_budget_exhausted(libinput);
+}
+
+static inline int
+libinput_dispatch_all(struct libinput *libinput)
+{
+	if (libinput->dispatch_mode == LIBINPUT_DISPATCH_MODE_ROUND_ROBIN)
+		return libinput_dispatch_round_robin(libinput);
+
+	return libinput_dispatch_sources(libinput);
+}
+
+/* With an input thread, the caller's dispatch only resets the eventfd
+ * returned by libinput_get_fd() */
+static inline int
+libinput_thread_dispatch(struct libinput *libinput)
+{
+	eventfd_t discard;
+
+	if (eventfd_read(libinput->thread.notify_fd, &discard) < 0 &&
+	    errno != EAGAIN)
+		return -errno;
 
 	return 0;
 }
 
+LIBINPUT_EXPORT int
+libinput_dispatch(struct libinput *libinput)
+{
+	int rc;
+
+	if (libinput->thread.running)
+		return libinput_thread_dispatch(libinput);
+
+	libinput->dispatch_budget.active = false;
+
+	rc = libinput_dispatch_all(libinput);
+
+	libinput_drop_destroyed_sources(libinput);
+
+	return rc;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_with_budget(struct libinput *libinput,
+			      unsigned int max_events,
+			      uint64_t deadline_usec)
+{
+	int rc;
+
+	if (libinput->thread.running)
+		return libinput_thread_dispatch(libinput);
+
+	libinput->dispatch_budget.active = true;
+	libinput->dispatch_budget.max_events = max_events;
+	libinput->dispatch_budget.deadline = deadline_usec;
+	libinput->dispatch_budget.nevents = 0;
+
+	rc = libinput_dispatch_all(libinput);
+	if (rc == 0 && libinput_dispatch_budget_exhausted(libinput))
+		rc = 1;
+
+	libinput->dispatch_budget.active = false;
+
+	libinput_drop_destroyed_sources(libinput);
+
+	return rc;
+}
+
 void
 libinput_device_init_event_listener(struct libinput_event_listener *listener)
 {
@@ -2076,6 +2845,8 @@ init_event_base(struct libinput_event *event,
 {
 	event->type = type;
 	event->device = device;
+	event->in_ring = false;
+	event->queued_time = 0;
 }
 
 static void
@@ -2118,29 +2889,21 @@ post_device_event(struct libinput_device *device,
 void
 notify_added_device(struct libinput_device *device)
 {
-	struct libinput_event_device_notify *added_device_event;
-
-	added_device_event = zalloc(sizeof *added_device_event);
-	if (!added_device_event)
-		return;
+	struct libinput_event_device_notify added_device_event;
 
 	post_base_event(device,
 			LIBINPUT_EVENT_DEVICE_ADDED,
-			&added_device_event->base);
+			&added_device_event.base);
 }
 
 void
 notify_removed_device(struct libinput_device *device)
 {
-	struct libinput_event_device_notify *removed_device_event;
-
-	removed_device_event = zalloc(sizeof *removed_device_event);
-	if (!removed_device_event)
-		return;
+	struct libinput_event_device_notify removed_device_event;
 
 	post_base_event(device,
 			LIBINPUT_EVENT_DEVICE_REMOVED,
-			&removed_device_event->base);
+			&removed_device_event.base);
 }
 
 static inline bool
@@ -2190,19 +2953,15 @@ keyboard_notify_key(struct libinput_device *device,
 		    uint32_t key,
 		    enum libinput_key_state state)
 {
-	struct libinput_event_keyboard *key_event;
+	struct libinput_event_keyboard key_event;
 	uint32_t seat_key_count;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
-	key_event = zalloc(sizeof *key_event);
-	if (!key_event)
-		return;
-
 	seat_key_count = update_seat_key_count(device->seat, key, state);
 
-	*key_event = (struct libinput_event_keyboard) {
+	key_event = (struct libinput_event_keyboard) {
 		.time = time,
 		.key = key,
 		.state = state,
@@ -2211,33 +2970,38 @@ keyboard_notify_key(struct libinput_device *device,
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_KEYBOARD_KEY,
-			  &key_event->base);
+			  &key_event.base);
 }
 
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
 		      const struct normalized_coords *delta,
-		      const struct device_float_coords *raw)
+		      const struct device_float_coords *raw,
+		      const struct device_float_coords *velocity,
+		      const struct device_float_coords *acceleration)
 {
-	struct libinput_event_pointer *motion_event;
+	struct libinput_event_pointer motion_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_event = zalloc(sizeof *motion_event);
-	if (!motion_event)
-		return;
-
-	*motion_event = (struct libinput_event_pointer) {
+	motion_event = (struct libinput_event_pointer) {
 		.time = time,
 		.delta = *delta,
 		.delta_raw = *raw,
 	};
 
+	if (device->seat->libinput->prediction_horizon != 0) {
+		if (velocity)
+			motion_event.velocity = *velocity;
+		if (acceleration)
+			motion_event.acceleration = *acceleration;
+	}
+
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION,
-			  &motion_event->base);
+			  &motion_event.base);
 }
 
 void
@@ -2245,23 +3009,19 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 			       uint64_t time,
 			       const struct device_coords *point)
 {
-	struct libinput_event_pointer *motion_absolute_event;
+	struct libinput_event_pointer motion_absolute_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
-	if (!motion_absolute_event)
-		return;
-
-	*motion_absolute_event = (struct libinput_event_pointer) {
+	motion_absolute_event = (struct libinput_event_pointer) {
 		.time = time,
 		.absolute = *point,
 	};
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
-			  &motion_absolute_event->base);
+			  &motion_absolute_event.base);
 }
 
 void
@@ -2270,21 +3030,17 @@ pointer_notify_button(struct libinput_device *device,
 		      int32_t button,
 		      enum libinput_button_state state)
 {
-	struct libinput_event_pointer *button_event;
+	struct libinput_event_pointer button_event;
 	int32_t seat_button_count;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
 
-	*button_event = (struct libinput_event_pointer) {
+	button_event = (struct libinput_event_pointer) {
 		.time = time,
 		.button = button,
 		.state = state,
@@ -2293,7 +3049,7 @@ pointer_notify_button(struct libinput_device *device,
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_BUTTON,
-			  &button_event->base);
+			  &button_event.base);
 }
 
 void
@@ -2304,16 +3060,12 @@ pointer_notify_axis(struct libinput_device *device,
 		    const struct normalized_coords *delta,
 		    const struct discrete_coords *discrete)
 {
-	struct libinput_event_pointer *axis_event;
+	struct libinput_event_pointer axis_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	axis_event = zalloc(sizeof *axis_event);
-	if (!axis_event)
-		return;
-
-	*axis_event = (struct libinput_event_pointer) {
+	axis_event = (struct libinput_event_pointer) {
 		.time = time,
 		.delta = *delta,
 		.source = source,
@@ -2323,7 +3075,7 @@ pointer_notify_axis(struct libinput_device *device,
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_AXIS,
-			  &axis_event->base);
+			  &axis_event.base);
 }
 
 void
@@ -2333,16 +3085,12 @@ touch_notify_touch_down(struct libinput_device *device,
 			int32_t seat_slot,
 			const struct device_coords *point)
 {
-	struct libinput_event_touch *touch_event;
+	struct libinput_event_touch touch_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
-	if (!touch_event)
-		return;
-
-	*touch_event = (struct libinput_event_touch) {
+	touch_event = (struct libinput_event_touch) {
 		.time = time,
 		.slot = slot,
 		.seat_slot = seat_slot,
@@ -2351,7 +3099,7 @@ touch_notify_touch_down(struct libinput_device *device,
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_DOWN,
-			  &touch_event->base);
+			  &touch_event.base);
 }
 
 void
@@ -2361,16 +3109,12 @@ touch_notify_touch_motion(struct libinput_device *device,
 			  int32_t seat_slot,
 			  const struct device_coords *point)
 {
-	struct libinput_event_touch *touch_event;
+	struct libinput_event_touch touch_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
-	if (!touch_event)
-		return;
-
-	*touch_event = (struct libinput_event_touch) {
+	touch_event = (struct libinput_event_touch) {
 		.time = time,
 		.slot = slot,
 		.seat_slot = seat_slot,
@@ -2379,7 +3123,7 @@ touch_notify_touch_motion(struct libinput_device *device,
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_MOTION,
-			  &touch_event->base);
+			  &touch_event.base);
 }
 
 void
@@ -2388,16 +3132,12 @@ touch_notify_touch_up(struct libinput_device *device,
 		      int32_t slot,
 		      int32_t seat_slot)
 {
-	struct libinput_event_touch *touch_event;
+	struct libinput_event_touch touch_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
-	if (!touch_event)
-		return;
-
-	*touch_event = (struct libinput_event_touch) {
+	touch_event = (struct libinput_event_touch) {
 		.time = time,
 		.slot = slot,
 		.seat_slot = seat_slot,
@@ -2405,29 +3145,25 @@ touch_notify_touch_up(struct libinput_device *device,
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_UP,
-			  &touch_event->base);
+			  &touch_event.base);
 }
 
 void
 touch_notify_frame(struct libinput_device *device,
 		   uint64_t time)
 {
-	struct libinput_event_touch *touch_event;
+	struct libinput_event_touch touch_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
-	if (!touch_event)
-		return;
-
-	*touch_event = (struct libinput_event_touch) {
+	touch_event = (struct libinput_event_touch) {
 		.time = time,
 	};
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_FRAME,
-			  &touch_event->base);
+			  &touch_event.base);
 }
 
 void
@@ -2438,13 +3174,9 @@ tablet_notify_axis(struct libinput_device *device,
 		   unsigned char *changed_axes,
 		   const struct tablet_axes *axes)
 {
-	struct libinput_event_tablet_tool *axis_event;
+	struct libinput_event_tablet_tool axis_event;
 
-	axis_event = zalloc(sizeof *axis_event);
-	if (!axis_event)
-		return;
-
-	*axis_event = (struct libinput_event_tablet_tool) {
+	axis_event = (struct libinput_event_tablet_tool) {
 		.time = time,
 		.tool = libinput_tablet_tool_ref(tool),
 		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
@@ -2452,14 +3184,14 @@ tablet_notify_axis(struct libinput_device *device,
 		.axes = *axes,
 	};
 
-	memcpy(axis_event->changed_axes,
+	memcpy(axis_event.changed_axes,
 	       changed_axes,
-	       sizeof(axis_event->changed_axes));
+	       sizeof(axis_event.changed_axes));
 
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_TOOL_AXIS,
-			  &axis_event->base);
+			  &axis_event.base);
 }
 
 void
@@ -2470,27 +3202,23 @@ tablet_notify_proximity(struct libinput_device *device,
 			unsigned char *changed_axes,
 			const struct tablet_axes *axes)
 {
-	struct libinput_event_tablet_tool *proximity_event;
-
-	proximity_event = zalloc(sizeof *proximity_event);
-	if (!proximity_event)
-		return;
+	struct libinput_event_tablet_tool proximity_event;
 
-	*proximity_event = (struct libinput_event_tablet_tool) {
+	proximity_event = (struct libinput_event_tablet_tool) {
 		.time = time,
 		.tool = libinput_tablet_tool_ref(tool),
 		.tip_state = LIBINPUT_TABLET_TOOL_TIP_UP,
 		.proximity_state = proximity_state,
 		.axes = *axes,
 	};
-	memcpy(proximity_event->changed_axes,
+	memcpy(proximity_event.changed_axes,
 	       changed_axes,
-	       sizeof(proximity_event->changed_axes));
+	       sizeof(proximity_event.changed_axes));
 
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
-			  &proximity_event->base);
+			  &proximity_event.base);
 }
 
 void
@@ -2501,27 +3229,23 @@ tablet_notify_tip(struct libinput_device *device,
 		  unsigned char *changed_axes,
 		  const struct tablet_axes *axes)
 {
-	struct libinput_event_tablet_tool *tip_event;
+	struct libinput_event_tablet_tool tip_event;
 
-	tip_event = zalloc(sizeof *tip_event);
-	if (!tip_event)
-		return;
-
-	*tip_event = (struct libinput_event_tablet_tool) {
+	tip_event = (struct libinput_event_tablet_tool) {
 		.time = time,
 		.tool = libinput_tablet_tool_ref(tool),
 		.tip_state = tip_state,
 		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
 		.axes = *axes,
 	};
-	memcpy(tip_event->changed_axes,
+	memcpy(tip_event.changed_axes,
 	       changed_axes,
-	       sizeof(tip_event->changed_axes));
+	       sizeof(tip_event.changed_axes));
 
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_TOOL_TIP,
-			  &tip_event->base);
+			  &tip_event.base);
 }
 
 void
@@ -2533,18 +3257,14 @@ tablet_notify_button(struct libinput_device *device,
 		     int32_t button,
 		     enum libinput_button_state state)
 {
-	struct libinput_event_tablet_tool *button_event;
+	struct libinput_event_tablet_tool button_event;
 	int32_t seat_button_count;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
 
-	*button_event = (struct libinput_event_tablet_tool) {
+	button_event = (struct libinput_event_tablet_tool) {
 		.time = time,
 		.tool = libinput_tablet_tool_ref(tool),
 		.button = button,
@@ -2558,7 +3278,7 @@ tablet_notify_button(struct libinput_device *device,
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
-			  &button_event->base);
+			  &button_event.base);
 }
 
 void
@@ -2568,16 +3288,12 @@ tablet_pad_notify_button(struct libinput_device *device,
 			 enum libinput_button_state state,
 			 struct libinput_tablet_pad_mode_group *group)
 {
-	struct libinput_event_tablet_pad *button_event;
+	struct libinput_event_tablet_pad button_event;
 	unsigned int mode;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
-	*button_event = (struct libinput_event_tablet_pad) {
+	button_event = (struct libinput_event_tablet_pad) {
 		.time = time,
 		.button.number = button,
 		.button.state = state,
@@ -2588,7 +3304,7 @@ tablet_pad_notify_button(struct libinput_device *device,
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_PAD_BUTTON,
-			  &button_event->base);
+			  &button_event.base);
 }
 
 void
@@ -2599,16 +3315,12 @@ tablet_pad_notify_ring(struct libinput_device *device,
 		       enum libinput_tablet_pad_ring_axis_source source,
 		       struct libinput_tablet_pad_mode_group *group)
 {
-	struct libinput_event_tablet_pad *ring_event;
+	struct libinput_event_tablet_pad ring_event;
 	unsigned int mode;
 
-	ring_event = zalloc(sizeof *ring_event);
-	if (!ring_event)
-		return;
-
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
-	*ring_event = (struct libinput_event_tablet_pad) {
+	ring_event = (struct libinput_event_tablet_pad) {
 		.time = time,
 		.ring.number = number,
 		.ring.position = value,
@@ -2620,7 +3332,7 @@ tablet_pad_notify_ring(struct libinput_device *device,
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_PAD_RING,
-			  &ring_event->base);
+			  &ring_event.base);
 }
 
 void
@@ -2631,16 +3343,12 @@ tablet_pad_notify_strip(struct libinput_device *device,
 			enum libinput_tablet_pad_strip_axis_source source,
 			struct libinput_tablet_pad_mode_group *group)
 {
-	struct libinput_event_tablet_pad *strip_event;
+	struct libinput_event_tablet_pad strip_event;
 	unsigned int mode;
 
-	strip_event = zalloc(sizeof *strip_event);
-	if (!strip_event)
-		return;
-
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
-	*strip_event = (struct libinput_event_tablet_pad) {
+	strip_event = (struct libinput_event_tablet_pad) {
 		.time = time,
 		.strip.number = number,
 		.strip.position = value,
@@ -2652,7 +3360,7 @@ tablet_pad_notify_strip(struct libinput_device *device,
 	post_device_event(device,
 			  time,
 			  LIBINPUT_EVENT_TABLET_PAD_STRIP,
-			  &strip_event->base);
+			  &strip_event.base);
 }
 
 static void
@@ -2666,16 +3374,12 @@ gesture_notify(struct libinput_device *device,
 	       double scale,
 	       double angle)
 {
-	struct libinput_event_gesture *gesture_event;
+	struct libinput_event_gesture gesture_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
 		return;
 
-	gesture_event = zalloc(sizeof *gesture_event);
-	if (!gesture_event)
-		return;
-
-	*gesture_event = (struct libinput_event_gesture) {
+	gesture_event = (struct libinput_event_gesture) {
 		.time = time,
 		.finger_count = finger_count,
 		.cancelled = cancelled,
@@ -2685,162 +3389,1331 @@ gesture_notify(struct libinput_device *device,
 		.angle = angle,
 	};
 
-	post_device_event(device, time, type,
-			  &gesture_event->base);
+	post_device_event(device, time, type,
+			  &gesture_event.base);
+}
+
+void
+gesture_notify_swipe(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_event_type type,
+		     int finger_count,
+		     const struct normalized_coords *delta,
+		     const struct normalized_coords *unaccel)
+{
+	gesture_notify(device, time, type, finger_count, 0, delta, unaccel,
+		       0.0, 0.0);
+}
+
+void
+gesture_notify_swipe_end(struct libinput_device *device,
+			 uint64_t time,
+			 int finger_count,
+			 int cancelled)
+{
+	const struct normalized_coords zero = { 0.0, 0.0 };
+
+	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_SWIPE_END,
+		       finger_count, cancelled, &zero, &zero, 0.0, 0.0);
+}
+
+void
+gesture_notify_pinch(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_event_type type,
+		     int finger_count,
+		     const struct normalized_coords *delta,
+		     const struct normalized_coords *unaccel,
+		     double scale,
+		     double angle)
+{
+	gesture_notify(device, time, type, finger_count, 0,
+		       delta, unaccel, scale, angle);
+}
+
+void
+gesture_notify_pinch_end(struct libinput_device *device,
+			 uint64_t time,
+			 int finger_count,
+			 double scale,
+			 int cancelled)
+{
+	const struct normalized_coords zero = { 0.0, 0.0 };
+
+	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_PINCH_END,
+		       finger_count, cancelled, &zero, &zero, scale, 0.0);
+}
+
+void
+switch_notify_toggle(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_switch sw,
+		     enum libinput_switch_state state)
+{
+	struct libinput_event_switch switch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
+		return;
+
+	switch_event = (struct libinput_event_switch) {
+		.time = time,
+		.sw = sw,
+		.state = state,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_SWITCH_TOGGLE,
+			  &switch_event.base);
+}
+
+static inline struct libinput_event *
+event_queue_last(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk;
+	size_t last;
+
+	if (libinput->events_count == 0)
+		return NULL;
+
+	if (libinput->event_ring.enabled) {
+		chunk = container_of(libinput->event_ring.chunks.prev,
+				     struct event_ring_chunk,
+				     link);
+		return &chunk->slots[chunk->nwritten - 1].event.base;
+	}
+
+	last = (libinput->events_in + libinput->events_len - 1) %
+		libinput->events_len;
+
+	return libinput->events[last];
+}
+
+static inline bool
+pointer_axis_is_stop(const struct libinput_event_pointer *event)
+{
+	const uint32_t h = AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+	const uint32_t v = AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+
+	return ((event->axes & h) && event->delta.x == 0.0) ||
+	       ((event->axes & v) && event->delta.y == 0.0);
+}
+
+static bool
+coalesce_pointer_motion(struct libinput_event_pointer *queued,
+			const struct libinput_event_pointer *event)
+{
+	queued->time = event->time;
+	queued->delta.x += event->delta.x;
+	queued->delta.y += event->delta.y;
+	queued->delta_raw.x += event->delta_raw.x;
+	queued->delta_raw.y += event->delta_raw.y;
+	/* the most recent motion is the best estimate for prediction */
+	queued->velocity = event->velocity;
+	queued->acceleration = event->acceleration;
+
+	return true;
+}
+
+static bool
+coalesce_pointer_axis(struct libinput_event_pointer *queued,
+		      const struct libinput_event_pointer *event)
+{
+	/* Axis stop events carry a 0 value and must stay separate */
+	if (queued->source != event->source ||
+	    pointer_axis_is_stop(queued) ||
+	    pointer_axis_is_stop(event))
+		return false;
+
+	queued->time = event->time;
+	queued->axes |= event->axes;
+	queued->delta.x += event->delta.x;
+	queued->delta.y += event->delta.y;
+	queued->discrete.x += event->discrete.x;
+	queued->discrete.y += event->discrete.y;
+
+	return true;
+}
+
+static bool
+coalesce_tablet_tool_axis(struct libinput_event_tablet_tool *queued,
+			  const struct libinput_event_tablet_tool *event)
+{
+	struct tablet_axes axes = event->axes;
+	size_t i;
+
+	if (queued->tool != event->tool ||
+	    queued->tip_state != event->tip_state)
+		return false;
+
+	/* Absolute axes take the newest value, relative ones accumulate */
+	axes.delta.x += queued->axes.delta.x;
+	axes.delta.y += queued->axes.delta.y;
+	axes.wheel += queued->axes.wheel;
+	axes.wheel_discrete += queued->axes.wheel_discrete;
+
+	queued->time = event->time;
+	queued->axes = axes;
+	for (i = 0; i < ARRAY_LENGTH(queued->changed_axes); i++)
+		queued->changed_axes[i] |= event->changed_axes[i];
+
+	return true;
+}
+
+/* Merge event into the last queued event if both are of the same
+ * coalescable type from the same device. Returns true if the event was
+ * merged and must not be queued.
+ */
+static bool
+event_queue_coalesce(struct libinput *libinput,
+		     const struct libinput_event *event,
+		     uint32_t flags)
+{
+	struct libinput_event *queued;
+	bool merged = false;
+
+	queued = event_queue_last(libinput);
+	if (!queued ||
+	    queued->type != event->type ||
+	    queued->device != event->device)
+		return false;
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		if (!(flags & LIBINPUT_EVENT_COALESCE_POINTER_MOTION))
+			break;
+
+		merged = coalesce_pointer_motion(
+				(struct libinput_event_pointer *)queued,
+				(const struct libinput_event_pointer *)event);
+		if (merged)
+			libinput->coalesce_stats.pointer_motion++;
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		if (!(flags & LIBINPUT_EVENT_COALESCE_POINTER_AXIS))
+			break;
+
+		merged = coalesce_pointer_axis(
+				(struct libinput_event_pointer *)queued,
+				(const struct libinput_event_pointer *)event);
+		if (merged)
+			libinput->coalesce_stats.pointer_axis++;
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+		if (!(flags & LIBINPUT_EVENT_COALESCE_TABLET_TOOL_AXIS))
+			break;
+
+		merged = coalesce_tablet_tool_axis(
+				(struct libinput_event_tablet_tool *)queued,
+				(const struct libinput_event_tablet_tool *)event);
+		if (merged)
+			libinput->coalesce_stats.tablet_tool_axis++;
+		break;
+	default:
+		break;
+	}
+
+	return merged;
+}
+
+static struct libinput_event *
+event_queue_push(struct libinput *libinput,
+		 const struct libinput_event *event,
+		 size_t size)
+{
+	struct libinput_event **events = libinput->events;
+	size_t events_len = libinput->events_len;
+	size_t events_count = libinput->events_count;
+	struct libinput_event *stored;
+	size_t move_len;
+	size_t new_out;
+
+	events_count++;
+	if (events_count > events_len) {
+		events_len *= 2;
+		events = realloc(events, events_len * sizeof *events);
+		if (!events) {
+			log_error(libinput,
+				  "Failed to reallocate event ring buffer. "
+				  "Events may be discarded\n");
+			return NULL;
+		}
+
+		if (libinput->events_count > 0 && libinput->events_in == 0) {
+			libinput->events_in = libinput->events_len;
+		} else if (libinput->events_count > 0 &&
+			   libinput->events_out >= libinput->events_in) {
+			move_len = libinput->events_len - libinput->events_out;
+			new_out = events_len - move_len;
+			memmove(events + new_out,
+				events + libinput->events_out,
+				move_len * sizeof *events);
+			libinput->events_out = new_out;
+		}
+
+		libinput->events = events;
+		libinput->events_len = events_len;
+	}
+
+	stored = libinput_event_pool_get(libinput,
+					 event_pool_type(event->type));
+	if (!stored)
+		return NULL;
+
+	memcpy(stored, event, size);
+
+	events[libinput->events_in] = stored;
+	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+
+	return stored;
+}
+
+static inline bool
+event_is_motion(const struct libinput_event *event)
+{
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Events that only carry motion or axis deltas, losing one of them
+ * doesn't leave the caller with a wrong state. Key, button, touch
+ * down/up, tip, proximity, switch and device events are never dropped
+ * by the overflow policy. */
+static inline bool
+event_is_droppable(const struct libinput_event *event)
+{
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Remove the oldest queued motion event and shift the newer events down
+ * to close the gap. Returns false if no motion event is queued. */
+static bool
+event_ring_drop_oldest_motion(struct libinput *libinput)
+{
+	struct event_ring_chunk *chunk;
+	struct event_ring_slot *slot = NULL, *from;
+	struct libinput_event *dropped;
+	unsigned int idx;
+
+	list_for_each(chunk, &libinput->event_ring.chunks, link) {
+		for (idx = chunk->nread; idx < chunk->nwritten; idx++) {
+			if (event_is_motion(&chunk->slots[idx].event.base)) {
+				slot = &chunk->slots[idx];
+				break;
+			}
+		}
+		if (slot)
+			break;
+	}
+
+	if (!slot)
+		return false;
+
+	dropped = &slot->event.base;
+	libinput_event_unref_data(dropped);
+	if (dropped->device)
+		libinput_device_unref(dropped->device);
+
+	/* all chunks but the last one are full */
+	while (true) {
+		idx++;
+		if (idx == chunk->nwritten) {
+			if (chunk->link.next == &libinput->event_ring.chunks)
+				break;
+
+			chunk = container_of(chunk->link.next,
+					     struct event_ring_chunk,
+					     link);
+			idx = 0;
+		}
+
+		from = &chunk->slots[idx];
+		slot->event = from->event;
+		slot = from;
+	}
+
+	/* never leave an empty chunk behind a partially written one */
+	chunk->nwritten--;
+	if (chunk->nwritten == 0) {
+		list_remove(&chunk->link);
+		event_ring_recycle_chunk(libinput, chunk);
+	}
+
+	return true;
+}
+
+static bool
+event_queue_drop_oldest_motion(struct libinput *libinput)
+{
+	struct libinput_event **events = libinput->events;
+	size_t len = libinput->events_len;
+	size_t i, pos, next;
+
+	if (libinput->event_ring.enabled)
+		return event_ring_drop_oldest_motion(libinput);
+
+	for (i = 0; i < libinput->events_count; i++) {
+		pos = (libinput->events_out + i) % len;
+		if (event_is_motion(events[pos]))
+			break;
+	}
+
+	if (i == libinput->events_count)
+		return false;
+
+	libinput_event_free(libinput, events[pos]);
+
+	for (i++; i < libinput->events_count; i++) {
+		next = (libinput->events_out + i) % len;
+		events[pos] = events[next];
+		pos = next;
+	}
+
+	libinput->events_in = pos;
+
+	return true;
+}
+
+/* Apply the overflow policy to a full queue. Returns true if the event
+ * was consumed and must not be queued. Events that aren't droppable are
+ * queued beyond the limit if the policy can't make room. */
+static bool
+event_queue_overflow(struct libinput *libinput,
+		     const struct libinput_event *event)
+{
+	const uint32_t all = LIBINPUT_EVENT_COALESCE_POINTER_MOTION |
+			     LIBINPUT_EVENT_COALESCE_POINTER_AXIS |
+			     LIBINPUT_EVENT_COALESCE_TABLET_TOOL_AXIS;
+
+	switch (libinput->event_overflow_policy) {
+	case LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST:
+		break;
+	case LIBINPUT_EVENT_OVERFLOW_DROP_OLDEST_MOTION:
+		if (event_queue_drop_oldest_motion(libinput)) {
+			libinput->events_count--;
+			libinput->event_queue_stats.dropped++;
+			return false;
+		}
+		break;
+	case LIBINPUT_EVENT_OVERFLOW_COALESCE:
+		if (event_queue_coalesce(libinput, event, all))
+			return true;
+		break;
+	}
+
+	if (!event_is_droppable(event))
+		return false;
+
+	libinput->event_queue_stats.dropped++;
+
+	return true;
+}
+
+static inline unsigned int
+latency_bucket(uint64_t usec)
+{
+	unsigned int msb;
+	unsigned int idx;
+
+	if (usec < LATENCY_SUB_BUCKETS)
+		return usec;
+
+	msb = 63 - __builtin_clzll(usec);
+	idx = (msb - 1) * LATENCY_SUB_BUCKETS +
+	      ((usec >> (msb - LATENCY_SUB_SHIFT)) & (LATENCY_SUB_BUCKETS - 1));
+
+	return min(idx, LATENCY_NBUCKETS - 1);
+}
+
+static inline uint64_t
+latency_bucket_upper_bound(unsigned int idx)
+{
+	unsigned int msb, sub;
+
+	if (idx < LATENCY_SUB_BUCKETS)
+		return idx;
+
+	msb = idx / LATENCY_SUB_BUCKETS + 1;
+	sub = idx % LATENCY_SUB_BUCKETS;
+
+	return ((uint64_t)(LATENCY_SUB_BUCKETS + sub + 1) <<
+		(msb - LATENCY_SUB_SHIFT)) - 1;
+}
+
+static struct libinput_latency_histogram *
+latency_histogram_find(struct libinput_device *device,
+		       enum libinput_event_type type)
+{
+	struct libinput_latency_histogram *h;
+
+	list_for_each(h, &device->latency_list, link) {
+		if (h->type == type)
+			return h;
+	}
+
+	return NULL;
+}
+
+static uint64_t
+event_get_time_usec(struct libinput_event *event)
+{
+	switch (event->type) {
+	case LIBINPUT_EVENT_NONE:
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return 0;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return ((struct libinput_event_keyboard *)event)->time;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return ((struct libinput_event_pointer *)event)->time;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return ((struct libinput_event_touch *)event)->time;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return ((struct libinput_event_tablet_tool *)event)->time;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+		return ((struct libinput_event_tablet_pad *)event)->time;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return ((struct libinput_event_gesture *)event)->time;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return ((struct libinput_event_switch *)event)->time;
+	}
+
+	return 0;
+}
+
+static inline void
+latency_histogram_add(struct libinput_latency_histogram *h,
+		      enum libinput_latency_stage stage,
+		      uint64_t start,
+		      uint64_t end)
+{
+	uint64_t usec = end > start ? end - start : 0;
+
+	h->stages[stage - 1].buckets[latency_bucket(usec)]++;
+	h->stages[stage - 1].max = max(h->stages[stage - 1].max, usec);
+}
+
+/* Called when the event is returned to the caller. The histograms are
+ * only accessed from the caller's thread, the input thread merely sets
+ * the queued time of the event. */
+static void
+libinput_latency_record(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	struct libinput_latency_histogram *h;
+	uint64_t kernel_time, now;
+
+	if (event->queued_time == 0 || !event->device)
+		return;
+
+	kernel_time = event_get_time_usec(event);
+	now = libinput_now(libinput);
+	if (kernel_time == 0 || now == 0)
+		return;
+
+	h = latency_histogram_find(event->device, event->type);
+	if (!h) {
+		h = zalloc(sizeof *h);
+		if (!h)
+			return;
+		h->type = event->type;
+		list_insert(&event->device->latency_list, &h->link);
+	}
+
+	h->count++;
+	latency_histogram_add(h,
+			      LIBINPUT_LATENCY_STAGE_PROCESSING,
+			      kernel_time,
+			      event->queued_time);
+	latency_histogram_add(h,
+			      LIBINPUT_LATENCY_STAGE_QUEUED,
+			      event->queued_time,
+			      now);
+	latency_histogram_add(h,
+			      LIBINPUT_LATENCY_STAGE_TOTAL,
+			      kernel_time,
+			      now);
+}
+
+static void
+libinput_post_event(struct libinput *libinput,
+		    struct libinput_event *event)
+{
+	struct libinput_event *stored;
+	size_t size;
+
+#if 0
+	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
+#endif
+
+	libinput->dispatch_budget.nevents++;
+
+	if (libinput->latency_tracking &&
+	    event->type != LIBINPUT_EVENT_DEVICE_ADDED &&
+	    event->type != LIBINPUT_EVENT_DEVICE_REMOVED)
+		event->queued_time = libinput_now(libinput);
+
+	/* listeners have seen the event already, the caller doesn't want
+	 * it */
+	if (bit_is_set(libinput->event_mask_disabled, event->type)) {
+		libinput->events_masked++;
+		libinput_event_unref_data(event);
+		return;
+	}
+
+	if (libinput->event_coalesce &&
+	    event_queue_coalesce(libinput, event, libinput->event_coalesce)) {
+		libinput_event_unref_data(event);
+		return;
+	}
+
+	if (libinput->event_queue_limit &&
+	    libinput->events_count >= libinput->event_queue_limit &&
+	    event_queue_overflow(libinput, event)) {
+		libinput_event_unref_data(event);
+		return;
+	}
+
+	size = event_pool_sizes[event_pool_type(event->type)];
+
+	if (libinput->event_ring.enabled)
+		stored = event_ring_push(libinput, event, size);
+	else
+		stored = event_queue_push(libinput, event, size);
+
+	if (!stored) {
+		log_error(libinput,
+			  "Failed to queue %s event, event discarded\n",
+			  event_type_to_str(event->type));
+		libinput_event_unref_data(event);
+		libinput->event_queue_stats.dropped++;
+		return;
+	}
+
+	stored->in_ring = libinput->event_ring.enabled;
+	if (stored->device)
+		libinput_device_ref(stored->device);
+
+	libinput->events_count++;
+	if (libinput->events_count > libinput->event_queue_stats.high_water)
+		libinput->event_queue_stats.high_water = libinput->events_count;
+}
+
+static struct libinput_event *
+event_queue_pop(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	if (libinput->events_count == 0)
+		return NULL;
+
+	libinput->events_count--;
+
+	if (libinput->event_ring.enabled)
+		return event_ring_pop(libinput);
+
+	event = libinput->events[libinput->events_out];
+	libinput->events_out =
+		(libinput->events_out + 1) % libinput->events_len;
+
+	return event;
+}
+
+/* Move processed events to the caller, returns true if any event was
+ * moved. Called by the input thread with the lock held. */
+static bool
+libinput_thread_handoff_events(struct libinput *libinput)
+{
+	struct libinput_event *event;
+	bool moved = false;
+
+	while (libinput->events_count > 0) {
+		if (libinput->event_ring.enabled)
+			event = event_ring_peek(libinput);
+		else
+			event = libinput->events[libinput->events_out];
+
+		if (!event_handoff_push(&libinput->thread.events, event)) {
+			/* Flag the stall before checking again, the caller
+			 * may have popped an event in between and would
+			 * otherwise never wake us up */
+			__atomic_store_n(&libinput->thread.stalled,
+					 true,
+					 __ATOMIC_SEQ_CST);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+			if (!event_handoff_push(&libinput->thread.events,
+						event))
+				break;
+
+			__atomic_store_n(&libinput->thread.stalled,
+					 false,
+					 __ATOMIC_RELEASE);
+		}
+
+		event_queue_pop(libinput);
+		moved = true;
+	}
+
+	return moved;
+}
+
+static void *
+libinput_thread_func(void *data)
+{
+	struct libinput *libinput = data;
+	struct pollfd fds[2] = {
+		{ .fd = libinput->epoll_fd, .events = POLLIN },
+		{ .fd = libinput->thread.wake_fd, .events = POLLIN },
+	};
+	eventfd_t discard;
+	bool moved;
+
+	while (!__atomic_load_n(&libinput->thread.stop, __ATOMIC_ACQUIRE)) {
+		if (poll(fds, ARRAY_LENGTH(fds), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+
+			log_error(libinput,
+				  "input thread: poll failed (%s)\n",
+				  strerror(errno));
+			break;
+		}
+
+		if (fds[1].revents & POLLIN)
+			eventfd_read(libinput->thread.wake_fd, &discard);
+
+		pthread_mutex_lock(&libinput->thread.lock);
+		libinput_thread_release_events(libinput);
+		libinput_dispatch_all(libinput);
+		libinput_drop_destroyed_sources(libinput);
+		moved = libinput_thread_handoff_events(libinput);
+		pthread_mutex_unlock(&libinput->thread.lock);
+
+		if (moved)
+			eventfd_write(libinput->thread.notify_fd, 1);
+	}
+
+	return NULL;
+}
+
+static struct libinput_event *
+libinput_thread_get_event(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	event = event_handoff_pop(&libinput->thread.events);
+	if (!event)
+		return NULL;
+
+	/* The input thread has more events but ran out of space. Pairs
+	 * with the fence in libinput_thread_handoff_events(): either the
+	 * thread sees the slot we just freed or we see the stall. */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (libinput->thread.running &&
+	    __atomic_exchange_n(&libinput->thread.stalled,
+				false,
+				__ATOMIC_SEQ_CST))
+		eventfd_write(libinput->thread.wake_fd, 1);
+
+	return event;
+}
+
+#define LIBINPUT_THREAD_HANDOFF_SIZE 1024
+
+LIBINPUT_EXPORT int
+libinput_start_input_thread(struct libinput *libinput,
+			    int fifo_priority)
+{
+	struct sched_param param = { .sched_priority = fifo_priority };
+	int rc;
+
+	if (fifo_priority < 0 ||
+	    fifo_priority > sched_get_priority_max(SCHED_FIFO)) {
+		log_bug_client(libinput,
+			       "Invalid SCHED_FIFO priority %d\n",
+			       fifo_priority);
+		return -1;
+	}
+
+	if (libinput->thread.running)
+		return 0;
+
+	if (!libinput->thread.events.slots &&
+	    event_handoff_init(&libinput->thread.events,
+			       LIBINPUT_THREAD_HANDOFF_SIZE) < 0)
+		return -1;
+
+	if (!libinput->thread.release.slots &&
+	    event_handoff_init(&libinput->thread.release,
+			       LIBINPUT_THREAD_HANDOFF_SIZE) < 0)
+		return -1;
+
+	libinput->thread.wake_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	libinput->thread.notify_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	if (libinput->thread.wake_fd < 0 || libinput->thread.notify_fd < 0)
+		goto err;
+
+	/* events queued so far are handed over in the first iteration */
+	eventfd_write(libinput->thread.wake_fd, 1);
+
+	libinput->thread.stop = false;
+	libinput->thread.stalled = false;
+	libinput->thread.running = true;
+
+	rc = pthread_create(&libinput->thread.thread,
+			    NULL,
+			    libinput_thread_func,
+			    libinput);
+	if (rc != 0) {
+		log_error(libinput,
+			  "Failed to create input thread (%s)\n",
+			  strerror(rc));
+		libinput->thread.running = false;
+		goto err;
+	}
+
+	if (fifo_priority > 0) {
+		rc = pthread_setschedparam(libinput->thread.thread,
+					   SCHED_FIFO,
+					   &param);
+		if (rc != 0)
+			log_info(libinput,
+				 "Failed to set SCHED_FIFO priority %d (%s)\n",
+				 fifo_priority,
+				 strerror(rc));
+	}
+
+	return 0;
+
+err:
+	if (libinput->thread.wake_fd >= 0)
+		close(libinput->thread.wake_fd);
+	if (libinput->thread.notify_fd >= 0)
+		close(libinput->thread.notify_fd);
+	libinput->thread.wake_fd = -1;
+	libinput->thread.notify_fd = -1;
+
+	return -1;
+}
+
+LIBINPUT_EXPORT void
+libinput_stop_input_thread(struct libinput *libinput)
+{
+	if (!libinput->thread.running)
+		return;
+
+	__atomic_store_n(&libinput->thread.stop, true, __ATOMIC_RELEASE);
+	eventfd_write(libinput->thread.wake_fd, 1);
+	pthread_join(libinput->thread.thread, NULL);
+
+	libinput->thread.running = false;
+
+	/* Events still in the handoff are returned by
+	 * libinput_get_event() before the queue */
+	libinput_thread_release_events(libinput);
+
+	close(libinput->thread.wake_fd);
+	close(libinput->thread.notify_fd);
+	libinput->thread.wake_fd = -1;
+	libinput->thread.notify_fd = -1;
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_get_event(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	/* Events handed over by the input thread are older than any
+	 * event still in the queue */
+	event = libinput_thread_get_event(libinput);
+	if (!event && !libinput->thread.running)
+		event = event_queue_pop(libinput);
+
+	if (event)
+		libinput_latency_record(libinput, event);
+
+	return event;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    unsigned int nevents)
+{
+	size_t count, tail;
+	size_t i;
+
+	if (libinput->thread.running ||
+	    event_handoff_count(&libinput->thread.events) > 0) {
+		for (count = 0; count < nevents; count++) {
+			events[count] = libinput_get_event(libinput);
+			if (!events[count])
+				break;
+		}
+		return count;
+	}
+
+	count = min(libinput->events_count, (size_t)nevents);
+	if (count == 0)
+		return 0;
+
+	libinput->events_count -= count;
+
+	if (libinput->event_ring.enabled) {
+		for (i = 0; i < count; i++)
+			events[i] = event_ring_pop(libinput);
+		goto out;
+	}
+
+	/* The queued events are at most two contiguous pieces of the
+	 * ring buffer, the second one starting at the beginning */
+	tail = min(count, libinput->events_len - libinput->events_out);
+	memcpy(events,
+	       &libinput->events[libinput->events_out],
+	       tail * sizeof *events);
+	memcpy(events + tail,
+	       libinput->events,
+	       (count - tail) * sizeof *events);
+
+	libinput->events_out =
+		(libinput->events_out + count) % libinput->events_len;
+
+out:
+	for (i = 0; i < count; i++)
+		libinput_latency_record(libinput, events[i]);
+
+	return count;
+}
+
+LIBINPUT_EXPORT enum libinput_event_type
+libinput_next_event_type(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	event = event_handoff_peek(&libinput->thread.events);
+	if (event)
+		return event->type;
+
+	if (libinput->events_count == 0 || libinput->thread.running)
+		return LIBINPUT_EVENT_NONE;
+
+	if (libinput->event_ring.enabled)
+		event = event_ring_peek(libinput);
+	else
+		event = libinput->events[libinput->events_out];
+
+	return event->type;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_event_queue_mode(struct libinput *libinput,
+			      enum libinput_event_queue_mode mode)
+{
+	bool enable;
+
+	switch (mode) {
+	case LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED:
+		enable = false;
+		break;
+	case LIBINPUT_EVENT_QUEUE_MODE_INLINE:
+		enable = true;
+		break;
+	default:
+		log_bug_client(libinput,
+			       "Invalid event queue mode %d\n",
+			       mode);
+		return -1;
+	}
+
+	if (enable == libinput->event_ring.enabled)
+		return 0;
+
+	if (libinput->events_count > 0 || libinput->thread.running)
+		return -1;
+
+	if (!enable)
+		event_ring_seal(libinput);
+
+	libinput->event_ring.enabled = enable;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT enum libinput_event_queue_mode
+libinput_get_event_queue_mode(struct libinput *libinput)
+{
+	return libinput->event_ring.enabled ?
+		LIBINPUT_EVENT_QUEUE_MODE_INLINE :
+		LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_dispatch_mode(struct libinput *libinput,
+			   enum libinput_dispatch_mode mode)
+{
+	switch (mode) {
+	case LIBINPUT_DISPATCH_MODE_DRAIN:
+	case LIBINPUT_DISPATCH_MODE_ROUND_ROBIN:
+		break;
+	default:
+		log_bug_client(libinput,
+			       "Invalid dispatch mode %d\n",
+			       mode);
+		return -1;
+	}
+
+	libinput_lock(libinput);
+	libinput->dispatch_mode = mode;
+	libinput_unlock(libinput);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT enum libinput_dispatch_mode
+libinput_get_dispatch_mode(struct libinput *libinput)
+{
+	return libinput->dispatch_mode;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_timer_mode(struct libinput *libinput,
+			enum libinput_timer_mode mode)
+{
+	int rc;
+
+	switch (mode) {
+	case LIBINPUT_TIMER_MODE_HEAP:
+	case LIBINPUT_TIMER_MODE_WHEEL:
+		break;
+	default:
+		log_bug_client(libinput,
+			       "Invalid timer mode %d\n",
+			       mode);
+		return -1;
+	}
+
+	libinput_lock(libinput);
+	rc = libinput_timer_subsys_set_mode(libinput, mode);
+	libinput_unlock(libinput);
+
+	return rc;
+}
+
+LIBINPUT_EXPORT enum libinput_timer_mode
+libinput_get_timer_mode(struct libinput *libinput)
+{
+	return libinput->timer.mode;
 }
 
-void
-gesture_notify_swipe(struct libinput_device *device,
-		     uint64_t time,
-		     enum libinput_event_type type,
-		     int finger_count,
-		     const struct normalized_coords *delta,
-		     const struct normalized_coords *unaccel)
+LIBINPUT_EXPORT void
+libinput_set_timer_slack_enabled(struct libinput *libinput, int enabled)
 {
-	gesture_notify(device, time, type, finger_count, 0, delta, unaccel,
-		       0.0, 0.0);
+	libinput_lock(libinput);
+	libinput->timer.slack_enabled = !!enabled;
+	libinput_unlock(libinput);
 }
 
-void
-gesture_notify_swipe_end(struct libinput_device *device,
-			 uint64_t time,
-			 int finger_count,
-			 int cancelled)
+LIBINPUT_EXPORT int
+libinput_get_timer_slack_enabled(struct libinput *libinput)
 {
-	const struct normalized_coords zero = { 0.0, 0.0 };
+	return libinput->timer.slack_enabled;
+}
 
-	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_SWIPE_END,
-		       finger_count, cancelled, &zero, &zero, 0.0, 0.0);
+LIBINPUT_EXPORT int
+libinput_set_event_queue_limit(struct libinput *libinput,
+			       unsigned int max_events,
+			       enum libinput_event_overflow_policy policy)
+{
+	switch (policy) {
+	case LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST:
+	case LIBINPUT_EVENT_OVERFLOW_DROP_OLDEST_MOTION:
+	case LIBINPUT_EVENT_OVERFLOW_COALESCE:
+		break;
+	default:
+		log_bug_client(libinput,
+			       "Invalid overflow policy %d\n",
+			       policy);
+		return -1;
+	}
+
+	libinput_lock(libinput);
+	libinput->event_queue_limit = max_events;
+	libinput->event_overflow_policy = policy;
+	libinput_unlock(libinput);
+
+	return 0;
 }
 
-void
-gesture_notify_pinch(struct libinput_device *device,
-		     uint64_t time,
-		     enum libinput_event_type type,
-		     int finger_count,
-		     const struct normalized_coords *delta,
-		     const struct normalized_coords *unaccel,
-		     double scale,
-		     double angle)
+LIBINPUT_EXPORT unsigned int
+libinput_get_event_queue_limit(struct libinput *libinput)
 {
-	gesture_notify(device, time, type, finger_count, 0,
-		       delta, unaccel, scale, angle);
+	return libinput->event_queue_limit;
 }
 
-void
-gesture_notify_pinch_end(struct libinput_device *device,
-			 uint64_t time,
-			 int finger_count,
-			 double scale,
-			 int cancelled)
+LIBINPUT_EXPORT enum libinput_event_overflow_policy
+libinput_get_event_overflow_policy(struct libinput *libinput)
 {
-	const struct normalized_coords zero = { 0.0, 0.0 };
+	return libinput->event_overflow_policy;
+}
 
-	gesture_notify(device, time, LIBINPUT_EVENT_GESTURE_PINCH_END,
-		       finger_count, cancelled, &zero, &zero, scale, 0.0);
+LIBINPUT_EXPORT int
+libinput_set_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type,
+				int enabled)
+{
+	if (type == LIBINPUT_EVENT_NONE ||
+	    type > LIBINPUT_EVENT_SWITCH_TOGGLE ||
+	    event_type_to_str(type) == NULL) {
+		log_bug_client(libinput, "Invalid event type %d\n", type);
+		return -1;
+	}
+
+	/* the caller needs these to manage the device lifetime */
+	if (type == LIBINPUT_EVENT_DEVICE_ADDED ||
+	    type == LIBINPUT_EVENT_DEVICE_REMOVED)
+		return enabled ? 0 : -1;
+
+	libinput_lock(libinput);
+	if (enabled)
+		clear_bit(libinput->event_mask_disabled, type);
+	else
+		set_bit(libinput->event_mask_disabled, type);
+	libinput_unlock(libinput);
+
+	return 0;
 }
 
-void
-switch_notify_toggle(struct libinput_device *device,
-		     uint64_t time,
-		     enum libinput_switch sw,
-		     enum libinput_switch_state state)
+LIBINPUT_EXPORT int
+libinput_get_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type)
 {
-	struct libinput_event_switch *switch_event;
+	if (type == LIBINPUT_EVENT_NONE ||
+	    type > LIBINPUT_EVENT_SWITCH_TOGGLE)
+		return 0;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
-		return;
+	return !bit_is_set(libinput->event_mask_disabled, type);
+}
 
-	switch_event = zalloc(sizeof *switch_event);
-	if (!switch_event)
-		return;
+LIBINPUT_EXPORT void
+libinput_set_event_coalescing(struct libinput *libinput,
+			      uint32_t flags)
+{
+	const uint32_t all = LIBINPUT_EVENT_COALESCE_POINTER_MOTION |
+			     LIBINPUT_EVENT_COALESCE_POINTER_AXIS |
+			     LIBINPUT_EVENT_COALESCE_TABLET_TOOL_AXIS;
 
-	*switch_event = (struct libinput_event_switch) {
-		.time = time,
-		.sw = sw,
-		.state = state,
-	};
+	if (flags & ~all)
+		log_bug_client(libinput,
+			       "Invalid event coalescing flags %#x\n",
+			       flags & ~all);
 
-	post_device_event(device, time,
-			  LIBINPUT_EVENT_SWITCH_TOGGLE,
-			  &switch_event->base);
+	libinput_lock(libinput);
+	libinput->event_coalesce = flags & all;
+	libinput_unlock(libinput);
 }
 
-static void
-libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event)
+LIBINPUT_EXPORT uint32_t
+libinput_get_event_coalescing(struct libinput *libinput)
+{
+	return libinput->event_coalesce;
+}
+
+static uint64_t
+libinput_statistic_value(struct libinput *libinput,
+			 enum libinput_statistic statistic)
+{
+	switch (statistic) {
+	case LIBINPUT_STATISTIC_EVENT_POOL_HITS:
+		return libinput->event_pool_stats.hits;
+	case LIBINPUT_STATISTIC_EVENT_POOL_MISSES:
+		return libinput->event_pool_stats.misses;
+	case LIBINPUT_STATISTIC_COALESCED_POINTER_MOTION:
+		return libinput->coalesce_stats.pointer_motion;
+	case LIBINPUT_STATISTIC_COALESCED_POINTER_AXIS:
+		return libinput->coalesce_stats.pointer_axis;
+	case LIBINPUT_STATISTIC_COALESCED_TABLET_TOOL_AXIS:
+		return libinput->coalesce_stats.tablet_tool_axis;
+	case LIBINPUT_STATISTIC_EVENT_QUEUE_HIGH_WATER:
+		return libinput->event_queue_stats.high_water;
+	case LIBINPUT_STATISTIC_EVENTS_DROPPED:
+		return libinput->event_queue_stats.dropped;
+	case LIBINPUT_STATISTIC_EVENTS_MASKED:
+		return libinput->events_masked;
+	case LIBINPUT_STATISTIC_TIMERFD_UPDATES:
+		return libinput->timer.fd_updates;
+	case LIBINPUT_STATISTIC_TIMER_WAKEUPS:
+		return libinput->timer.wakeups;
+	case LIBINPUT_STATISTIC_TIMER_EXPIRIES:
+		return libinput->timer.expiries;
+	}
+
+	log_bug_client(libinput,
+		       "Invalid statistic %d\n",
+		       statistic);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_statistic(struct libinput *libinput,
+		       enum libinput_statistic statistic)
 {
-	struct libinput_event **events = libinput->events;
-	size_t events_len = libinput->events_len;
-	size_t events_count = libinput->events_count;
-	size_t move_len;
-	size_t new_out;
+	uint64_t value;
 
-#if 0
-	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
-#endif
+	/* counters are updated by the input thread */
+	libinput_lock(libinput);
+	value = libinput_statistic_value(libinput, statistic);
+	libinput_unlock(libinput);
 
-	events_count++;
-	if (events_count > events_len) {
-		events_len *= 2;
-		events = realloc(events, events_len * sizeof *events);
-		if (!events) {
-			log_error(libinput,
-				  "Failed to reallocate event ring buffer. "
-				  "Events may be discarded\n");
-			return;
-		}
+	return value;
+}
 
-		if (libinput->events_count > 0 && libinput->events_in == 0) {
-			libinput->events_in = libinput->events_len;
-		} else if (libinput->events_count > 0 &&
-			   libinput->events_out >= libinput->events_in) {
-			move_len = libinput->events_len - libinput->events_out;
-			new_out = events_len - move_len;
-			memmove(events + new_out,
-				events + libinput->events_out,
-				move_len * sizeof *events);
-			libinput->events_out = new_out;
-		}
+LIBINPUT_EXPORT void
+libinput_set_latency_tracking(struct libinput *libinput,
+			      int enabled)
+{
+	libinput_lock(libinput);
+	libinput->latency_tracking = !!enabled;
+	libinput_unlock(libinput);
+}
 
-		libinput->events = events;
-		libinput->events_len = events_len;
-	}
+LIBINPUT_EXPORT int
+libinput_get_latency_tracking(struct libinput *libinput)
+{
+	return libinput->latency_tracking;
+}
 
-	if (event->device)
-		libinput_device_ref(event->device);
+LIBINPUT_EXPORT void
+libinput_set_motion_prediction(struct libinput *libinput,
+			       uint64_t max_horizon)
+{
+	libinput_lock(libinput);
+	libinput->prediction_horizon = max_horizon;
+	libinput_unlock(libinput);
+}
 
-	libinput->events_count = events_count;
-	events[libinput->events_in] = event;
-	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+LIBINPUT_EXPORT uint64_t
+libinput_get_motion_prediction(struct libinput *libinput)
+{
+	return libinput->prediction_horizon;
 }
 
-LIBINPUT_EXPORT struct libinput_event *
-libinput_get_event(struct libinput *libinput)
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_latency_count(struct libinput_device *device,
+				  enum libinput_event_type type)
 {
-	struct libinput_event *event;
+	struct libinput_latency_histogram *h;
 
-	if (libinput->events_count == 0)
-		return NULL;
+	h = latency_histogram_find(device, type);
 
-	event = libinput->events[libinput->events_out];
-	libinput->events_out =
-		(libinput->events_out + 1) % libinput->events_len;
-	libinput->events_count--;
+	return h ? h->count : 0;
+}
 
-	return event;
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_latency_percentile(struct libinput_device *device,
+				       enum libinput_event_type type,
+				       enum libinput_latency_stage stage,
+				       double percentile)
+{
+	struct libinput_latency_histogram *h;
+	uint64_t rank, seen = 0;
+	uint64_t max;
+	unsigned int i;
+
+	if (stage < LIBINPUT_LATENCY_STAGE_PROCESSING ||
+	    stage > LIBINPUT_LATENCY_STAGE_TOTAL ||
+	    percentile < 0.0 || percentile > 100.0) {
+		log_bug_client(device->seat->libinput,
+			       "Invalid latency stage %d or percentile %.2f\n",
+			       stage,
+			       percentile);
+		return 0;
+	}
+
+	h = latency_histogram_find(device, type);
+	if (!h || h->count == 0)
+		return 0;
+
+	max = h->stages[stage - 1].max;
+	if (percentile == 100.0)
+		return max;
+
+	rank = max(1, (uint64_t)ceil(h->count * percentile / 100.0));
+	for (i = 0; i < LATENCY_NBUCKETS; i++) {
+		seen += h->stages[stage - 1].buckets[i];
+		if (seen >= rank)
+			return min(latency_bucket_upper_bound(i), max);
+	}
+
+	return max;
 }
 
-LIBINPUT_EXPORT enum libinput_event_type
-libinput_next_event_type(struct libinput *libinput)
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_statistic(struct libinput_device *device,
+			      enum libinput_device_statistic statistic)
 {
-	struct libinput_event *event;
-
-	if (libinput->events_count == 0)
-		return LIBINPUT_EVENT_NONE;
+	struct libinput *libinput = device->seat->libinput;
+	struct evdev_device *evdev = evdev_device(device);
+	uint64_t value = 0;
+
+	/* counters are updated by the input thread */
+	libinput_lock(libinput);
+	switch (statistic) {
+	case LIBINPUT_DEVICE_STATISTIC_SYN_DROPPED:
+		value = evdev->resync.syn_dropped;
+		break;
+	case LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_LAST:
+		value = evdev->resync.last_duration;
+		break;
+	case LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_MAX:
+		value = evdev->resync.max_duration;
+		break;
+	default:
+		log_bug_client(libinput,
+			       "Invalid device statistic %d\n",
+			       statistic);
+		break;
+	}
+	libinput_unlock(libinput);
 
-	event = libinput->events[libinput->events_out];
-	return event->type;
+	return value;
 }
 
 LIBINPUT_EXPORT void
@@ -2859,13 +4732,21 @@ libinput_get_user_data(struct libinput *libinput)
 LIBINPUT_EXPORT int
 libinput_resume(struct libinput *libinput)
 {
-	return libinput->interface_backend->resume(libinput);
+	int rc;
+
+	libinput_lock(libinput);
+	rc = libinput->interface_backend->resume(libinput);
+	libinput_unlock(libinput);
+
+	return rc;
 }
 
 LIBINPUT_EXPORT void
 libinput_suspend(struct libinput *libinput)
 {
+	libinput_lock(libinput);
 	libinput->interface_backend->suspend(libinput);
+	libinput_unlock(libinput);
 }
 
 LIBINPUT_EXPORT void
@@ -2933,12 +4814,16 @@ libinput_device_set_seat_logical_name(struct libinput_device *device,
 				      const char *name)
 {
 	struct libinput *libinput = device->seat->libinput;
+	int rc;
 
 	if (name == NULL)
 		return -1;
 
-	return libinput->interface_backend->device_change_seat(device,
-							       name);
+	libinput_lock(libinput);
+	rc = libinput->interface_backend->device_change_seat(device, name);
+	libinput_unlock(libinput);
+
+	return rc;
 }
 
 LIBINPUT_EXPORT struct udev_device *
@@ -2951,7 +4836,11 @@ LIBINPUT_EXPORT void
 libinput_device_led_update(struct libinput_device *device,
 			   enum libinput_led leds)
 {
+	struct libinput *libinput = device->seat->libinput;
+
+	libinput_lock(libinput);
 	evdev_device_led_update((struct evdev_device *) device, leds);
+	libinput_unlock(libinput);
 }
 
 LIBINPUT_EXPORT int
@@ -3083,7 +4972,12 @@ LIBINPUT_EXPORT struct libinput_tablet_pad_mode_group *
 libinput_tablet_pad_mode_group_ref(
 			struct libinput_tablet_pad_mode_group *group)
 {
+	struct libinput *libinput = group->libinput;
+
+	libinput_lock(libinput);
 	group->refcount++;
+	libinput_unlock(libinput);
+
 	return group;
 }
 
@@ -3091,15 +4985,22 @@ LIBINPUT_EXPORT struct libinput_tablet_pad_mode_group *
 libinput_tablet_pad_mode_group_unref(
 			struct libinput_tablet_pad_mode_group *group)
 {
+	struct libinput *libinput = group->libinput;
+
+	libinput_lock(libinput);
+
 	assert(group->refcount > 0);
 
 	group->refcount--;
-	if (group->refcount > 0)
-		return group;
+	if (group->refcount == 0) {
+		list_remove(&group->link);
+		group->destroy(group);
+		group = NULL;
+	}
 
-	list_remove(&group->link);
-	group->destroy(group);
-	return NULL;
+	libinput_unlock(libinput);
+
+	return group;
 }
 
 LIBINPUT_EXPORT void
@@ -3355,7 +5256,10 @@ libinput_event_tablet_pad_get_base_event(struct libinput_event_tablet_pad *event
 LIBINPUT_EXPORT struct libinput_device_group *
 libinput_device_group_ref(struct libinput_device_group *group)
 {
+	libinput_lock(group->libinput);
 	group->refcount++;
+	libinput_unlock(group->libinput);
+
 	return group;
 }
 
@@ -3369,6 +5273,7 @@ libinput_device_group_create(struct libinput *libinput,
 	if (!group)
 		return NULL;
 
+	group->libinput = libinput;
 	group->refcount = 1;
 	if (identifier) {
 		group->identifier = strdup(identifier);
@@ -3419,14 +5324,20 @@ libinput_device_group_destroy(struct libinput_device_group *group)
 LIBINPUT_EXPORT struct libinput_device_group *
 libinput_device_group_unref(struct libinput_device_group *group)
 {
+	struct libinput *libinput = group->libinput;
+
+	libinput_lock(libinput);
+
 	assert(group->refcount > 0);
 	group->refcount--;
 	if (group->refcount == 0) {
 		libinput_device_group_destroy(group);
-		return NULL;
-	} else {
-		return group;
+		group = NULL;
 	}
+
+	libinput_unlock(libinput);
+
+	return group;
 }
 
 LIBINPUT_EXPORT void
@@ -3472,6 +5383,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_tap_set_enabled(struct libinput_device *device,
 				       enum libinput_config_tap_state enable)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (enable != LIBINPUT_CONFIG_TAP_ENABLED &&
 	    enable != LIBINPUT_CONFIG_TAP_DISABLED)
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3480,8 +5394,11 @@ libinput_device_config_tap_set_enabled(struct libinput_device *device,
 		return enable ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
 				LIBINPUT_CONFIG_STATUS_SUCCESS;
 
-	return device->config.tap->set_enabled(device, enable);
+	libinput_lock(libinput);
+	status = device->config.tap->set_enabled(device, enable);
+	libinput_unlock(libinput);
 
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_tap_state
@@ -3506,6 +5423,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_tap_set_button_map(struct libinput_device *device,
 					    enum libinput_config_tap_button_map map)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	switch (map) {
 	case LIBINPUT_CONFIG_TAP_MAP_LRM:
 	case LIBINPUT_CONFIG_TAP_MAP_LMR:
@@ -3517,7 +5437,11 @@ libinput_device_config_tap_set_button_map(struct libinput_device *device,
 	if (libinput_device_config_tap_get_finger_count(device) == 0)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	return device->config.tap->set_map(device, map);
+	libinput_lock(libinput);
+	status = device->config.tap->set_map(device, map);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_tap_button_map
@@ -3542,6 +5466,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_tap_set_drag_enabled(struct libinput_device *device,
 					    enum libinput_config_drag_state enable)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (enable != LIBINPUT_CONFIG_DRAG_ENABLED &&
 	    enable != LIBINPUT_CONFIG_DRAG_DISABLED)
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3550,7 +5477,11 @@ libinput_device_config_tap_set_drag_enabled(struct libinput_device *device,
 		return enable ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
 				LIBINPUT_CONFIG_STATUS_SUCCESS;
 
-	return device->config.tap->set_drag_enabled(device, enable);
+	libinput_lock(libinput);
+	status = device->config.tap->set_drag_enabled(device, enable);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_drag_state
@@ -3575,6 +5506,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_tap_set_drag_lock_enabled(struct libinput_device *device,
 						 enum libinput_config_drag_lock_state enable)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (enable != LIBINPUT_CONFIG_DRAG_LOCK_ENABLED &&
 	    enable != LIBINPUT_CONFIG_DRAG_LOCK_DISABLED)
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3583,7 +5517,11 @@ libinput_device_config_tap_set_drag_lock_enabled(struct libinput_device *device,
 		return enable ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
 				LIBINPUT_CONFIG_STATUS_SUCCESS;
 
-	return device->config.tap->set_draglock_enabled(device, enable);
+	libinput_lock(libinput);
+	status = device->config.tap->set_draglock_enabled(device, enable);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_drag_lock_state
@@ -3615,10 +5553,17 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_calibration_set_matrix(struct libinput_device *device,
 					      const float matrix[6])
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (!libinput_device_config_calibration_has_matrix(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	return device->config.calibration->set_matrix(device, matrix);
+	libinput_lock(libinput);
+	status = device->config.calibration->set_matrix(device, matrix);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT int
@@ -3656,13 +5601,21 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_send_events_set_mode(struct libinput_device *device,
 					    uint32_t mode)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if ((libinput_device_config_send_events_get_modes(device) & mode) != mode)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	if (device->config.sendevents)
-		return device->config.sendevents->set_mode(device, mode);
-	else /* mode must be _ENABLED to get here */
+	/* mode must be _ENABLED to get here */
+	if (!device->config.sendevents)
 		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	libinput_lock(libinput);
+	status = device->config.sendevents->set_mode(device, mode);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT uint32_t
@@ -3691,6 +5644,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_accel_set_speed(struct libinput_device *device,
 				       double speed)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	/* Need the negation in case speed is NaN */
 	if (!(speed >= -1.0 && speed <= 1.0))
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3698,7 +5654,11 @@ libinput_device_config_accel_set_speed(struct libinput_device *device,
 	if (!libinput_device_config_accel_is_available(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	return device->config.accel->set_speed(device, speed);
+	libinput_lock(libinput);
+	status = device->config.accel->set_speed(device, speed);
+	libinput_unlock(libinput);
+
+	return status;
 }
 LIBINPUT_EXPORT double
 libinput_device_config_accel_get_speed(struct libinput_device *device)
@@ -3749,6 +5709,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_accel_set_profile(struct libinput_device *device,
 					 enum libinput_config_accel_profile profile)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	switch (profile) {
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT:
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE:
@@ -3761,7 +5724,11 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	    (libinput_device_config_accel_get_profiles(device) & profile) == 0)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	return device->config.accel->set_profile(device, profile);
+	libinput_lock(libinput);
+	status = device->config.accel->set_profile(device, profile);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT int
@@ -3777,10 +5744,17 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_natural_scroll_enabled(struct libinput_device *device,
 							 int enabled)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (!libinput_device_config_scroll_has_natural_scroll(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	return device->config.natural_scroll->set_enabled(device, enabled);
+	libinput_lock(libinput);
+	status = device->config.natural_scroll->set_enabled(device, enabled);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT int
@@ -3814,10 +5788,17 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_left_handed_set(struct libinput_device *device,
 				       int left_handed)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (!libinput_device_config_left_handed_is_available(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	return device->config.left_handed->set(device, left_handed);
+	libinput_lock(libinput);
+	status = device->config.left_handed->set(device, left_handed);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT int
@@ -3851,6 +5832,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_click_set_method(struct libinput_device *device,
 					enum libinput_config_click_method method)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	/* Check method is a single valid method */
 	switch (method) {
 	case LIBINPUT_CONFIG_CLICK_METHOD_NONE:
@@ -3864,10 +5848,15 @@ libinput_device_config_click_set_method(struct libinput_device *device,
 	if ((libinput_device_config_click_get_methods(device) & method) != method)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	if (device->config.click_method)
-		return device->config.click_method->set_method(device, method);
-	else /* method must be _NONE to get here */
+	/* method must be _NONE to get here */
+	if (!device->config.click_method)
 		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	libinput_lock(libinput);
+	status = device->config.click_method->set_method(device, method);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_click_method
@@ -3903,6 +5892,8 @@ libinput_device_config_middle_emulation_set_enabled(
 		struct libinput_device *device,
 		enum libinput_config_middle_emulation_state enable)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
 	int available =
 		libinput_device_config_middle_emulation_is_available(device);
 
@@ -3919,7 +5910,11 @@ libinput_device_config_middle_emulation_set_enabled(
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 	}
 
-	return device->config.middle_emulation->set(device, enable);
+	libinput_lock(libinput);
+	status = device->config.middle_emulation->set(device, enable);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_middle_emulation_state
@@ -3955,6 +5950,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_method(struct libinput_device *device,
 					 enum libinput_config_scroll_method method)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	/* Check method is a single valid method */
 	switch (method) {
 	case LIBINPUT_CONFIG_SCROLL_NO_SCROLL:
@@ -3969,10 +5967,15 @@ libinput_device_config_scroll_set_method(struct libinput_device *device,
 	if ((libinput_device_config_scroll_get_methods(device) & method) != method)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
-	if (device->config.scroll_method)
-		return device->config.scroll_method->set_method(device, method);
-	else /* method must be _NO_SCROLL to get here */
+	/* method must be _NO_SCROLL to get here */
+	if (!device->config.scroll_method)
 		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	libinput_lock(libinput);
+	status = device->config.scroll_method->set_method(device, method);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_scroll_method
@@ -3997,6 +6000,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_button(struct libinput_device *device,
 					 uint32_t button)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if ((libinput_device_config_scroll_get_methods(device) &
 	     LIBINPUT_CONFIG_SCROLL_ON_BUTTON_DOWN) == 0)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
@@ -4004,7 +6010,11 @@ libinput_device_config_scroll_set_button(struct libinput_device *device,
 	if (button && !libinput_device_pointer_has_button(device, button))
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 
-	return device->config.scroll_method->set_button(device, button);
+	libinput_lock(libinput);
+	status = device->config.scroll_method->set_button(device, button);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT uint32_t
@@ -4040,6 +6050,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_dwt_set_enabled(struct libinput_device *device,
 				       enum libinput_config_dwt_state enable)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (enable != LIBINPUT_CONFIG_DWT_ENABLED &&
 	    enable != LIBINPUT_CONFIG_DWT_DISABLED)
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -4048,7 +6061,11 @@ libinput_device_config_dwt_set_enabled(struct libinput_device *device,
 		return enable ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
 				LIBINPUT_CONFIG_STATUS_SUCCESS;
 
-	return device->config.dwt->set_enabled(device, enable);
+	libinput_lock(libinput);
+	status = device->config.dwt->set_enabled(device, enable);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT enum libinput_config_dwt_state
@@ -4082,6 +6099,9 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_rotation_set_angle(struct libinput_device *device,
 					  unsigned int degrees_cw)
 {
+	struct libinput *libinput = device->seat->libinput;
+	enum libinput_config_status status;
+
 	if (!libinput_device_config_rotation_is_available(device))
 		return degrees_cw ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
 				    LIBINPUT_CONFIG_STATUS_SUCCESS;
@@ -4089,7 +6109,11 @@ libinput_device_config_rotation_set_angle(struct libinput_device *device,
 	if (degrees_cw >= 360 || degrees_cw % 90)
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 
-	return device->config.rotation->set_angle(device, degrees_cw);
+	libinput_lock(libinput);
+	status = device->config.rotation->set_angle(device, degrees_cw);
+	libinput_unlock(libinput);
+
+	return status;
 }
 
 LIBINPUT_EXPORT unsigned int
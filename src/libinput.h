@@ -812,6 +812,20 @@ enum libinput_event_type {
 void
 libinput_event_destroy(struct libinput_event *event);
 
+/**
+ * @ingroup event
+ *
+ * Destroy an array of events, e.g. as retrieved by libinput_get_events().
+ * This is equivalent to calling libinput_event_destroy() on each element
+ * of the array in order. The array itself is not freed.
+ *
+ * @param events An array of events
+ * @param nevents The number of events in the array
+ */
+void
+libinput_events_destroy(struct libinput_event **events,
+			unsigned int nevents);
+
 /**
  * @ingroup event
  *
@@ -1152,6 +1166,64 @@ double
 libinput_event_pointer_get_dy_unaccelerated(
 	struct libinput_event_pointer *event);
 
+/**
+ * @ingroup event_pointer
+ *
+ * Return the x motion expected between this event and the given target
+ * time. This is intended for callers that present the pointer position
+ * some time after the event, e.g. at the next vertical blank, and want to
+ * compensate for that delay.
+ *
+ * The returned value is an offset for display only: draw the pointer at
+ * its position plus this offset, but keep accumulating only the delta
+ * from libinput_event_pointer_get_dx() into the pointer position. The
+ * offset of each event replaces that of the previous event, adding it to
+ * the position would extrapolate the same motion again on every event and
+ * make the pointer drift ahead.
+ *
+ * The motion is extrapolated from the velocity of the device at the time
+ * of the event and, for touchpads, its acceleration. The extrapolation is
+ * limited to the maximum horizon set with libinput_set_motion_prediction().
+ * If motion prediction is disabled, the target time is before the event
+ * time or the device does not provide a velocity, this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @param event The libinput pointer event
+ * @param target_time The time to extrapolate to in microseconds, in the
+ * same clock as libinput_event_pointer_get_time_usec()
+ * @return The predicted x offset from the pointer position after this
+ * event
+ *
+ * @see libinput_event_pointer_get_predicted_dy
+ */
+double
+libinput_event_pointer_get_predicted_dx(struct libinput_event_pointer *event,
+					uint64_t target_time);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the y motion expected between this event and the given target
+ * time. See libinput_event_pointer_get_predicted_dx() for details, the
+ * value is an offset for display only.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @param event The libinput pointer event
+ * @param target_time The time to extrapolate to in microseconds, in the
+ * same clock as libinput_event_pointer_get_time_usec()
+ * @return The predicted y offset from the pointer position after this
+ * event
+ *
+ * @see libinput_event_pointer_get_predicted_dx
+ */
+double
+libinput_event_pointer_get_predicted_dy(struct libinput_event_pointer *event,
+					uint64_t target_time);
+
 /**
  * @ingroup event_pointer
  *
@@ -3036,6 +3108,231 @@ libinput_get_fd(struct libinput *libinput);
 int
 libinput_dispatch(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Like libinput_dispatch(), but stops processing once the given budget
+ * is used up. This allows a caller to bound the time spent in libinput
+ * when a device floods the context with events.
+ *
+ * Devices are only interrupted at the end of a hardware frame, so the
+ * events of one frame may exceed the budget. A device interrupted by the
+ * budget is resumed first by the next call to libinput_dispatch() or
+ * libinput_dispatch_with_budget(), before any other device is read.
+ *
+ * If this function returns a positive value, the caller must call it
+ * again without waiting for the file descriptor returned by
+ * libinput_get_fd() to become readable, the remaining data may already
+ * have been read from the kernel.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param max_events Stop once this many events were generated, or 0 for
+ * no limit
+ * @param deadline_usec Stop once this time in microseconds in the
+ * CLOCK_MONOTONIC timeline has passed, or 0 for no deadline
+ *
+ * @return 0 if all available data was processed, a positive number if
+ * the budget was used up and data may remain, or a negative errno on
+ * failure
+ *
+ * @see libinput_dispatch
+ */
+int
+libinput_dispatch_with_budget(struct libinput *libinput,
+			      unsigned int max_events,
+			      uint64_t deadline_usec);
+
+/**
+ * @ingroup base
+ *
+ * Move event processing to a thread owned by libinput. Devices are read
+ * and processed as soon as data is available, independent of when the
+ * caller calls libinput_dispatch(). Processed events are handed to the
+ * caller through a lock-free queue.
+ *
+ * Once the thread runs, libinput_get_fd() returns a different file
+ * descriptor that becomes readable whenever new events are available.
+ * The caller must call libinput_get_fd() again after this function and
+ * use the new file descriptor. libinput_dispatch() only resets that file
+ * descriptor, libinput_get_event() and libinput_get_events() return the
+ * events processed by the thread.
+ *
+ * Configuration and reference counting functions called by the caller
+ * are serialized with the input thread and block while the thread
+ * processes events. The log handler and any other callbacks are invoked
+ * from the input thread.
+ *
+ * All functions of this context must still be called from one thread
+ * only, the thread libinput_start_input_thread() was called from.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param fifo_priority The SCHED_FIFO priority of the input thread, or 0
+ * to use the default scheduling policy. If the priority cannot be set,
+ * e.g. for lack of privileges, the thread uses the default policy.
+ *
+ * @return 0 on success, or -1 if the thread could not be started
+ *
+ * @see libinput_stop_input_thread
+ */
+int
+libinput_start_input_thread(struct libinput *libinput,
+			    int fifo_priority);
+
+/**
+ * @ingroup base
+ *
+ * Stop the thread started with libinput_start_input_thread() and return
+ * to processing events in libinput_dispatch(). Events already processed
+ * by the thread remain available through libinput_get_event().
+ *
+ * The caller must call libinput_get_fd() again after this function and
+ * use the new file descriptor.
+ *
+ * This function is called automatically when the context is destroyed.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_start_input_thread
+ */
+void
+libinput_stop_input_thread(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * The order in which libinput_dispatch() reads events from devices.
+ */
+enum libinput_dispatch_mode {
+	/**
+	 * Each device with data is read until no more data is available
+	 * before the next device is read. This is the default.
+	 */
+	LIBINPUT_DISPATCH_MODE_DRAIN = 1,
+	/**
+	 * Each device with data processes one hardware frame, then the
+	 * next device is read. This repeats until no device has data left.
+	 * A device generating events at a high rate, e.g. a tablet or a
+	 * touchscreen, delays the events of other devices by at most one
+	 * frame per round.
+	 */
+	LIBINPUT_DISPATCH_MODE_ROUND_ROBIN,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the order in which libinput_dispatch() and
+ * libinput_dispatch_with_budget() read events from devices. The events
+ * of a single device are always queued in order, only the interleaving
+ * of events from different devices changes.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The dispatch mode
+ * @return 0 on success or -1 if the mode is invalid
+ *
+ * @see libinput_get_dispatch_mode
+ */
+int
+libinput_set_dispatch_mode(struct libinput *libinput,
+			   enum libinput_dispatch_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The current dispatch mode
+ *
+ * @see libinput_set_dispatch_mode
+ */
+enum libinput_dispatch_mode
+libinput_get_dispatch_mode(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * The data structure libinput uses for its internal timeouts, e.g. for
+ * tapping or palm detection.
+ */
+enum libinput_timer_mode {
+	/**
+	 * Timeouts are kept sorted in a heap. Timeouts are handled at
+	 * their exact time and nearby timeouts are handled in one wakeup,
+	 * see libinput_set_timer_slack_enabled(). This is the default.
+	 */
+	LIBINPUT_TIMER_MODE_HEAP = 1,
+	/**
+	 * Timeouts are kept in a hierarchical timing wheel. Setting or
+	 * cancelling a timeout is at most linear in the number of
+	 * timeouts that expire within the same interval, not in the total
+	 * number of timeouts, this scales better to contexts with a large
+	 * number of devices. Timeouts are handled up to 1ms late.
+	 */
+	LIBINPUT_TIMER_MODE_WHEEL,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the data structure used for libinput's internal timeouts. The
+ * mode can only be changed while no timeout is pending, so this
+ * function should be called right after creating the context, before
+ * any devices are added.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The timer mode
+ * @return 0 on success or -1 if the mode is invalid or a timeout is
+ * pending
+ *
+ * @see libinput_get_timer_mode
+ */
+int
+libinput_set_timer_mode(struct libinput *libinput,
+			enum libinput_timer_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The current timer mode
+ *
+ * @see libinput_set_timer_mode
+ */
+enum libinput_timer_mode
+libinput_get_timer_mode(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable timer slack. With slack, a timeout that implements
+ * a user-visible delay, e.g. the tap timeout, may be handled a few ms
+ * late so that nearby timeouts are handled in the same wakeup. Without
+ * slack, every timeout is handled at its exact time.
+ *
+ * This takes effect for timeouts set after this call. Timer slack only
+ * applies to @ref LIBINPUT_TIMER_MODE_HEAP.
+ *
+ * Timer slack is enabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Non-zero to enable timer slack, zero otherwise
+ *
+ * @see libinput_get_timer_slack_enabled
+ * @see LIBINPUT_STATISTIC_TIMER_WAKEUPS
+ */
+void
+libinput_set_timer_slack_enabled(struct libinput *libinput, int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if timer slack is enabled, zero otherwise
+ *
+ * @see libinput_set_timer_slack_enabled
+ */
+int
+libinput_get_timer_slack_enabled(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -3050,6 +3347,31 @@ libinput_dispatch(struct libinput *libinput);
 struct libinput_event *
 libinput_get_event(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Retrieve up to nevents events from libinput's internal event queue in
+ * one call. The events are stored in the caller-provided array in the
+ * order they would have been returned by libinput_get_event().
+ *
+ * After handling the retrieved events, the caller must destroy each event
+ * with libinput_event_destroy() or all of them at once with
+ * libinput_events_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param events An array with space for at least nevents events
+ * @param nevents The maximum number of events to retrieve
+ * @return The number of events stored in events, 0 if no event is
+ * available
+ *
+ * @see libinput_get_event
+ * @see libinput_events_destroy
+ */
+unsigned int
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    unsigned int nevents);
+
 /**
  * @ingroup base
  *
@@ -3064,6 +3386,533 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Storage strategies for the context's internal event queue, see
+ * libinput_set_event_queue_mode().
+ */
+enum libinput_event_queue_mode {
+	/**
+	 * Each event is allocated separately and the queue holds pointers
+	 * to those events. This is the default mode.
+	 */
+	LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED = 1,
+	/**
+	 * Events are stored by value in contiguous fixed-size slots, the
+	 * queue grows in chunks of slots. An event returned by
+	 * libinput_get_event() points into such a slot, the slot is re-used
+	 * after the event was destroyed.
+	 */
+	LIBINPUT_EVENT_QUEUE_MODE_INLINE,
+};
+
+/**
+ * @ingroup base
+ *
+ * Change how the context stores queued events. The queue mode does not
+ * affect the events themselves, only their memory layout: events are
+ * valid until passed to libinput_event_destroy() in either mode.
+ *
+ * The queue mode can only be changed while the event queue is empty.
+ * Events retrieved before the mode change remain valid.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The new event queue mode
+ * @return 0 on success, or -1 if the event queue is not empty or the mode
+ * is invalid
+ *
+ * @see libinput_get_event_queue_mode
+ */
+int
+libinput_set_event_queue_mode(struct libinput *libinput,
+			      enum libinput_event_queue_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The current event queue mode
+ *
+ * @see libinput_set_event_queue_mode
+ */
+enum libinput_event_queue_mode
+libinput_get_event_queue_mode(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Policy applied when an event is posted while the event queue is at the
+ * limit set with libinput_set_event_queue_limit().
+ *
+ * Only events carrying motion or axis deltas are ever discarded: @ref
+ * LIBINPUT_EVENT_POINTER_MOTION, @ref
+ * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, @ref LIBINPUT_EVENT_POINTER_AXIS,
+ * @ref LIBINPUT_EVENT_TOUCH_MOTION, @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+ * @ref LIBINPUT_EVENT_TABLET_PAD_RING, @ref
+ * LIBINPUT_EVENT_TABLET_PAD_STRIP and the gesture update events. All other
+ * events, e.g. key and button releases or @ref
+ * LIBINPUT_EVENT_DEVICE_REMOVED, are queued even if the queue is at the
+ * limit, so the caller's view of the device state stays consistent.
+ */
+enum libinput_event_overflow_policy {
+	/**
+	 * Discard the new event.
+	 */
+	LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST = 1,
+	/**
+	 * Discard the oldest queued motion event, i.e. one of @ref
+	 * LIBINPUT_EVENT_POINTER_MOTION, @ref
+	 * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, @ref
+	 * LIBINPUT_EVENT_TOUCH_MOTION or @ref
+	 * LIBINPUT_EVENT_TABLET_TOOL_AXIS, and queue the new event. If no
+	 * motion event is queued, a new motion or axis event is discarded.
+	 */
+	LIBINPUT_EVENT_OVERFLOW_DROP_OLDEST_MOTION,
+	/**
+	 * Merge the new event into the last queued event as described in
+	 * @ref libinput_event_coalesce, regardless of the flags set with
+	 * libinput_set_event_coalescing(). If the event cannot be merged, a
+	 * motion or axis event is discarded.
+	 */
+	LIBINPUT_EVENT_OVERFLOW_COALESCE,
+};
+
+/**
+ * @ingroup base
+ *
+ * Limit the number of events waiting in the event queue. Once the limit
+ * is reached, the given policy decides what happens to new events. This
+ * keeps the memory use of the context bounded when the caller stops
+ * calling libinput_get_event().
+ *
+ * Events already in the queue when the limit is set are not discarded,
+ * the limit applies to new events only. Event listeners are notified of
+ * all events, including those discarded by the policy.
+ *
+ * By default, the event queue is unlimited.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param max_events The maximum number of queued events, or 0 for no
+ * limit
+ * @param policy The policy to apply to events posted while the queue is
+ * full
+ * @return 0 on success or -1 if the policy is invalid
+ *
+ * @see libinput_get_event_queue_limit
+ * @see libinput_get_event_overflow_policy
+ * @see LIBINPUT_STATISTIC_EVENTS_DROPPED
+ * @see LIBINPUT_STATISTIC_EVENT_QUEUE_HIGH_WATER
+ */
+int
+libinput_set_event_queue_limit(struct libinput *libinput,
+			       unsigned int max_events,
+			       enum libinput_event_overflow_policy policy);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The maximum number of queued events, or 0 if the event queue
+ * is unlimited
+ *
+ * @see libinput_set_event_queue_limit
+ */
+unsigned int
+libinput_get_event_queue_limit(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The policy applied when the event queue is full
+ *
+ * @see libinput_set_event_queue_limit
+ */
+enum libinput_event_overflow_policy
+libinput_get_event_overflow_policy(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable queuing of events of the given type. Events of a
+ * disabled type are processed internally as usual, e.g. a disabled @ref
+ * LIBINPUT_EVENT_KEYBOARD_KEY still triggers disable-while-typing on a
+ * touchpad, but they are never allocated or returned by
+ * libinput_get_event().
+ *
+ * Disabling event types the caller never handles, e.g. @ref
+ * LIBINPUT_EVENT_TOUCH_FRAME or @ref LIBINPUT_EVENT_TABLET_PAD_RING,
+ * saves the cost of queuing and destroying them.
+ *
+ * @ref LIBINPUT_EVENT_DEVICE_ADDED and @ref LIBINPUT_EVENT_DEVICE_REMOVED
+ * cannot be disabled.
+ *
+ * All event types are enabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type
+ * @param enabled Non-zero to queue events of this type, zero otherwise
+ * @return 0 on success, or -1 if the type is invalid or cannot be
+ * disabled
+ *
+ * @see libinput_get_event_type_enabled
+ * @see LIBINPUT_STATISTIC_EVENTS_MASKED
+ */
+int
+libinput_set_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type,
+				int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type
+ * @return Non-zero if events of this type are queued, zero otherwise
+ *
+ * @see libinput_set_event_type_enabled
+ */
+int
+libinput_get_event_type_enabled(struct libinput *libinput,
+				enum libinput_event_type type);
+
+/**
+ * @ingroup base
+ *
+ * Event types that may be merged while waiting in the event queue, see
+ * libinput_set_event_coalescing().
+ */
+enum libinput_event_coalesce {
+	LIBINPUT_EVENT_COALESCE_NONE = 0,
+	/**
+	 * Merge @ref LIBINPUT_EVENT_POINTER_MOTION events. The merged
+	 * event has the sum of the accelerated and unaccelerated deltas and
+	 * the timestamp of the most recent event.
+	 */
+	LIBINPUT_EVENT_COALESCE_POINTER_MOTION = (1 << 0),
+	/**
+	 * Merge @ref LIBINPUT_EVENT_POINTER_AXIS events with the same axis
+	 * source. The merged event has the sum of the axis values and
+	 * discrete values. Scroll stop events, i.e. events with an axis
+	 * value of 0, are never merged.
+	 */
+	LIBINPUT_EVENT_COALESCE_POINTER_AXIS = (1 << 1),
+	/**
+	 * Merge @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS events for the same
+	 * tool and tip state. The merged event has the most recent absolute
+	 * axis values, the sum of the relative deltas and wheel values, and
+	 * every axis that changed in any of the merged events is marked as
+	 * changed.
+	 */
+	LIBINPUT_EVENT_COALESCE_TABLET_TOOL_AXIS = (1 << 2),
+};
+
+/**
+ * @ingroup base
+ *
+ * Enable merging of events while they are waiting in the event queue.
+ * When enabled, a new event of one of the given types is merged into the
+ * last event in the queue if that event has the same type and device and
+ * has not been retrieved by the caller yet. If the caller keeps up with
+ * the events, no events are merged.
+ *
+ * This is intended for callers that may not process events for extended
+ * periods, e.g. a compositor that stalls for a frame. Merging keeps the
+ * queue length bounded at the cost of the intermediate event
+ * timestamps and positions.
+ *
+ * Events are merged after they were processed internally, merging has no
+ * effect on e.g. pointer acceleration or gesture detection.
+ *
+ * Merging is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param flags A bitmask of @ref libinput_event_coalesce values, or @ref
+ * LIBINPUT_EVENT_COALESCE_NONE to disable merging
+ *
+ * @see libinput_get_event_coalescing
+ * @see LIBINPUT_STATISTIC_COALESCED_POINTER_MOTION
+ */
+void
+libinput_set_event_coalescing(struct libinput *libinput,
+			      uint32_t flags);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return A bitmask of the @ref libinput_event_coalesce values currently
+ * enabled
+ *
+ * @see libinput_set_event_coalescing
+ */
+uint32_t
+libinput_get_event_coalescing(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Statistics counters maintained by a libinput context. These are
+ * intended for debugging and profiling only, the value of a counter has no
+ * effect on the behavior of libinput.
+ *
+ * @see libinput_get_statistic
+ */
+enum libinput_statistic {
+	/**
+	 * Number of events that re-used memory of a previously destroyed
+	 * event.
+	 */
+	LIBINPUT_STATISTIC_EVENT_POOL_HITS = 1,
+	/**
+	 * Number of events that required a fresh memory allocation because
+	 * no previously destroyed event was available for re-use.
+	 */
+	LIBINPUT_STATISTIC_EVENT_POOL_MISSES,
+	/**
+	 * Number of @ref LIBINPUT_EVENT_POINTER_MOTION events merged into
+	 * a queued event, see libinput_set_event_coalescing().
+	 */
+	LIBINPUT_STATISTIC_COALESCED_POINTER_MOTION,
+	/**
+	 * Number of @ref LIBINPUT_EVENT_POINTER_AXIS events merged into a
+	 * queued event, see libinput_set_event_coalescing().
+	 */
+	LIBINPUT_STATISTIC_COALESCED_POINTER_AXIS,
+	/**
+	 * Number of @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS events merged into
+	 * a queued event, see libinput_set_event_coalescing().
+	 */
+	LIBINPUT_STATISTIC_COALESCED_TABLET_TOOL_AXIS,
+	/**
+	 * The largest number of events that were waiting in the event queue
+	 * at any one time.
+	 */
+	LIBINPUT_STATISTIC_EVENT_QUEUE_HIGH_WATER,
+	/**
+	 * Number of events discarded because the event queue was full, see
+	 * libinput_set_event_queue_limit(), or because memory for the event
+	 * could not be allocated.
+	 */
+	LIBINPUT_STATISTIC_EVENTS_DROPPED,
+	/**
+	 * Number of events not queued because their type was disabled with
+	 * libinput_set_event_type_enabled().
+	 */
+	LIBINPUT_STATISTIC_EVENTS_MASKED,
+	/**
+	 * Number of times libinput re-programmed its internal timer
+	 * because the earliest pending timeout changed. Each is one system
+	 * call.
+	 */
+	LIBINPUT_STATISTIC_TIMERFD_UPDATES,
+	/**
+	 * Number of times libinput's internal timer woke up the caller.
+	 * Timeouts that are close together are handled in the same
+	 * wakeup where possible.
+	 */
+	LIBINPUT_STATISTIC_TIMER_WAKEUPS,
+	/**
+	 * Number of internal timeouts handled. The difference to @ref
+	 * LIBINPUT_STATISTIC_TIMER_WAKEUPS is the number of wakeups saved
+	 * by handling several timeouts at once.
+	 */
+	LIBINPUT_STATISTIC_TIMER_EXPIRIES,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return the current value of the given statistics counter. Counters
+ * start at zero when the context is created and increase monotonically.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param statistic The statistics counter to query
+ * @return The current value of the counter, or 0 if the counter is
+ * unknown
+ */
+uint64_t
+libinput_get_statistic(struct libinput *libinput,
+		       enum libinput_statistic statistic);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable latency tracking. If enabled, libinput records for
+ * each event the time the event was queued after processing and the time
+ * the event was returned by libinput_get_event(). Together with the
+ * kernel timestamp of the event these times are collected in per-device,
+ * per-event-type latency histograms, see
+ * libinput_device_get_latency_percentile().
+ *
+ * Events without a timestamp (@ref LIBINPUT_EVENT_DEVICE_ADDED and @ref
+ * LIBINPUT_EVENT_DEVICE_REMOVED) are not tracked. Latency tracking is
+ * disabled by default and intended for debugging and profiling only.
+ *
+ * Disabling latency tracking does not discard the data collected so far.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Non-zero to enable latency tracking, zero to disable it
+ *
+ * @see libinput_get_latency_tracking
+ */
+void
+libinput_set_latency_tracking(struct libinput *libinput,
+			      int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if latency tracking is enabled, zero otherwise
+ *
+ * @see libinput_set_latency_tracking
+ */
+int
+libinput_get_latency_tracking(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable pointer motion prediction, see
+ * libinput_event_pointer_get_predicted_dx(). The maximum horizon limits how
+ * far past the event time the motion is extrapolated, a target time further
+ * in the future is treated as the event time plus the maximum horizon.
+ * Prediction errors grow quickly with the horizon, a value of one or two
+ * frames of the display is a sensible choice.
+ *
+ * Motion prediction is disabled by default. Changing this setting only
+ * affects events processed afterwards.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param max_horizon The maximum horizon in microseconds, or 0 to disable
+ * motion prediction
+ *
+ * @see libinput_get_motion_prediction
+ */
+void
+libinput_set_motion_prediction(struct libinput *libinput,
+			       uint64_t max_horizon);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The maximum horizon for motion prediction in microseconds, or 0
+ * if motion prediction is disabled
+ *
+ * @see libinput_set_motion_prediction
+ */
+uint64_t
+libinput_get_motion_prediction(struct libinput *libinput);
+
+/**
+ * @ingroup device
+ *
+ * The stages of an event's latency, see
+ * libinput_device_get_latency_percentile().
+ */
+enum libinput_latency_stage {
+	/**
+	 * From the kernel timestamp of the event to the event being
+	 * queued, i.e. the time spent reading and processing the event.
+	 */
+	LIBINPUT_LATENCY_STAGE_PROCESSING = 1,
+	/**
+	 * From the event being queued to the event being returned by
+	 * libinput_get_event(), i.e. the time spent in the event queue.
+	 */
+	LIBINPUT_LATENCY_STAGE_QUEUED,
+	/**
+	 * From the kernel timestamp of the event to the event being
+	 * returned by libinput_get_event().
+	 */
+	LIBINPUT_LATENCY_STAGE_TOTAL,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the number of events of the given type that were recorded for
+ * this device while latency tracking was enabled, see
+ * libinput_set_latency_tracking().
+ *
+ * @param device The device to query
+ * @param type The event type
+ * @return The number of recorded events
+ */
+uint64_t
+libinput_device_get_latency_count(struct libinput_device *device,
+				  enum libinput_event_type type);
+
+/**
+ * @ingroup device
+ *
+ * Return the given percentile of the latency of the events of the given
+ * type for this device, in microseconds. Latencies are collected in
+ * buckets with a relative error of at most 25%, the value returned is the
+ * upper bound of the bucket the percentile falls into. A percentile of
+ * 100 returns the exact maximum latency.
+ *
+ * @param device The device to query
+ * @param type The event type
+ * @param stage The latency stage
+ * @param percentile The percentile in the range [0, 100]
+ * @return The latency in microseconds, or 0 if no events were recorded
+ *
+ * @see libinput_set_latency_tracking
+ * @see libinput_device_get_latency_count
+ */
+uint64_t
+libinput_device_get_latency_percentile(struct libinput_device *device,
+				       enum libinput_event_type type,
+				       enum libinput_latency_stage stage,
+				       double percentile);
+
+/**
+ * @ingroup device
+ *
+ * Statistics counters maintained for each device. These are intended for
+ * debugging and profiling only.
+ *
+ * @see libinput_device_get_statistic
+ */
+enum libinput_device_statistic {
+	/**
+	 * Number of times the kernel reported that events from this device
+	 * were lost because the device's event buffer overflowed
+	 * (SYN_DROPPED). libinput resynchronizes its state with the
+	 * device each time.
+	 */
+	LIBINPUT_DEVICE_STATISTIC_SYN_DROPPED = 1,
+	/**
+	 * The time in microseconds the most recent state resynchronization
+	 * after a SYN_DROPPED took.
+	 */
+	LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_LAST,
+	/**
+	 * The longest time in microseconds any state resynchronization
+	 * after a SYN_DROPPED took.
+	 */
+	LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_MAX,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the current value of the given statistics counter for this
+ * device. Counters start at zero when the device is added.
+ *
+ * @param device A previously obtained device
+ * @param statistic The statistics counter to query
+ * @return The current value of the counter, or 0 if the counter is
+ * unknown
+ */
+uint64_t
+libinput_device_get_statistic(struct libinput_device *device,
+			      enum libinput_device_statistic statistic);
+
 /**
  * @ingroup base
  *
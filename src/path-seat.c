@@ -355,7 +355,9 @@ libinput_path_add_device(struct libinput *libinput,
 		return NULL;
 	}
 
+	libinput_lock(libinput);
 	device = path_create_device(libinput, udev_device, NULL);
+	libinput_unlock(libinput);
 	udev_device_unref(udev_device);
 	return device;
 }
@@ -374,6 +376,8 @@ libinput_path_remove_device(struct libinput_device *device)
 		return;
 	}
 
+	libinput_lock(libinput);
+
 	list_for_each(dev, &input->path_list, link) {
 		if (dev->udev_device == evdev->udev_device) {
 			list_remove(&dev->link);
@@ -387,4 +391,6 @@ libinput_path_remove_device(struct libinput_device *device)
 	libinput_seat_ref(seat);
 	path_disable_device(libinput, evdev);
 	libinput_seat_unref(seat);
+
+	libinput_unlock(libinput);
 }
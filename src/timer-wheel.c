@@ -0,0 +1,253 @@
+/*
+ * Copyright © 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "timer-wheel.h"
+
+/* In LIBINPUT_TIMER_MODE_WHEEL, armed timers are in a hierarchical
+ * timing wheel with a resolution of one tick. A timer is in the level 0
+ * slot of its tick if that is less than 64 ticks away, otherwise in the
+ * slot of a higher level, whose timers are moved to the lower levels
+ * once the wheel reaches that slot.
+ *
+ * Each slot caches the earliest expiry tick of its timers so the next
+ * wakeup is found without walking the slots. Setting and cancelling a
+ * timer is O(1) regardless of the number of timers, except that
+ * removing the earliest timer of a level 1-3 slot rescans the other
+ * timers in that slot. Expiry times are rounded up to the next tick,
+ * the slack is not used.
+ */
+
+static inline uint64_t
+timer_wheel_level_ticks(unsigned int level)
+{
+	return 1ULL << (level * TIMER_WHEEL_BITS);
+}
+
+static inline uint64_t
+timer_wheel_expire_tick(const struct libinput_timer *timer)
+{
+	return (timer->expire + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK;
+}
+
+void
+timer_wheel_insert(struct libinput_timer_wheel *wheel,
+		   struct libinput_timer *timer)
+{
+	uint64_t tick = timer_wheel_expire_tick(timer);
+	uint64_t delta, max_delta;
+	unsigned int level, slot;
+
+	tick = max(tick, wheel->tick);
+	delta = tick - wheel->tick;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < timer_wheel_level_ticks(level + 1))
+			break;
+	}
+
+	/* too far out, re-inserted when the wheel gets there */
+	max_delta = timer_wheel_level_ticks(TIMER_WHEEL_LEVELS) - 1;
+	if (delta > max_delta)
+		tick = wheel->tick + max_delta;
+
+	slot = (tick >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+	list_insert(wheel->slots[level][slot].prev, &timer->link);
+	wheel->occupied[level] |= 1ULL << slot;
+	wheel->first[level][slot] = min(wheel->first[level][slot],
+					timer_wheel_expire_tick(timer));
+	wheel->count++;
+	timer->expire_index = level * TIMER_WHEEL_SLOTS + slot;
+}
+
+/* The timer must still have the expiry it was inserted with */
+void
+timer_wheel_remove(struct libinput_timer_wheel *wheel,
+		   struct libinput_timer *timer)
+{
+	unsigned int level = timer->expire_index / TIMER_WHEEL_SLOTS;
+	unsigned int slot = timer->expire_index % TIMER_WHEEL_SLOTS;
+	struct list *list = &wheel->slots[level][slot];
+	uint64_t *first = &wheel->first[level][slot];
+
+	list_remove(&timer->link);
+	wheel->count--;
+
+	if (list_empty(list)) {
+		wheel->occupied[level] &= ~(1ULL << slot);
+		*first = UINT64_MAX;
+		return;
+	}
+
+	/* level 0 slots only hold timers of one tick */
+	if (level > 0 && timer_wheel_expire_tick(timer) == *first) {
+		struct libinput_timer *t;
+
+		*first = UINT64_MAX;
+		list_for_each(t, list, link)
+			*first = min(*first, timer_wheel_expire_tick(t));
+	}
+}
+
+/* The first non-empty slot of the level that the wheel reaches, as the
+ * slot's index and the tick it is reached at. Returns false if the
+ * level is empty. */
+static bool
+timer_wheel_next_slot(struct libinput_timer_wheel *wheel,
+		      unsigned int level,
+		      unsigned int *slot_out,
+		      uint64_t *tick_out)
+{
+	unsigned int shift = level * TIMER_WHEEL_BITS;
+	uint64_t occupied = wheel->occupied[level];
+	uint64_t first;
+	unsigned int index, offset;
+
+	if (occupied == 0)
+		return false;
+
+	/* the first slot boundary at or after the current tick */
+	first = (wheel->tick + timer_wheel_level_ticks(level) - 1) >> shift;
+	index = first & (TIMER_WHEEL_SLOTS - 1);
+
+	/* rotate so bit 0 is the slot at that boundary */
+	if (index > 0)
+		occupied = (occupied >> index) |
+			   (occupied << (TIMER_WHEEL_SLOTS - index));
+	offset = __builtin_ctzll(occupied);
+
+	*slot_out = (index + offset) & (TIMER_WHEEL_SLOTS - 1);
+	*tick_out = (first + offset) << shift;
+
+	return true;
+}
+
+/* The first slot of a level holds the level's earliest timers, higher
+ * level slots are checked so we don't wake up just to move timers down
+ * a level. */
+uint64_t
+timer_wheel_first_tick(struct libinput_timer_wheel *wheel)
+{
+	uint64_t first = UINT64_MAX;
+	unsigned int level, slot;
+	uint64_t tick;
+
+	if (wheel->count == 0)
+		return 0;
+
+	if (timer_wheel_next_slot(wheel, 0, &slot, &tick))
+		first = tick;
+
+	for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		if (!timer_wheel_next_slot(wheel, level, &slot, &tick) ||
+		    tick >= first)
+			continue;
+
+		first = min(first, max(wheel->first[level][slot], wheel->tick));
+	}
+
+	return first;
+}
+
+void
+timer_wheel_collect(struct libinput_timer_wheel *wheel,
+		    uint64_t now,
+		    struct list *expired)
+{
+	uint64_t now_tick = now / TIMER_WHEEL_TICK;
+
+	while (wheel->tick <= now_tick) {
+		struct libinput_timer *timer, *tmp;
+		uint64_t next = UINT64_MAX, tick;
+		unsigned int level, slot;
+
+		for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+			if (timer_wheel_next_slot(wheel, level, &slot, &tick))
+				next = min(next, tick);
+		}
+
+		if (next > now_tick)
+			break;
+
+		wheel->tick = next;
+
+		/* higher levels first, their timers may move down to a
+		 * slot that is due at this tick too */
+		for (level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+			struct list *list;
+
+			if (next & (timer_wheel_level_ticks(level) - 1))
+				continue;
+
+			slot = (next >> (level * TIMER_WHEEL_BITS)) &
+			       (TIMER_WHEEL_SLOTS - 1);
+			list = &wheel->slots[level][slot];
+
+			/* the whole slot moves down, no need to keep its
+			 * earliest tick up to date while it empties */
+			wheel->first[level][slot] = UINT64_MAX;
+			list_for_each_safe(timer, tmp, list, link) {
+				timer_wheel_remove(wheel, timer);
+				timer_wheel_insert(wheel, timer);
+			}
+		}
+
+		slot = next & (TIMER_WHEEL_SLOTS - 1);
+		list_for_each_safe(timer, tmp, &wheel->slots[0][slot], link) {
+			timer_wheel_remove(wheel, timer);
+			timer->expire_index = TIMER_EXPIRED;
+			list_insert(expired->prev, &timer->link);
+		}
+
+		wheel->tick = next + 1;
+	}
+
+	wheel->tick = max(wheel->tick, now_tick + 1);
+}
+
+struct libinput_timer_wheel *
+timer_wheel_new(uint64_t now)
+{
+	struct libinput_timer_wheel *wheel;
+	unsigned int level, slot;
+
+	wheel = zalloc(sizeof(*wheel));
+	if (!wheel)
+		return NULL;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+			list_init(&wheel->slots[level][slot]);
+			wheel->first[level][slot] = UINT64_MAX;
+		}
+	}
+
+	wheel->tick = now / TIMER_WHEEL_TICK;
+
+	return wheel;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include "libinput-util.h"
+#include "timer.h"
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+/* hierarchical timing wheel of armed timers, see timer-wheel.c */
+struct libinput_timer_wheel {
+	/* level n slots are 64^n ticks wide */
+	struct list slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	uint64_t occupied[TIMER_WHEEL_LEVELS]; /* bitmask of non-empty slots */
+	/* earliest expiry tick in each slot, UINT64_MAX if empty */
+	uint64_t first[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	uint64_t tick; /* the first tick not yet processed */
+	size_t count;
+};
+
+/* The wheel's resolution, expiry times are rounded up to the next
+ * tick */
+#define TIMER_WHEEL_TICK ms2us(1)
+
+struct libinput_timer_wheel *
+timer_wheel_new(uint64_t now);
+
+/* Queue the timer for timer->expire */
+void
+timer_wheel_insert(struct libinput_timer_wheel *wheel,
+		   struct libinput_timer *timer);
+
+void
+timer_wheel_remove(struct libinput_timer_wheel *wheel,
+		   struct libinput_timer *timer);
+
+/* The earliest expiry tick of any timer in the wheel, 0 if empty */
+uint64_t
+timer_wheel_first_tick(struct libinput_timer_wheel *wheel);
+
+/* Advance the wheel to the tick of now, moving the timers due up to
+ * then to the expired list, ordered by their tick */
+void
+timer_wheel_collect(struct libinput_timer_wheel *wheel,
+		    uint64_t now,
+		    struct list *expired);
+
+#endif
@@ -26,12 +26,15 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/timerfd.h>
 #include <unistd.h>
 
 #include "libinput-private.h"
 #include "timer.h"
+#include "timer-wheel.h"
 
 void
 libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
@@ -41,29 +44,296 @@ libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
 	timer->libinput = libinput;
 	timer->timer_func = timer_func;
 	timer->timer_func_data = timer_func_data;
+	timer->slack = 0;
+}
+
+void
+libinput_timer_set_slack(struct libinput_timer *timer, uint64_t slack)
+{
+	timer->slack = slack;
+}
+
+static inline uint64_t
+timer_deadline(const struct libinput_timer *timer, uint64_t expire)
+{
+	if (!timer->libinput->timer.slack_enabled)
+		return expire;
+
+	return expire + timer->slack;
+}
+
+#define TIMER_HEAP_INITIAL_SIZE 32
+
+/* Armed timers are in two heaps: on the expiry time, to find the timers
+ * that are due, and on the deadline, the expiry time plus the slack, to
+ * find the latest time the timerfd may fire */
+
+static inline uint64_t
+timer_heap_key(const struct libinput_timer_heap *heap,
+	       const struct libinput_timer *timer)
+{
+	return heap->by_deadline ? timer->deadline : timer->expire;
+}
+
+static inline size_t *
+timer_heap_index(const struct libinput_timer_heap *heap,
+		 struct libinput_timer *timer)
+{
+	return heap->by_deadline ? &timer->deadline_index : &timer->expire_index;
+}
+
+static inline void
+timer_heap_set(struct libinput_timer_heap *heap,
+	       size_t index,
+	       struct libinput_timer *timer)
+{
+	heap->timers[index] = timer;
+	*timer_heap_index(heap, timer) = index;
 }
 
+static void
+timer_heap_sift_up(struct libinput_timer_heap *heap, size_t index)
+{
+	struct libinput_timer *timer = heap->timers[index];
+	uint64_t key = timer_heap_key(heap, timer);
+
+	while (index > 0) {
+		size_t parent = (index - 1) / 2;
+		struct libinput_timer *p = heap->timers[parent];
+
+		if (timer_heap_key(heap, p) <= key)
+			break;
+
+		timer_heap_set(heap, index, p);
+		index = parent;
+	}
+
+	timer_heap_set(heap, index, timer);
+}
+
+static void
+timer_heap_sift_down(struct libinput_timer_heap *heap, size_t index)
+{
+	struct libinput_timer **timers = heap->timers;
+	struct libinput_timer *timer = timers[index];
+	uint64_t key = timer_heap_key(heap, timer);
+	size_t n = heap->count;
+
+	while (true) {
+		size_t child = 2 * index + 1;
+
+		if (child >= n)
+			break;
+
+		if (child + 1 < n &&
+		    timer_heap_key(heap, timers[child + 1]) <
+		    timer_heap_key(heap, timers[child]))
+			child++;
+
+		if (key <= timer_heap_key(heap, timers[child]))
+			break;
+
+		timer_heap_set(heap, index, timers[child]);
+		index = child;
+	}
+
+	timer_heap_set(heap, index, timer);
+}
+
+/* Restore the heap order after the key of the timer at index changed */
+static void
+timer_heap_update(struct libinput_timer_heap *heap, size_t index)
+{
+	struct libinput_timer *timer = heap->timers[index];
+
+	if (index > 0 &&
+	    timer_heap_key(heap, heap->timers[(index - 1) / 2]) >
+	    timer_heap_key(heap, timer))
+		timer_heap_sift_up(heap, index);
+	else
+		timer_heap_sift_down(heap, index);
+}
+
+static bool
+timer_heap_reserve(struct libinput_timer_heap *heap)
+{
+	struct libinput_timer **timers;
+	size_t size;
+
+	if (heap->count < heap->size)
+		return true;
+
+	size = max(heap->size * 2, TIMER_HEAP_INITIAL_SIZE);
+	timers = realloc(heap->timers, size * sizeof(*timers));
+	if (!timers)
+		return false;
+
+	heap->timers = timers;
+	heap->size = size;
+
+	return true;
+}
+
+static void
+timer_heap_insert(struct libinput_timer_heap *heap,
+		  struct libinput_timer *timer)
+{
+	timer_heap_set(heap, heap->count++, timer);
+	timer_heap_sift_up(heap, heap->count - 1);
+}
+
+static void
+timer_heap_remove(struct libinput_timer_heap *heap,
+		  struct libinput_timer *timer)
+{
+	size_t index = *timer_heap_index(heap, timer);
+	struct libinput_timer *last;
+
+	last = heap->timers[--heap->count];
+	if (last == timer)
+		return;
+
+	timer_heap_set(heap, index, last);
+	timer_heap_update(heap, index);
+}
+
+static inline struct libinput_timer *
+timer_heap_first(struct libinput_timer_heap *heap)
+{
+	return heap->count > 0 ? heap->timers[0] : NULL;
+}
+
+/* Add the timer to the heaps or the wheel, timer->expire and
+ * timer->deadline are set. Returns false on allocation failure. */
+static bool
+timer_queue_add(struct libinput *libinput, struct libinput_timer *timer)
+{
+	if (libinput->timer.mode == LIBINPUT_TIMER_MODE_WHEEL) {
+		timer_wheel_insert(libinput->timer.wheel, timer);
+		return true;
+	}
+
+	if (!timer_heap_reserve(&libinput->timer.expire_heap) ||
+	    !timer_heap_reserve(&libinput->timer.deadline_heap))
+		return false;
+
+	timer_heap_insert(&libinput->timer.expire_heap, timer);
+	timer_heap_insert(&libinput->timer.deadline_heap, timer);
+
+	return true;
+}
+
+static void
+timer_queue_remove(struct libinput *libinput, struct libinput_timer *timer)
+{
+	if (libinput->timer.mode == LIBINPUT_TIMER_MODE_WHEEL) {
+		timer_wheel_remove(libinput->timer.wheel, timer);
+		return;
+	}
+
+	timer_heap_remove(&libinput->timer.expire_heap, timer);
+	timer_heap_remove(&libinput->timer.deadline_heap, timer);
+}
+
+/* Change the expiry of a queued timer. The wheel's earliest expiry per
+ * slot needs the expiry the timer was queued with, so the timer is
+ * removed before that changes. */
+static void
+timer_queue_update(struct libinput *libinput,
+		   struct libinput_timer *timer,
+		   uint64_t expire)
+{
+	if (libinput->timer.mode == LIBINPUT_TIMER_MODE_WHEEL) {
+		timer_wheel_remove(libinput->timer.wheel, timer);
+		timer->expire = expire;
+		timer->deadline = timer_deadline(timer, expire);
+		timer_wheel_insert(libinput->timer.wheel, timer);
+		return;
+	}
+
+	timer->expire = expire;
+	timer->deadline = timer_deadline(timer, expire);
+	timer_heap_update(&libinput->timer.expire_heap, timer->expire_index);
+	timer_heap_update(&libinput->timer.deadline_heap, timer->deadline_index);
+}
+
+/* The time the timerfd should fire at, 0 if no timer is armed */
+static uint64_t
+timer_queue_next_wakeup(struct libinput *libinput)
+{
+	struct libinput_timer *first;
+
+	if (libinput->timer.mode == LIBINPUT_TIMER_MODE_WHEEL)
+		return timer_wheel_first_tick(libinput->timer.wheel) *
+			TIMER_WHEEL_TICK;
+
+	first = timer_heap_first(&libinput->timer.deadline_heap);
+
+	return first ? first->deadline : 0;
+}
+
+/* Move all timers due at now to the expired list, in expiry order */
+static void
+timer_queue_collect(struct libinput *libinput,
+		    uint64_t now,
+		    struct list *expired)
+{
+	struct libinput_timer *timer;
+
+	if (libinput->timer.mode == LIBINPUT_TIMER_MODE_WHEEL) {
+		timer_wheel_collect(libinput->timer.wheel, now, expired);
+		return;
+	}
+
+	while ((timer = timer_heap_first(&libinput->timer.expire_heap)) &&
+	       timer->expire <= now) {
+		timer_heap_remove(&libinput->timer.expire_heap, timer);
+		timer_heap_remove(&libinput->timer.deadline_heap, timer);
+		timer->expire_index = TIMER_EXPIRED;
+		list_insert(expired->prev, &timer->link);
+	}
+}
+
+static size_t
+timer_queue_count(struct libinput *libinput)
+{
+	if (libinput->timer.mode == LIBINPUT_TIMER_MODE_WHEEL)
+		return libinput->timer.wheel->count;
+
+	return libinput->timer.expire_heap.count;
+}
+
+/* Only touch the timerfd if the next wakeup changed, most timer
+ * updates are for timers that aren't the next one to expire. In heap
+ * mode the timerfd fires at the earliest deadline, all timers whose
+ * expiry time has passed by then are handled in that same wakeup. */
 static void
 libinput_timer_arm_timer_fd(struct libinput *libinput)
 {
 	int r;
-	struct libinput_timer *timer;
 	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
-	uint64_t earliest_expire = UINT64_MAX;
+	uint64_t next_wakeup;
 
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire < earliest_expire)
-			earliest_expire = timer->expire;
-	}
+	if (libinput->timer.in_handler)
+		return;
+
+	next_wakeup = timer_queue_next_wakeup(libinput);
+	if (next_wakeup == libinput->timer.fd_expire)
+		return;
 
-	if (earliest_expire != UINT64_MAX) {
-		its.it_value.tv_sec = earliest_expire / ms2us(1000);
-		its.it_value.tv_nsec = (earliest_expire % ms2us(1000)) * 1000;
+	if (next_wakeup != 0) {
+		its.it_value.tv_sec = next_wakeup / ms2us(1000);
+		its.it_value.tv_nsec = (next_wakeup % ms2us(1000)) * 1000;
 	}
 
 	r = timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL);
-	if (r)
+	if (r) {
 		log_error(libinput, "timer: timerfd_settime error: %s\n", strerror(errno));
+		return;
+	}
+
+	libinput->timer.fd_expire = next_wakeup;
+	libinput->timer.fd_updates++;
 }
 
 void
@@ -71,6 +341,8 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 			 uint64_t expire,
 			 uint32_t flags)
 {
+	struct libinput *libinput = timer->libinput;
+
 #ifndef NDEBUG
 	uint64_t now = libinput_now(timer->libinput);
 	if (expire < now) {
@@ -88,11 +360,23 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 
 	assert(expire);
 
-	if (!timer->expire)
-		list_insert(&timer->libinput->timer.list, &timer->link);
+	if (timer->expire && timer->expire_index != TIMER_EXPIRED) {
+		timer_queue_update(libinput, timer, expire);
+	} else {
+		if (timer->expire)
+			list_remove(&timer->link);
 
-	timer->expire = expire;
-	libinput_timer_arm_timer_fd(timer->libinput);
+		timer->expire = expire;
+		timer->deadline = timer_deadline(timer, expire);
+		if (!timer_queue_add(libinput, timer)) {
+			log_error(libinput,
+				  "timer: failed to allocate memory, timer dropped\n");
+			timer->expire = 0;
+			return;
+		}
+	}
+
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 void
@@ -104,19 +388,26 @@ libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 void
 libinput_timer_cancel(struct libinput_timer *timer)
 {
+	struct libinput *libinput = timer->libinput;
+
 	if (!timer->expire)
 		return;
 
+	if (timer->expire_index == TIMER_EXPIRED)
+		list_remove(&timer->link);
+	else
+		timer_queue_remove(libinput, timer);
+
 	timer->expire = 0;
-	list_remove(&timer->link);
-	libinput_timer_arm_timer_fd(timer->libinput);
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 static void
 libinput_timer_handler(void *data)
 {
 	struct libinput *libinput = data;
-	struct libinput_timer *timer, *tmp;
+	struct libinput_timer *timer;
+	struct list expired;
 	uint64_t now;
 	uint64_t discard;
 	int r;
@@ -132,14 +423,34 @@ libinput_timer_handler(void *data)
 	if (now == 0)
 		return;
 
-	list_for_each_safe(timer, tmp, &libinput->timer.list, link) {
-		if (timer->expire <= now) {
-			/* Clear the timer before calling timer_func,
-			   as timer_func may re-arm it */
-			libinput_timer_cancel(timer);
-			timer->timer_func(now, timer->timer_func_data);
-		}
+	libinput->timer.wakeups++;
+
+	/* A timerfd that expired is disarmed */
+	if (libinput->timer.fd_expire <= now)
+		libinput->timer.fd_expire = 0;
+
+	/* Collect all due timers first, including those still within
+	 * their slack, they all run in this one wakeup. A timer_func may
+	 * re-arm its timer with an expiry that's already in the past,
+	 * those run on the next call. */
+	list_init(&expired);
+	timer_queue_collect(libinput, now, &expired);
+
+	libinput->timer.in_handler = true;
+	while (!list_empty(&expired)) {
+		timer = list_first_entry(&expired, timer, link);
+
+		/* Clear the timer before calling timer_func,
+		   as timer_func may re-arm or cancel it, or cancel
+		   other expired timers */
+		list_remove(&timer->link);
+		timer->expire = 0;
+		libinput->timer.expiries++;
+		timer->timer_func(now, timer->timer_func_data);
 	}
+	libinput->timer.in_handler = false;
+
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 int
@@ -150,13 +461,25 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	if (libinput->timer.fd < 0)
 		return -1;
 
-	list_init(&libinput->timer.list);
+	libinput->timer.expire_heap.by_deadline = false;
+	libinput->timer.deadline_heap.by_deadline = true;
+	if (!timer_heap_reserve(&libinput->timer.expire_heap) ||
+	    !timer_heap_reserve(&libinput->timer.deadline_heap)) {
+		free(libinput->timer.expire_heap.timers);
+		close(libinput->timer.fd);
+		return -1;
+	}
+	libinput->timer.fd_expire = 0;
+	libinput->timer.mode = LIBINPUT_TIMER_MODE_HEAP;
+	libinput->timer.slack_enabled = true;
 
 	libinput->timer.source = libinput_add_fd(libinput,
 						 libinput->timer.fd,
 						 libinput_timer_handler,
 						 libinput);
 	if (!libinput->timer.source) {
+		free(libinput->timer.expire_heap.timers);
+		free(libinput->timer.deadline_heap.timers);
 		close(libinput->timer.fd);
 		return -1;
 	}
@@ -164,12 +487,41 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	return 0;
 }
 
+int
+libinput_timer_subsys_set_mode(struct libinput *libinput,
+			       enum libinput_timer_mode mode)
+{
+	struct libinput_timer_wheel *wheel = NULL;
+
+	if (mode == libinput->timer.mode)
+		return 0;
+
+	/* armed timers would have to be moved over */
+	if (timer_queue_count(libinput) > 0)
+		return -1;
+
+	if (mode == LIBINPUT_TIMER_MODE_WHEEL) {
+		wheel = timer_wheel_new(libinput_now(libinput));
+		if (!wheel)
+			return -1;
+	}
+
+	free(libinput->timer.wheel);
+	libinput->timer.wheel = wheel;
+	libinput->timer.mode = mode;
+
+	return 0;
+}
+
 void
 libinput_timer_subsys_destroy(struct libinput *libinput)
 {
 	/* All timer users should have destroyed their timers now */
-	assert(list_empty(&libinput->timer.list));
+	assert(timer_queue_count(libinput) == 0);
 
 	libinput_remove_source(libinput, libinput->timer.source);
 	close(libinput->timer.fd);
+	free(libinput->timer.expire_heap.timers);
+	free(libinput->timer.deadline_heap.timers);
+	free(libinput->timer.wheel);
 }
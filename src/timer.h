@@ -26,23 +26,43 @@
 
 #include <stdint.h>
 
+#include "libinput.h"
 #include "libinput-util.h"
 
 struct libinput;
 
 struct libinput_timer {
 	struct libinput *libinput;
-	struct list link;
-	uint64_t expire; /* in absolute us CLOCK_MONOTONIC */
+	/* heap indices or the wheel slot, only valid if expire is set */
+	size_t expire_index;
+	size_t deadline_index;
+	struct list link; /* in a wheel slot or the list of expired timers */
+	uint64_t expire; /* in absolute us CLOCK_MONOTONIC, 0 if unset */
+	uint64_t slack; /* in us, see libinput_timer_set_slack() */
+	uint64_t deadline; /* expire + slack */
 	void (*timer_func)(uint64_t now, void *timer_func_data);
 	void *timer_func_data;
 };
 
+/* expire_index of a timer that expired and waits for its timer_func to
+ * be called, see libinput_timer_handler() */
+#define TIMER_EXPIRED SIZE_MAX
+
 void
 libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
 		    void (*timer_func)(uint64_t now, void *timer_func_data),
 		    void *timer_func_data);
 
+/* Allow the timer to fire up to slack us after its expire time so its
+ * expiry can be handled in the same wakeup as other timers. Takes
+ * effect the next time the timer is set. */
+void
+libinput_timer_set_slack(struct libinput_timer *timer, uint64_t slack);
+
+/* Slack for timeouts that implement a user-visible delay, these may be
+ * a few ms late without being noticed */
+#define TIMER_SLACK_DEFAULT ms2us(10)
+
 /* Set timer expire time, in absolute us CLOCK_MONOTONIC */
 void
 libinput_timer_set(struct libinput_timer *timer, uint64_t expire);
@@ -63,6 +83,10 @@ libinput_timer_cancel(struct libinput_timer *timer);
 int
 libinput_timer_subsys_init(struct libinput *libinput);
 
+int
+libinput_timer_subsys_set_mode(struct libinput *libinput,
+			       enum libinput_timer_mode mode);
+
 void
 libinput_timer_subsys_destroy(struct libinput *libinput);
 
@@ -375,6 +375,7 @@ libinput_udev_assign_seat(struct libinput *libinput,
 			  const char *seat_id)
 {
 	struct udev_input *input = (struct udev_input*)libinput;
+	int rc;
 
 	if (!seat_id)
 		return -1;
@@ -389,8 +390,9 @@ libinput_udev_assign_seat(struct libinput *libinput,
 
 	input->seat_id = strdup(seat_id);
 
-	if (udev_input_enable(&input->base) < 0)
-		return -1;
+	libinput_lock(libinput);
+	rc = udev_input_enable(&input->base);
+	libinput_unlock(libinput);
 
-	return 0;
+	return rc < 0 ? -1 : 0;
 }
@@ -3205,7 +3205,7 @@ litest_assert_touch_sequence(struct libinput *li)
 void
 litest_timeout_tap(void)
 {
-	msleep(200);
+	msleep(210);
 }
 
 void
@@ -3217,7 +3217,7 @@ litest_timeout_tapndrag(void)
 void
 litest_timeout_softbuttons(void)
 {
-	msleep(300);
+	msleep(320);
 }
 
 void
@@ -3229,37 +3229,37 @@ litest_timeout_buttonscroll(void)
 void
 litest_timeout_finger_switch(void)
 {
-	msleep(120);
+	msleep(130);
 }
 
 void
 litest_timeout_edgescroll(void)
 {
-	msleep(300);
+	msleep(320);
 }
 
 void
 litest_timeout_middlebutton(void)
 {
-	msleep(70);
+	msleep(80);
 }
 
 void
 litest_timeout_dwt_short(void)
 {
-	msleep(220);
+	msleep(230);
 }
 
 void
 litest_timeout_dwt_long(void)
 {
-	msleep(520);
+	msleep(530);
 }
 
 void
 litest_timeout_gesture(void)
 {
-	msleep(120);
+	msleep(130);
 }
 
 void
@@ -3271,7 +3271,7 @@ litest_timeout_gesture_scroll(void)
 void
 litest_timeout_trackpoint(void)
 {
-	msleep(320);
+	msleep(330);
 }
 
 void
@@ -3612,6 +3612,7 @@ main(int argc, char **argv)
 	litest_setup_tests_device();
 	litest_setup_tests_gestures();
 	litest_setup_tests_lid();
+	litest_setup_tests_filter();
 
 	if (mode == LITEST_MODE_LIST) {
 		litest_list_tests(&all_tests);
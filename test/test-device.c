@@ -1593,6 +1593,155 @@ START_TEST(device_seat_phys_name)
 }
 END_TEST
 
+START_TEST(device_statistic_syn_dropped)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+
+	/* see device_syn_dropped_* for the counters after an overflow */
+	ck_assert_int_eq(libinput_device_get_statistic(device,
+						       LIBINPUT_DEVICE_STATISTIC_SYN_DROPPED),
+			 0);
+	ck_assert_int_eq(libinput_device_get_statistic(device,
+						       LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_LAST),
+			 0);
+	ck_assert_int_eq(libinput_device_get_statistic(device,
+						       LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_MAX),
+			 0);
+}
+END_TEST
+
+static void
+assert_resync_statistics(struct libinput_device *device)
+{
+	uint64_t last, max;
+
+	ck_assert_int_eq(libinput_device_get_statistic(device,
+						       LIBINPUT_DEVICE_STATISTIC_SYN_DROPPED),
+			 1);
+
+	last = libinput_device_get_statistic(device,
+				LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_LAST);
+	max = libinput_device_get_statistic(device,
+				LIBINPUT_DEVICE_STATISTIC_RESYNC_TIME_MAX);
+	ck_assert_int_ge(max, last);
+}
+
+START_TEST(device_syn_dropped_keys)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int i;
+
+	litest_drain_events(li);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	/* Without reading, the kernel buffer overflows and the release
+	 * of KEY_A is lost */
+	litest_keyboard_key(dev, KEY_A, false);
+	for (i = 0; i < 1000; i++) {
+		litest_keyboard_key(dev, KEY_B, true);
+		litest_keyboard_key(dev, KEY_B, false);
+	}
+
+	libinput_dispatch(li);
+
+	/* KEY_A is released by the resync, KEY_B is up just like before
+	 * the overflow */
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	assert_resync_statistics(dev->libinput_device);
+
+	/* and we're back in sync */
+	litest_keyboard_key(dev, KEY_B, true);
+	litest_keyboard_key(dev, KEY_B, false);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_B, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_B, LIBINPUT_KEY_STATE_RELEASED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(device_syn_dropped_touch)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	double x, y;
+	int i;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 20, 20);
+	litest_drain_events(li);
+
+	/* Without reading, the kernel buffer overflows: the first touch
+	 * ends and a second one starts and moves while we're not
+	 * looking */
+	litest_touch_up(dev, 0);
+	litest_touch_down(dev, 1, 50, 50);
+	for (i = 0; i < 1000; i++)
+		litest_touch_move(dev, 1, 50 + i % 20, 50);
+	litest_touch_move(dev, 1, 70, 70);
+
+	libinput_dispatch(li);
+
+	/* the resync ends the first touch and starts the second one at
+	 * its current position */
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_UP);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 0);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_DOWN);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 1);
+	x = libinput_event_touch_get_x_transformed(tev, 100);
+	y = libinput_event_touch_get_y_transformed(tev, 100);
+	ck_assert_double_ge(x, 69.0);
+	ck_assert_double_le(x, 71.0);
+	ck_assert_double_ge(y, 69.0);
+	ck_assert_double_le(y, 71.0);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	assert_resync_statistics(dev->libinput_device);
+
+	/* and we're back in sync, the kernel continues in slot 1 */
+	litest_touch_move(dev, 1, 60, 60);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	tev = litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_MOTION);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 1);
+	libinput_event_destroy(event);
+
+	litest_touch_up(dev, 1);
+	litest_drain_events(li);
+}
+END_TEST
+
 void
 litest_setup_tests_device(void)
 {
@@ -1673,4 +1822,8 @@ litest_setup_tests_device(void)
 	litest_add("device:output", device_no_output, LITEST_KEYS, LITEST_ANY);
 
 	litest_add("device:seat", device_seat_phys_name, LITEST_ANY, LITEST_ANY);
+
+	litest_add("device:statistic", device_statistic_syn_dropped, LITEST_ANY, LITEST_ANY);
+	litest_add_for_device("device:statistic", device_syn_dropped_keys, LITEST_KEYBOARD);
+	litest_add_for_device("device:statistic", device_syn_dropped_touch, LITEST_GENERIC_MULTITOUCH_SCREEN);
 }
@@ -0,0 +1,512 @@
+/*
+ * Copyright © 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <math.h>
+#include <string.h>
+
+#include "litest.h"
+#include "filter.h"
+
+struct profile_filter {
+	struct motion_filter *(*create)(int dpi);
+	accel_profile_func_t profile;
+	int dpi;
+};
+
+static const struct profile_filter profile_filters[] = {
+	{ create_pointer_accelerator_filter_linear,
+	  pointer_accel_profile_linear, 1000 },
+	{ create_pointer_accelerator_filter_linear,
+	  pointer_accel_profile_linear, 5000 },
+	{ create_pointer_accelerator_filter_linear_low_dpi,
+	  pointer_accel_profile_linear_low_dpi, 400 },
+	{ create_pointer_accelerator_filter_touchpad,
+	  touchpad_accel_profile_linear, 1000 },
+	{ create_pointer_accelerator_filter_trackpoint,
+	  trackpoint_accel_profile, 1000 },
+};
+
+/* The largest difference between the profile table and the profile.
+ * The linear interpolation is exact except for the segment
+ * containing a kink of the curve. The x230 profile isn't listed, it
+ * has a step at the threshold that the table interpolates across. */
+#define PROFILE_TABLE_TOLERANCE 0.01
+
+START_TEST(filter_profile_table)
+{
+	const struct profile_filter *p = &profile_filters[_i]; /* ranged test */
+	struct motion_filter *filter;
+	double speeds[] = { -1.0, -0.5, 0.0, 0.3, 1.0 };
+	double *speed;
+
+	filter = p->create(p->dpi);
+	ck_assert_notnull(filter);
+
+	ARRAY_FOR_EACH(speeds, speed) {
+		double mmps;
+
+		ck_assert(filter_set_speed(filter, *speed));
+
+		/* Same range as ptraccel-debug --mode=accel, in 0.1 mm/s
+		 * steps */
+		for (mmps = 0.0; mmps < 1000.0; mmps += 0.1) {
+			double v = mmps * p->dpi/25.4/1e6; /* units/us */
+			double expected = p->profile(filter, NULL, v, 0);
+			double factor = filter_get_accel_factor(filter, v);
+
+			ck_assert(fabs(factor - expected) <
+				  PROFILE_TABLE_TOLERANCE);
+		}
+
+		/* beyond the table we get the profile itself */
+		litest_assert_double_eq(filter_get_accel_factor(filter, 1.0),
+					p->profile(filter, NULL, 1.0, 0));
+	}
+
+	filter_destroy(filter);
+}
+END_TEST
+
+/* The velocity calculation as it was before the trackers stored prefix
+ * sums: every tracker accumulates the deltas since its own event. */
+#define REF_MAX_VELOCITY_DIFF 0.001 /* units/us */
+#define REF_MOTION_TIMEOUT ms2us(1000)
+
+struct ref_tracker {
+	struct device_float_coords delta;
+	uint64_t time;
+	uint32_t dir;
+};
+
+struct ref_trackers {
+	struct ref_tracker trackers[64];
+	unsigned int ntrackers;
+	unsigned int cur;
+};
+
+static struct ref_tracker *
+ref_tracker_by_offset(struct ref_trackers *r, unsigned int offset)
+{
+	return &r->trackers[(r->cur + r->ntrackers - offset) % r->ntrackers];
+}
+
+static double
+ref_tracker_velocity(struct ref_tracker *t, uint64_t time)
+{
+	return hypot(t->delta.x, t->delta.y) / (time - t->time + 1);
+}
+
+static double
+ref_velocity(struct ref_trackers *r,
+	     const struct device_float_coords *delta,
+	     uint64_t time)
+{
+	struct ref_tracker *t;
+	double velocity, result = 0.0, initial_velocity = 0.0;
+	unsigned int offset, i, dir;
+
+	for (i = 0; i < r->ntrackers; i++) {
+		r->trackers[i].delta.x += delta->x;
+		r->trackers[i].delta.y += delta->y;
+	}
+	r->cur = (r->cur + 1) % r->ntrackers;
+	r->trackers[r->cur].delta.x = 0.0;
+	r->trackers[r->cur].delta.y = 0.0;
+	r->trackers[r->cur].time = time;
+	r->trackers[r->cur].dir = device_float_get_direction(*delta);
+
+	dir = r->trackers[r->cur].dir;
+	for (offset = 1; offset < r->ntrackers; offset++) {
+		t = ref_tracker_by_offset(r, offset);
+
+		if (t->time > time)
+			break;
+
+		if (time - t->time > REF_MOTION_TIMEOUT) {
+			if (offset == 1)
+				result = ref_tracker_velocity(t,
+						t->time + REF_MOTION_TIMEOUT);
+			break;
+		}
+
+		velocity = ref_tracker_velocity(t, time);
+
+		dir &= t->dir;
+		if (dir == 0) {
+			if (offset == 1)
+				result = velocity;
+			break;
+		}
+
+		if (initial_velocity == 0.0) {
+			result = initial_velocity = velocity;
+		} else {
+			if (fabs(initial_velocity - velocity) > REF_MAX_VELOCITY_DIFF)
+				break;
+			result = velocity;
+		}
+	}
+
+	return result;
+}
+
+START_TEST(filter_tracker_count)
+{
+	struct motion_filter *f16, *f64;
+	struct ref_trackers r16 = { .ntrackers = 16 },
+			    r64 = { .ntrackers = 64 };
+	uint64_t time = ms2us(1000);
+	double min_factor = 100.0, max_factor = 0.0;
+	unsigned int seed = 1;
+	int i;
+
+	f16 = create_pointer_accelerator_filter_linear(1000);
+	f64 = create_pointer_accelerator_filter_linear(1000);
+	ck_assert_notnull(f16);
+	ck_assert_notnull(f64);
+	filter_set_speed(f16, 0.0);
+	filter_set_speed(f64, 0.0);
+
+	ck_assert(!filter_set_tracker_count(f64, 0));
+	ck_assert(!filter_set_tracker_count(f64, 1));
+	ck_assert(filter_set_tracker_count(f64, 64));
+
+	/* Integer deltas of 1 to 4 units every 2 to 10ms, i.e. up to
+	 * 2 units/ms: the profile isn't capped and the accel factor
+	 * depends on the velocity. With integer deltas the sums are exact,
+	 * the velocity is the same as that of the per-tracker deltas. The
+	 * direction changes every now and then. */
+	for (i = 0; i < 20000; i++) {
+		struct device_float_coords delta;
+		struct normalized_coords a, b;
+		double factor;
+
+		seed = seed * 1103515245 + 12345;
+		delta.x = 1 + (seed >> 16) % 4;
+		delta.y = (seed >> 20) % 3;
+		if ((i / 500) % 2)
+			delta.x = -delta.x;
+		time += ms2us(2 + (seed >> 24) % 9);
+
+		a = filter_dispatch(f16, &delta, NULL, time);
+		b = filter_dispatch(f64, &delta, NULL, time);
+
+		/* velocities are around 1e-3 units/us */
+		ck_assert(fabs(filter_get_velocity(f16) -
+			       ref_velocity(&r16, &delta, time)) < 1e-12);
+		ck_assert(fabs(filter_get_velocity(f64) -
+			       ref_velocity(&r64, &delta, time)) < 1e-12);
+
+		factor = hypot(a.x, a.y) / hypot(delta.x, delta.y);
+		min_factor = min(min_factor, factor);
+		max_factor = max(max_factor, factor);
+		ck_assert(b.x != 0.0);
+	}
+
+	/* we went through a good part of the curve */
+	ck_assert_double_lt(min_factor, 1.0);
+	ck_assert_double_gt(max_factor, 1.5);
+
+	filter_destroy(f16);
+	filter_destroy(f64);
+}
+END_TEST
+
+START_TEST(filter_tracker_rebase)
+{
+	struct motion_filter *f16, *f64;
+	struct device_float_coords delta = { 300.0, 200.0 };
+	const double expected = hypot(300.0, 200.0)/126; /* units/us */
+	uint64_t time = ms2us(1000);
+	int i;
+
+	f16 = create_pointer_accelerator_filter_linear(1000);
+	f64 = create_pointer_accelerator_filter_linear(1000);
+	ck_assert_notnull(f16);
+	ck_assert_notnull(f64);
+	filter_set_speed(f16, 0.0);
+	filter_set_speed(f64, 0.0);
+	ck_assert(filter_set_tracker_count(f64, 64));
+
+	/* Constant motion at 8kHz, the large deltas make the trackers move
+	 * their origin a few times. The velocity differs too much between
+	 * the most recent trackers for averaging, it's always that of the
+	 * last event, over its 125us + 1. */
+	for (i = 0; i < 10000; i++) {
+		time += 125;
+		filter_dispatch(f16, &delta, NULL, time);
+		filter_dispatch(f64, &delta, NULL, time);
+
+		if (i < 1)
+			continue;
+
+		ck_assert(fabs(filter_get_velocity(f16) - expected) < 1e-9);
+		ck_assert(fabs(filter_get_velocity(f64) - expected) < 1e-9);
+	}
+
+	filter_destroy(f16);
+	filter_destroy(f64);
+}
+END_TEST
+
+START_TEST(filter_velocity_dispatch)
+{
+	struct motion_filter *trackers, *velocity;
+	struct device_float_coords delta = { 3.0, 4.0 }; /* 5 units */
+	struct normalized_coords a, b;
+	uint64_t time = ms2us(1000);
+	double factor = 0.0, first_factor = 0.0;
+	int i;
+
+	trackers = create_pointer_accelerator_filter_touchpad(1000);
+	velocity = create_pointer_accelerator_filter_touchpad(1000);
+	ck_assert_notnull(trackers);
+	ck_assert_notnull(velocity);
+	filter_set_speed(trackers, 0.0);
+	filter_set_speed(velocity, 0.0);
+
+	/* Constant motion, the trackers see the same velocity as the one
+	 * we pass in. The first two events differ, the trackers start
+	 * without a velocity. */
+	for (i = 0; i < 100; i++) {
+		time += ms2us(8);
+		a = filter_dispatch(trackers, &delta, NULL, time);
+		b = filter_dispatch_velocity(velocity,
+					     &delta,
+					     5.0/ms2us(8),
+					     NULL,
+					     time);
+		if (i < 2)
+			continue;
+
+		ck_assert(fabs(a.x - b.x) < 1e-9);
+		ck_assert(fabs(a.y - b.y) < 1e-9);
+	}
+
+	/* Accelerating motion, the deltas grow by 20 units per event.
+	 * That's more than MAX_VELOCITY_DIFF between the last and the
+	 * previous two events, so the trackers only use the last event.
+	 * The trackers add 1us to the time delta. */
+	for (i = 2; i <= 20; i++) {
+		struct device_float_coords d = { 12.0 * i, 16.0 * i };
+
+		time += ms2us(8);
+		a = filter_dispatch(trackers, &d, NULL, time);
+		b = filter_dispatch_velocity(velocity,
+					     &d,
+					     20.0 * i/(ms2us(8) + 1),
+					     NULL,
+					     time);
+		ck_assert(fabs(a.x - b.x) < 1e-9);
+		ck_assert(fabs(a.y - b.y) < 1e-9);
+
+		ck_assert(b.x/d.x >= factor);
+		factor = b.x/d.x;
+		if (i == 2)
+			first_factor = factor;
+	}
+
+	/* and the motion did accelerate */
+	ck_assert(factor > 2 * first_factor);
+
+	/* A faster velocity accelerates the same delta more */
+	time += ms2us(8);
+	a = filter_dispatch(trackers, &delta, NULL, time);
+	b = filter_dispatch_velocity(velocity,
+				     &delta,
+				     1000.0/ms2us(8),
+				     NULL,
+				     time);
+	ck_assert(b.x > a.x);
+	ck_assert(b.y > a.y);
+
+	filter_destroy(trackers);
+	filter_destroy(velocity);
+}
+END_TEST
+
+struct velocity_filter {
+	struct motion_filter *(*create)(int dpi);
+	int dpi;
+};
+
+static const struct velocity_filter velocity_filters[] = {
+	{ create_pointer_accelerator_filter_linear, 1000 },
+	{ create_pointer_accelerator_filter_linear, 1600 },
+	{ create_pointer_accelerator_filter_linear, 5000 },
+	{ create_pointer_accelerator_filter_linear_low_dpi, 400 },
+	{ create_pointer_accelerator_filter_touchpad, 1000 },
+	{ create_pointer_accelerator_filter_touchpad, 1600 },
+	{ create_pointer_accelerator_filter_lenovo_x230, 1000 },
+	{ create_pointer_accelerator_filter_lenovo_x230, 2000 },
+	{ create_pointer_accelerator_filter_trackpoint, 1000 },
+};
+
+START_TEST(filter_velocity_units)
+{
+	const struct velocity_filter *v = &velocity_filters[_i]; /* ranged test */
+	struct motion_filter *filter;
+	struct device_float_coords delta = { 3.0, 4.0 }; /* 5 units */
+	uint64_t time = ms2us(1000);
+	double expected = 5.0/ms2us(8);
+	int i;
+
+	filter = v->create(v->dpi);
+	ck_assert_notnull(filter);
+
+	/* The velocity is in device units/us, whatever the filter
+	 * normalizes internally. The trackers add 1us to the time
+	 * delta, close enough over 15 trackers. */
+	for (i = 0; i < 50; i++) {
+		time += ms2us(8);
+		filter_dispatch(filter, &delta, NULL, time);
+	}
+
+	ck_assert(fabs(filter_get_velocity(filter) - expected) <
+		  expected * 1e-4);
+
+	filter_destroy(filter);
+}
+END_TEST
+
+enum batch_filter {
+	BATCH_LINEAR,
+	BATCH_LOW_DPI,
+	BATCH_TOUCHPAD,
+	BATCH_X230,
+	BATCH_TRACKPOINT,
+	BATCH_FLAT,
+	BATCH_TABLET_PEN,
+	BATCH_TABLET_MOUSE,
+	BATCH_FILTER_COUNT,
+};
+
+static struct motion_filter *
+create_batch_filter(enum batch_filter which)
+{
+	switch (which) {
+	case BATCH_LINEAR:
+		return create_pointer_accelerator_filter_linear(1600);
+	case BATCH_LOW_DPI:
+		return create_pointer_accelerator_filter_linear_low_dpi(400);
+	case BATCH_TOUCHPAD:
+		return create_pointer_accelerator_filter_touchpad(1000);
+	case BATCH_X230:
+		return create_pointer_accelerator_filter_lenovo_x230(1000);
+	case BATCH_TRACKPOINT:
+		return create_pointer_accelerator_filter_trackpoint(1000);
+	case BATCH_FLAT:
+		return create_pointer_accelerator_filter_flat(1000);
+	case BATCH_TABLET_PEN:
+	case BATCH_TABLET_MOUSE:
+		return create_pointer_accelerator_filter_tablet(100, 200);
+	default:
+		litest_abort_msg("Invalid filter %d\n", which);
+	}
+}
+
+#define BATCH_EVENTS 1000
+
+START_TEST(filter_batch_dispatch)
+{
+	enum batch_filter which = _i; /* ranged test */
+	struct motion_filter *scalar, *batch;
+	struct libinput_tablet_tool tool = {
+		.type = which == BATCH_TABLET_MOUSE ?
+			LIBINPUT_TABLET_TOOL_TYPE_MOUSE :
+			LIBINPUT_TABLET_TOOL_TYPE_PEN,
+	};
+	double dx[BATCH_EVENTS], dy[BATCH_EVENTS];
+	double x[BATCH_EVENTS], y[BATCH_EVENTS];
+	uint64_t time[BATCH_EVENTS];
+	uint64_t t = ms2us(1000);
+	size_t sizes[] = { 1, 3, 64, 65, 200 };
+	size_t *size = sizes;
+	size_t i, n;
+
+	scalar = create_batch_filter(which);
+	batch = create_batch_filter(which);
+	ck_assert_notnull(scalar);
+	ck_assert_notnull(batch);
+	filter_set_speed(scalar, 0.4);
+	filter_set_speed(batch, 0.4);
+
+	/* Fast, slow, changing direction and pauses */
+	for (i = 0; i < BATCH_EVENTS; i++) {
+		dx[i] = ((int)(i * 7 % 23) - 11) * 0.5;
+		dy[i] = ((int)(i * 5 % 17) - 4) * 0.25;
+		t += (i % 97 == 0) ? ms2us(300) : 800 + i % 7 * 100;
+		time[i] = t;
+	}
+
+	/* Batches of various sizes must give the same result as one
+	 * event at a time, to the last bit */
+	for (i = 0; i < BATCH_EVENTS; i += n) {
+		size_t j;
+
+		n = min(*size, BATCH_EVENTS - i);
+		if (++size == sizes + ARRAY_LENGTH(sizes))
+			size = sizes;
+
+		filter_dispatch_batch(batch,
+				      n,
+				      &dx[i], &dy[i],
+				      &time[i],
+				      &tool,
+				      &x[i], &y[i]);
+
+		for (j = i; j < i + n; j++) {
+			struct device_float_coords delta = { dx[j], dy[j] };
+			struct normalized_coords expected;
+
+			expected = filter_dispatch(scalar,
+						   &delta,
+						   &tool,
+						   time[j]);
+			ck_assert(memcmp(&expected.x, &x[j], sizeof(double)) == 0);
+			ck_assert(memcmp(&expected.y, &y[j], sizeof(double)) == 0);
+		}
+	}
+
+	filter_destroy(scalar);
+	filter_destroy(batch);
+}
+END_TEST
+
+void
+litest_setup_tests_filter(void)
+{
+	struct range filters = { 0, ARRAY_LENGTH(profile_filters) };
+	struct range batch_filters = { 0, BATCH_FILTER_COUNT };
+	struct range vfilters = { 0, ARRAY_LENGTH(velocity_filters) };
+
+	litest_add_ranged_no_device("filter:profile", filter_profile_table, &filters);
+	litest_add_no_device("filter:trackers", filter_tracker_count);
+	litest_add_no_device("filter:trackers", filter_tracker_rebase);
+	litest_add_ranged_no_device("filter:batch", filter_batch_dispatch, &batch_filters);
+	litest_add_no_device("filter:velocity", filter_velocity_dispatch);
+	litest_add_ranged_no_device("filter:velocity", filter_velocity_units, &vfilters);
+}
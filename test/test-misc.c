@@ -28,10 +28,12 @@
 #include <fcntl.h>
 #include <libinput.h>
 #include <libinput-util.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include "litest.h"
 #include "libinput-util.h"
+#include "timer-wheel.h"
 
 static int open_restricted(const char *path, int flags, void *data)
 {
@@ -536,6 +538,1185 @@ START_TEST(event_conversion_switch)
 }
 END_TEST
 
+START_TEST(event_pool_reuse)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t hits, misses;
+
+	litest_drain_events(li);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+	litest_drain_events(li);
+
+	hits = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENT_POOL_HITS);
+	misses = libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENT_POOL_MISSES);
+
+	/* Both events from the previous round were destroyed, so the
+	 * next two keyboard events must re-use their memory */
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_POOL_HITS),
+			 hits + 2);
+	ck_assert_int_eq(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_EVENT_POOL_MISSES),
+			 misses);
+}
+END_TEST
+
+START_TEST(timer_fd_updates)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t updates;
+
+	litest_enable_tap(dev->libinput_device);
+	litest_drain_events(li);
+
+	updates = libinput_get_statistic(li,
+					 LIBINPUT_STATISTIC_TIMERFD_UPDATES);
+
+	/* The timers used for a single finger motion change on touch
+	 * down and once the motion is detected, not on every frame */
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 70, 70, 20, 0);
+	litest_touch_up(dev, 0);
+	litest_drain_events(li);
+
+	ck_assert_int_lt(libinput_get_statistic(li,
+						LIBINPUT_STATISTIC_TIMERFD_UPDATES),
+			 updates + 10);
+}
+END_TEST
+
+/* Press the left button on each device a few ms apart and wait for the
+ * middle button emulation timeouts, driven by the timerfd */
+static void
+timer_wakeups_middlebutton(struct libinput *li,
+			   struct litest_device **devs,
+			   size_t ndevs,
+			   uint64_t *wakeups,
+			   uint64_t *expiries)
+{
+	struct pollfd fds;
+	uint64_t w, e;
+	size_t i;
+
+	w = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMER_WAKEUPS);
+	e = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMER_EXPIRIES);
+
+	/* the timeouts are 4ms apart, all within the slack of the first
+	 * one */
+	for (i = 0; i < ndevs; i++) {
+		litest_button_click(devs[i], BTN_LEFT, true);
+		libinput_dispatch(li);
+		msleep(4);
+	}
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	while (libinput_get_statistic(li,
+				      LIBINPUT_STATISTIC_TIMER_EXPIRIES) - e < ndevs) {
+		ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+		libinput_dispatch(li);
+	}
+
+	for (i = 0; i < ndevs; i++)
+		litest_button_click(devs[i], BTN_LEFT, false);
+	litest_drain_events(li);
+
+	*wakeups = libinput_get_statistic(li,
+				LIBINPUT_STATISTIC_TIMER_WAKEUPS) - w;
+	*expiries = libinput_get_statistic(li,
+				LIBINPUT_STATISTIC_TIMER_EXPIRIES) - e;
+}
+
+START_TEST(timer_wakeups)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *devs[3];
+	uint64_t wakeups, expiries;
+	size_t i;
+
+	devs[0] = dev;
+	devs[1] = litest_add_device(li, LITEST_MOUSE);
+	devs[2] = litest_add_device(li, LITEST_MOUSE);
+	for (i = 0; i < ARRAY_LENGTH(devs); i++)
+		libinput_device_config_middle_emulation_set_enabled(
+					devs[i]->libinput_device,
+					LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+	litest_drain_events(li);
+
+	ck_assert(libinput_get_timer_slack_enabled(li));
+	timer_wakeups_middlebutton(li, devs, ARRAY_LENGTH(devs),
+				   &wakeups, &expiries);
+	ck_assert_int_eq(expiries, ARRAY_LENGTH(devs));
+	ck_assert_int_lt(wakeups, expiries);
+
+	/* without slack, each timeout has its own wakeup */
+	libinput_set_timer_slack_enabled(li, false);
+	ck_assert(!libinput_get_timer_slack_enabled(li));
+	timer_wakeups_middlebutton(li, devs, ARRAY_LENGTH(devs),
+				   &wakeups, &expiries);
+	ck_assert_int_eq(expiries, ARRAY_LENGTH(devs));
+	ck_assert_int_eq(wakeups, expiries);
+
+	libinput_set_timer_slack_enabled(li, true);
+	litest_delete_device(devs[1]);
+	litest_delete_device(devs[2]);
+}
+END_TEST
+
+START_TEST(timer_touch_timeout_cancel)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t wakeups, expiries;
+
+	litest_disable_tap(dev->libinput_device);
+	litest_drain_events(li);
+
+	wakeups = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMER_WAKEUPS);
+	expiries = libinput_get_statistic(li, LIBINPUT_STATISTIC_TIMER_EXPIRIES);
+
+	/* A touch in the top button area sets the button timeout, lifting
+	 * it cancels it. The shared touch timer must not go off. */
+	litest_touch_down(dev, 0, 50, 5);
+	libinput_dispatch(li);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	litest_timeout_softbuttons();
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_TIMER_EXPIRIES),
+			 expiries);
+	ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_TIMER_WAKEUPS),
+			 wakeups);
+}
+END_TEST
+
+START_TEST(timer_mode_wheel)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_enable_tap(dev->libinput_device);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_timer_mode(li),
+			 LIBINPUT_TIMER_MODE_HEAP);
+	ck_assert_int_eq(libinput_set_timer_mode(li,
+						 LIBINPUT_TIMER_MODE_WHEEL),
+			 0);
+	ck_assert_int_eq(libinput_get_timer_mode(li),
+			 LIBINPUT_TIMER_MODE_WHEEL);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	/* the tap timer is pending */
+	ck_assert_int_eq(libinput_set_timer_mode(li,
+						 LIBINPUT_TIMER_MODE_HEAP),
+			 -1);
+
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_timeout_tap();
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_set_timer_mode(li,
+						 LIBINPUT_TIMER_MODE_HEAP),
+			 0);
+}
+END_TEST
+
+static inline void
+timer_wheel_set(struct libinput_timer_wheel *wheel,
+		struct libinput_timer *timer,
+		uint64_t expire)
+{
+	timer->expire = expire;
+	timer_wheel_insert(wheel, timer);
+}
+
+/* Advance the wheel to the tick before and then to the tick of the
+ * first expiry, exactly one timer must fire at that tick */
+static struct libinput_timer *
+timer_wheel_fire_next(struct libinput_timer_wheel *wheel)
+{
+	struct libinput_timer *timer;
+	struct list expired;
+	uint64_t tick;
+
+	tick = timer_wheel_first_tick(wheel);
+	ck_assert_int_ne(tick, 0);
+
+	list_init(&expired);
+	timer_wheel_collect(wheel, (tick - 1) * TIMER_WHEEL_TICK, &expired);
+	ck_assert(list_empty(&expired));
+
+	timer_wheel_collect(wheel, tick * TIMER_WHEEL_TICK, &expired);
+	ck_assert(!list_empty(&expired));
+	timer = list_first_entry(&expired, timer, link);
+	list_remove(&timer->link);
+	ck_assert(list_empty(&expired));
+
+	ck_assert_int_eq(timer->expire_index, TIMER_EXPIRED);
+	ck_assert_int_eq(timer->expire, tick * TIMER_WHEEL_TICK);
+
+	return timer;
+}
+
+START_TEST(timer_wheel_levels)
+{
+	struct libinput_timer_wheel *wheel;
+	struct libinput_timer timers[6];
+	const uint64_t start = ms2us(1000);
+	/* level 0, 1, 2, 3 and one too far out for the wheel, inserted
+	 * out of order */
+	const uint64_t expire[] = {
+		start + ms2us(5000),
+		start + ms2us(3),
+		start + ms2us(6 * 3600 * 1000),
+		start + ms2us(100),
+		start + ms2us(300 * 1000),
+		start + ms2us(130),
+	};
+	const unsigned int order[] = { 1, 3, 5, 0, 4, 2 };
+	unsigned int i;
+
+	wheel = timer_wheel_new(start);
+	ck_assert_notnull(wheel);
+
+	ck_assert_int_eq(timer_wheel_first_tick(wheel), 0);
+
+	for (i = 0; i < ARRAY_LENGTH(timers); i++)
+		timer_wheel_set(wheel, &timers[i], expire[i]);
+	ck_assert_int_eq(wheel->count, ARRAY_LENGTH(timers));
+
+	for (i = 0; i < ARRAY_LENGTH(order); i++) {
+		struct libinput_timer *t = timer_wheel_fire_next(wheel);
+
+		ck_assert_ptr_eq(t, &timers[order[i]]);
+	}
+
+	ck_assert_int_eq(wheel->count, 0);
+	ck_assert_int_eq(timer_wheel_first_tick(wheel), 0);
+
+	free(wheel);
+}
+END_TEST
+
+START_TEST(timer_wheel_cancel)
+{
+	struct libinput_timer_wheel *wheel;
+	struct libinput_timer timers[3];
+	const uint64_t start = ms2us(1000);
+	const uint64_t tick = start/TIMER_WHEEL_TICK;
+	/* the delays of each row are in the same slot */
+	const uint64_t delays[][3] = {
+		{ ms2us(100), ms2us(101), ms2us(110) },
+		{ ms2us(5000), ms2us(5001), ms2us(5010) },
+	};
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(delays); i++) {
+		const uint64_t *d = delays[i];
+
+		wheel = timer_wheel_new(start);
+		ck_assert_notnull(wheel);
+
+		timer_wheel_set(wheel, &timers[1], start + d[1]);
+		timer_wheel_set(wheel, &timers[0], start + d[0]);
+		timer_wheel_set(wheel, &timers[2], start + d[2]);
+		ck_assert_int_eq(timer_wheel_first_tick(wheel),
+				 tick + d[0]/TIMER_WHEEL_TICK);
+
+		/* not the earliest, no change */
+		timer_wheel_remove(wheel, &timers[2]);
+		ck_assert_int_eq(timer_wheel_first_tick(wheel),
+				 tick + d[0]/TIMER_WHEEL_TICK);
+
+		/* the earliest, the slot's next timer takes over */
+		timer_wheel_remove(wheel, &timers[0]);
+		ck_assert_int_eq(timer_wheel_first_tick(wheel),
+				 tick + d[1]/TIMER_WHEEL_TICK);
+
+		/* moved later within the slot */
+		timer_wheel_remove(wheel, &timers[1]);
+		timer_wheel_set(wheel, &timers[1], start + d[2]);
+		ck_assert_int_eq(timer_wheel_first_tick(wheel),
+				 tick + d[2]/TIMER_WHEEL_TICK);
+
+		timer_wheel_remove(wheel, &timers[1]);
+		ck_assert_int_eq(timer_wheel_first_tick(wheel), 0);
+		ck_assert_int_eq(wheel->count, 0);
+
+		free(wheel);
+	}
+}
+END_TEST
+
+START_TEST(timer_wheel_idle)
+{
+	struct libinput_timer_wheel *wheel;
+	struct libinput_timer timers[3];
+	const uint64_t start = ms2us(1000);
+	/* nothing advanced the wheel since start, the timers are
+	 * inserted relative to a stale tick */
+	const uint64_t idle[] = {
+		ms2us(10 * 1000),
+		ms2us(6 * 3600 * 1000),
+	};
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(idle); i++) {
+		uint64_t now = start + idle[i];
+
+		wheel = timer_wheel_new(start);
+		ck_assert_notnull(wheel);
+
+		timer_wheel_set(wheel, &timers[0], now + ms2us(180));
+		timer_wheel_set(wheel, &timers[1], now + ms2us(3));
+		timer_wheel_set(wheel, &timers[2], now + ms2us(1000));
+
+		ck_assert_ptr_eq(timer_wheel_fire_next(wheel), &timers[1]);
+		ck_assert_ptr_eq(timer_wheel_fire_next(wheel), &timers[0]);
+		ck_assert_ptr_eq(timer_wheel_fire_next(wheel), &timers[2]);
+		ck_assert_int_eq(timer_wheel_first_tick(wheel), 0);
+
+		free(wheel);
+	}
+}
+END_TEST
+
+static inline void
+queue_key_presses(struct litest_device *dev, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		litest_keyboard_key(dev, KEY_A, true);
+		litest_keyboard_key(dev, KEY_A, false);
+	}
+	libinput_dispatch(dev->libinput);
+}
+
+static inline enum libinput_key_state
+nth_key_state(unsigned int n)
+{
+	return (n % 2) ? LIBINPUT_KEY_STATE_RELEASED :
+			 LIBINPUT_KEY_STATE_PRESSED;
+}
+
+START_TEST(event_queue_get_events)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[7];
+	struct libinput_event *event;
+	unsigned int i, n;
+	unsigned int total = 0;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_events(li, events, ARRAY_LENGTH(events)),
+			 0);
+
+	/* Consume part of the queue one by one so the second batch of
+	 * events wraps around the end of the ring buffer */
+	queue_key_presses(dev, 10);
+	for (i = 0; i < 15; i++) {
+		event = libinput_get_event(li);
+		litest_is_keyboard_event(event, KEY_A, nth_key_state(total++));
+		libinput_event_destroy(event);
+	}
+
+	queue_key_presses(dev, 10);
+
+	ck_assert_int_eq(libinput_get_events(li, events, 0), 0);
+
+	while ((n = libinput_get_events(li, events, ARRAY_LENGTH(events)))) {
+		ck_assert_int_le(n, ARRAY_LENGTH(events));
+
+		for (i = 0; i < n; i++)
+			litest_is_keyboard_event(events[i],
+						 KEY_A,
+						 nth_key_state(total++));
+
+		libinput_events_destroy(events, n);
+	}
+
+	ck_assert_int_eq(total, 40);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_queue_inline)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *first, *event;
+	struct libinput_event *events[16];
+	unsigned int i, n;
+	unsigned int total = 0;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_event_queue_mode(li),
+			 LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED);
+	ck_assert_int_eq(libinput_set_event_queue_mode(li,
+					LIBINPUT_EVENT_QUEUE_MODE_INLINE),
+			 0);
+	ck_assert_int_eq(libinput_get_event_queue_mode(li),
+			 LIBINPUT_EVENT_QUEUE_MODE_INLINE);
+
+	/* enough events to need more than one chunk of slots */
+	queue_key_presses(dev, 100);
+
+	/* mode can't change while events are queued */
+	ck_assert_int_eq(libinput_set_event_queue_mode(li,
+					LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED),
+			 -1);
+
+	/* hold on to the first event while the others are processed */
+	first = libinput_get_event(li);
+	litest_is_keyboard_event(first, KEY_A, nth_key_state(total++));
+
+	ck_assert_int_eq(libinput_next_event_type(li),
+			 LIBINPUT_EVENT_KEYBOARD_KEY);
+
+	while ((n = libinput_get_events(li, events, ARRAY_LENGTH(events)))) {
+		for (i = 0; i < n; i++)
+			litest_is_keyboard_event(events[i],
+						 KEY_A,
+						 nth_key_state(total++));
+		libinput_events_destroy(events, n);
+
+		queue_key_presses(dev, 1);
+		if (total > 400)
+			break;
+	}
+
+	while ((event = libinput_get_event(li))) {
+		litest_is_keyboard_event(event, KEY_A, nth_key_state(total++));
+		libinput_event_destroy(event);
+	}
+
+	/* first event is still intact */
+	litest_is_keyboard_event(first,
+				 KEY_A,
+				 LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(first);
+
+	ck_assert_int_ge(total, 400);
+
+	ck_assert_int_eq(libinput_set_event_queue_mode(li,
+					LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED),
+			 0);
+	queue_key_presses(dev, 1);
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(event_queue_coalesce_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event, *held;
+	struct libinput_event_pointer *ptrev;
+	uint64_t merged;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_event_coalescing(li),
+			 LIBINPUT_EVENT_COALESCE_NONE);
+	libinput_set_event_coalescing(li,
+				      LIBINPUT_EVENT_COALESCE_POINTER_MOTION);
+	ck_assert_int_eq(libinput_get_event_coalescing(li),
+			 LIBINPUT_EVENT_COALESCE_POINTER_MOTION);
+
+	merged = libinput_get_statistic(li,
+			LIBINPUT_STATISTIC_COALESCED_POINTER_MOTION);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_REL, REL_Y, -2);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+			    5.0);
+	ck_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+			    -10.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+			LIBINPUT_STATISTIC_COALESCED_POINTER_MOTION),
+			 merged + 4);
+
+	/* a retrieved event is never merged into */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	held = libinput_get_event(li);
+	ptrev = litest_is_motion_event(held);
+	litest_assert_empty_queue(li);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 2);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+			    1.0);
+	ck_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+			    0.0);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+			    6.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+	libinput_event_destroy(held);
+
+	libinput_set_event_coalescing(li, LIBINPUT_EVENT_COALESCE_NONE);
+	for (i = 0; i < 2; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	for (i = 0; i < 2; i++) {
+		event = libinput_get_event(li);
+		ptrev = litest_is_motion_event(event);
+		ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+				    1.0);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_queue_limit)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t dropped;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_event_queue_limit(li), 0);
+	ck_assert_int_eq(libinput_get_event_overflow_policy(li),
+			 LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST);
+
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					5,
+					LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST),
+			 0);
+	ck_assert_int_eq(libinput_get_event_queue_limit(li), 5);
+
+	dropped = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENTS_DROPPED);
+
+	/* 20 key events, queued beyond the limit because key events are
+	 * never dropped */
+	queue_key_presses(dev, 10);
+
+	for (i = 0; i < 20; i++) {
+		event = libinput_get_event(li);
+		litest_is_keyboard_event(event, KEY_A, nth_key_state(i));
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_DROPPED),
+			 dropped);
+	ck_assert_int_ge(libinput_get_statistic(li,
+				LIBINPUT_STATISTIC_EVENT_QUEUE_HIGH_WATER),
+			 20);
+
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					0,
+					LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST),
+			 0);
+}
+END_TEST
+
+static inline void
+queue_motion(struct litest_device *dev, int dx)
+{
+	litest_event(dev, EV_REL, REL_X, dx);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+static inline void
+queue_button(struct litest_device *dev, bool is_press)
+{
+	litest_event(dev, EV_KEY, BTN_LEFT, is_press ? 1 : 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+static inline void
+assert_motion_dx(struct libinput *li, double dx)
+{
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+			    dx);
+	libinput_event_destroy(event);
+}
+
+static inline void
+assert_button(struct libinput *li, bool is_press)
+{
+	struct libinput_event *event;
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       is_press ? LIBINPUT_BUTTON_STATE_PRESSED :
+					  LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+}
+
+START_TEST(event_queue_limit_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t dropped;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					3,
+					LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST),
+			 0);
+	dropped = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENTS_DROPPED);
+
+	/* motion beyond the limit is dropped, the buttons are not */
+	queue_button(dev, true);
+	for (i = 1; i <= 5; i++)
+		queue_motion(dev, i);
+	queue_button(dev, false);
+	libinput_dispatch(li);
+
+	assert_button(li, true);
+	assert_motion_dx(li, 1);
+	assert_motion_dx(li, 2);
+	assert_button(li, false);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_DROPPED),
+			 dropped + 3);
+
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					0,
+					LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST),
+			 0);
+}
+END_TEST
+
+START_TEST(event_queue_limit_drop_oldest_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_event_queue_mode modes[] = {
+		LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED,
+		LIBINPUT_EVENT_QUEUE_MODE_INLINE,
+	};
+	uint64_t dropped;
+	unsigned int m;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					5,
+					LIBINPUT_EVENT_OVERFLOW_DROP_OLDEST_MOTION),
+			 0);
+
+	for (m = 0; m < ARRAY_LENGTH(modes); m++) {
+		ck_assert_int_eq(libinput_set_event_queue_mode(li, modes[m]),
+				 0);
+		dropped = libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_DROPPED);
+
+		/* M1 B M2 M3 M4 fill the queue, M5 and M6 drop M1 and M2.
+		 * The release is queued too and drops M3. */
+		queue_motion(dev, 1);
+		queue_button(dev, true);
+		for (i = 2; i <= 6; i++)
+			queue_motion(dev, i);
+		queue_button(dev, false);
+		libinput_dispatch(li);
+
+		assert_button(li, true);
+		assert_motion_dx(li, 4);
+		assert_motion_dx(li, 5);
+		assert_motion_dx(li, 6);
+		assert_button(li, false);
+		litest_assert_empty_queue(li);
+
+		ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_DROPPED),
+				 dropped + 3);
+
+		/* with no motion left to drop, the buttons are queued
+		 * beyond the limit and new motion is dropped */
+		for (i = 0; i < 3; i++) {
+			queue_button(dev, true);
+			queue_button(dev, false);
+		}
+		queue_motion(dev, 1);
+		libinput_dispatch(li);
+
+		for (i = 0; i < 3; i++) {
+			assert_button(li, true);
+			assert_button(li, false);
+		}
+		litest_assert_empty_queue(li);
+
+		ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_DROPPED),
+				 dropped + 4);
+	}
+
+	ck_assert_int_eq(libinput_set_event_queue_mode(li,
+					LIBINPUT_EVENT_QUEUE_MODE_ALLOCATED),
+			 0);
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					0,
+					LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST),
+			 0);
+}
+END_TEST
+
+START_TEST(event_queue_limit_coalesce)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t dropped;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_event_coalescing(li),
+			 LIBINPUT_EVENT_COALESCE_NONE);
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					3,
+					LIBINPUT_EVENT_OVERFLOW_COALESCE),
+			 0);
+	dropped = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENTS_DROPPED);
+
+	/* Once full, motion is merged into the last queued motion event.
+	 * After the release, the motion can't be merged and is dropped. */
+	queue_motion(dev, 1);
+	queue_button(dev, true);
+	queue_motion(dev, 2);
+	queue_motion(dev, 3);
+	queue_motion(dev, 4);
+	queue_button(dev, false);
+	queue_motion(dev, 5);
+	libinput_dispatch(li);
+
+	assert_motion_dx(li, 1);
+	assert_button(li, true);
+	assert_motion_dx(li, 9);
+	assert_button(li, false);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_DROPPED),
+			 dropped + 1);
+
+	ck_assert_int_eq(libinput_set_event_queue_limit(li,
+					0,
+					LIBINPUT_EVENT_OVERFLOW_DROP_NEWEST),
+			 0);
+}
+END_TEST
+
+static inline unsigned int
+drain_motion_events(struct libinput *li)
+{
+	struct libinput_event *event;
+	unsigned int count = 0;
+
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	return count;
+}
+
+START_TEST(dispatch_with_budget)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	unsigned int total = 0;
+	int i, rc;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	rc = libinput_dispatch_with_budget(li, 3, 0);
+	ck_assert_int_gt(rc, 0);
+	ck_assert_int_eq(drain_motion_events(li), 3);
+	total += 3;
+
+	/* a deadline in the past still processes one frame */
+	rc = libinput_dispatch_with_budget(li, 0, 1);
+	ck_assert_int_gt(rc, 0);
+	ck_assert_int_eq(drain_motion_events(li), 1);
+	total += 1;
+
+	do {
+		rc = libinput_dispatch_with_budget(li, 4, 0);
+		ck_assert_int_ge(rc, 0);
+		total += drain_motion_events(li);
+	} while (rc > 0);
+
+	ck_assert_int_eq(total, 10);
+
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(dispatch_round_robin)
+{
+	struct litest_device *dev = litest_current_device();
+	struct litest_device *keyboard;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int i, idx = 0, key_idx = -1;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_dispatch_mode(li),
+			 LIBINPUT_DISPATCH_MODE_DRAIN);
+	ck_assert_int_eq(libinput_set_dispatch_mode(li,
+					LIBINPUT_DISPATCH_MODE_ROUND_ROBIN),
+			 0);
+	ck_assert_int_eq(libinput_get_dispatch_mode(li),
+			 LIBINPUT_DISPATCH_MODE_ROUND_ROBIN);
+
+	for (i = 0; i < 20; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_keyboard_key(keyboard, KEY_A, true);
+
+	libinput_dispatch(li);
+
+	/* the key press doesn't wait for the mouse to be drained */
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_KEYBOARD_KEY) {
+			ck_assert_int_eq(key_idx, -1);
+			key_idx = idx;
+		} else {
+			litest_is_motion_event(event);
+		}
+		libinput_event_destroy(event);
+		idx++;
+	}
+
+	ck_assert_int_eq(idx, 21);
+	ck_assert_int_ge(key_idx, 0);
+	ck_assert_int_le(key_idx, 1);
+
+	litest_keyboard_key(keyboard, KEY_A, false);
+	litest_delete_device(keyboard);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(input_thread)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct pollfd fds;
+	int epoll_fd, fd;
+	unsigned int count = 0;
+
+	litest_drain_events(li);
+
+	epoll_fd = libinput_get_fd(li);
+	ck_assert_int_eq(libinput_start_input_thread(li, 0), 0);
+	fd = libinput_get_fd(li);
+	ck_assert_int_ne(fd, epoll_fd);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+
+	fds.fd = fd;
+	fds.events = POLLIN;
+	while (count < 2) {
+		ck_assert_int_eq(poll(&fds, 1, 2000), 1);
+		ck_assert_int_eq(libinput_dispatch(li), 0);
+
+		while ((event = libinput_get_event(li))) {
+			litest_is_keyboard_event(event,
+						 KEY_A,
+						 nth_key_state(count++));
+			libinput_event_destroy(event);
+		}
+	}
+
+	/* config calls are serialized with the thread */
+	ck_assert_int_eq(libinput_device_config_send_events_set_mode(
+					dev->libinput_device,
+					LIBINPUT_CONFIG_SEND_EVENTS_ENABLED),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	libinput_stop_input_thread(li);
+	ck_assert_int_eq(libinput_get_fd(li), epoll_fd);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+	libinput_dispatch(li);
+	for (count = 0; count < 2; count++) {
+		event = libinput_get_event(li);
+		litest_is_keyboard_event(event, KEY_A, nth_key_state(count));
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+static void
+input_thread_wait_for_event(struct libinput *li,
+			    enum libinput_event_type type)
+{
+	struct libinput_event *event;
+	struct pollfd fds;
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+
+	/* nothing else wakes up the input thread */
+	ck_assert_int_eq(poll(&fds, 1, 2000), 1);
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	ck_assert_int_eq(libinput_event_get_type(event), type);
+	libinput_event_destroy(event);
+}
+
+START_TEST(input_thread_path_add_device)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_start_input_thread(li, 0), 0);
+
+	/* Events posted from the caller's thread reach the caller without
+	 * any device input */
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(dev->uinput));
+	ck_assert_notnull(device);
+	libinput_device_ref(device);
+	input_thread_wait_for_event(li, LIBINPUT_EVENT_DEVICE_ADDED);
+
+	libinput_path_remove_device(device);
+	libinput_device_unref(device);
+	input_thread_wait_for_event(li, LIBINPUT_EVENT_DEVICE_REMOVED);
+
+	libinput_stop_input_thread(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(input_thread_handoff_full)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct pollfd fds;
+	/* more than the input thread can hand over at once */
+	const unsigned int nevents = 1500;
+	unsigned int count = 0;
+	unsigned int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_start_input_thread(li, 0), 0);
+
+	for (i = 0; i < nevents/2; i++) {
+		litest_keyboard_key(dev, KEY_A, true);
+		litest_keyboard_key(dev, KEY_A, false);
+		/* don't overrun the kernel buffer */
+		if (i % 16 == 15)
+			msleep(2);
+	}
+
+	/* let the thread fill the handoff before we take anything */
+	msleep(200);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	while (count < nevents) {
+		ck_assert_int_eq(poll(&fds, 1, 2000), 1);
+		ck_assert_int_eq(libinput_dispatch(li), 0);
+
+		while ((event = libinput_get_event(li))) {
+			litest_is_keyboard_event(event,
+						 KEY_A,
+						 nth_key_state(count++));
+			libinput_event_destroy(event);
+		}
+	}
+
+	libinput_stop_input_thread(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_type_mask)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t masked;
+
+	litest_drain_events(li);
+
+	ck_assert(libinput_get_event_type_enabled(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY));
+	ck_assert_int_eq(libinput_set_event_type_enabled(li,
+					LIBINPUT_EVENT_DEVICE_ADDED,
+					0),
+			 -1);
+	ck_assert(libinput_get_event_type_enabled(li,
+					LIBINPUT_EVENT_DEVICE_ADDED));
+
+	ck_assert_int_eq(libinput_set_event_type_enabled(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					0),
+			 0);
+	ck_assert(!libinput_get_event_type_enabled(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY));
+
+	masked = libinput_get_statistic(li, LIBINPUT_STATISTIC_EVENTS_MASKED);
+	queue_key_presses(dev, 5);
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_get_statistic(li,
+					LIBINPUT_STATISTIC_EVENTS_MASKED),
+			 masked + 10);
+
+	ck_assert_int_eq(libinput_set_event_type_enabled(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					1),
+			 0);
+	queue_key_presses(dev, 1);
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(latency_tracking)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_latency_stage stage;
+	uint64_t p50, p99, max;
+
+	litest_drain_events(li);
+
+	ck_assert(!libinput_get_latency_tracking(li));
+	queue_key_presses(dev, 2);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_latency_count(device,
+					LIBINPUT_EVENT_KEYBOARD_KEY),
+			 0);
+
+	libinput_set_latency_tracking(li, 1);
+	ck_assert(libinput_get_latency_tracking(li));
+
+	queue_key_presses(dev, 5);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_latency_count(device,
+					LIBINPUT_EVENT_KEYBOARD_KEY),
+			 10);
+	ck_assert_int_eq(libinput_device_get_latency_count(device,
+					LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+
+	for (stage = LIBINPUT_LATENCY_STAGE_PROCESSING;
+	     stage <= LIBINPUT_LATENCY_STAGE_TOTAL;
+	     stage++) {
+		p50 = libinput_device_get_latency_percentile(device,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					stage,
+					50);
+		p99 = libinput_device_get_latency_percentile(device,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					stage,
+					99);
+		max = libinput_device_get_latency_percentile(device,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					stage,
+					100);
+		ck_assert_int_le(p50, p99);
+		ck_assert_int_le(p99, max);
+	}
+
+	/* disabling keeps the data */
+	libinput_set_latency_tracking(li, 0);
+	queue_key_presses(dev, 1);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_device_get_latency_count(device,
+					LIBINPUT_EVENT_KEYBOARD_KEY),
+			 10);
+}
+END_TEST
+
 START_TEST(bitfield_helpers)
 {
 	/* This value has a bit set on all of the word boundaries we want to
@@ -1293,6 +2474,28 @@ litest_setup_tests_misc(void)
 	litest_add_for_device("events:conversion", event_conversion_tablet, LITEST_WACOM_CINTIQ);
 	litest_add_for_device("events:conversion", event_conversion_tablet_pad, LITEST_WACOM_INTUOS5_PAD);
 	litest_add_for_device("events:conversion", event_conversion_switch, LITEST_LID_SWITCH);
+	litest_add_for_device("events:pool", event_pool_reuse, LITEST_KEYBOARD);
+	litest_add_for_device("timer:fd", timer_fd_updates, LITEST_SYNAPTICS_TOPBUTTONPAD);
+	litest_add_for_device("timer:fd", timer_wakeups, LITEST_MOUSE);
+	litest_add_for_device("timer:fd", timer_touch_timeout_cancel, LITEST_SYNAPTICS_TOPBUTTONPAD);
+	litest_add_for_device("timer:mode", timer_mode_wheel, LITEST_SYNAPTICS_TOPBUTTONPAD);
+	litest_add_no_device("timer:wheel", timer_wheel_levels);
+	litest_add_no_device("timer:wheel", timer_wheel_cancel);
+	litest_add_no_device("timer:wheel", timer_wheel_idle);
+	litest_add_for_device("events:queue", event_queue_get_events, LITEST_KEYBOARD);
+	litest_add_for_device("events:queue", event_queue_inline, LITEST_KEYBOARD);
+	litest_add_for_device("events:queue", event_queue_coalesce_motion, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_limit, LITEST_KEYBOARD);
+	litest_add_for_device("events:queue", event_queue_limit_motion, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_limit_drop_oldest_motion, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_limit_coalesce, LITEST_MOUSE);
+	litest_add_for_device("events:dispatch", dispatch_with_budget, LITEST_MOUSE);
+	litest_add_for_device("events:dispatch", dispatch_round_robin, LITEST_MOUSE);
+	litest_add_for_device("events:thread", input_thread, LITEST_KEYBOARD);
+	litest_add_for_device("events:thread", input_thread_handoff_full, LITEST_KEYBOARD);
+	litest_add_for_device("events:thread", input_thread_path_add_device, LITEST_KEYBOARD);
+	litest_add_for_device("events:mask", event_type_mask, LITEST_KEYBOARD);
+	litest_add_for_device("events:latency", latency_tracking, LITEST_KEYBOARD);
 	litest_add_no_device("misc:bitfield_helpers", bitfield_helpers);
 
 	litest_add_no_device("context:refcount", context_ref_counting);
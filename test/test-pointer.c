@@ -343,6 +343,150 @@ START_TEST(pointer_motion_unaccel)
 }
 END_TEST
 
+START_TEST(pointer_motion_prediction_disabled)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t time;
+	int i;
+
+	ck_assert_int_eq(libinput_get_motion_prediction(li), 0);
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 5);
+		litest_event(dev, EV_REL, REL_Y, 5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		msleep(5);
+	}
+
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		ptrev = litest_is_motion_event(event);
+		time = libinput_event_pointer_get_time_usec(ptrev);
+
+		litest_assert_double_eq(
+			libinput_event_pointer_get_predicted_dx(ptrev,
+								time + ms2us(16)),
+			0.0);
+		litest_assert_double_eq(
+			libinput_event_pointer_get_predicted_dy(ptrev,
+								time + ms2us(16)),
+			0.0);
+
+		libinput_event_destroy(event);
+	}
+}
+END_TEST
+
+START_TEST(pointer_motion_prediction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t time;
+	int i;
+
+	libinput_set_motion_prediction(li, ms2us(20));
+	ck_assert_int_eq(libinput_get_motion_prediction(li), ms2us(20));
+
+	litest_drain_events(li);
+
+	/* steady motion so the filter has a velocity */
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 5);
+		litest_event(dev, EV_REL, REL_Y, 0);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		msleep(5);
+	}
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	litest_event(dev, EV_REL, REL_X, 5);
+	litest_event(dev, EV_REL, REL_Y, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	time = libinput_event_pointer_get_time_usec(ptrev);
+
+	/* Nothing to extrapolate at or before the event time */
+	litest_assert_double_eq(
+		libinput_event_pointer_get_predicted_dx(ptrev, time),
+		0.0);
+	litest_assert_double_eq(
+		libinput_event_pointer_get_predicted_dx(ptrev, time - 1000),
+		0.0);
+
+	/* The motion continues in the same direction */
+	litest_assert_double_gt(
+		libinput_event_pointer_get_predicted_dx(ptrev,
+							time + ms2us(10)),
+		0.0);
+	litest_assert_double_eq(
+		libinput_event_pointer_get_predicted_dy(ptrev,
+							time + ms2us(10)),
+		0.0);
+
+	/* Past the maximum horizon the prediction doesn't change */
+	litest_assert_double_eq(
+		libinput_event_pointer_get_predicted_dx(ptrev,
+							time + ms2us(100)),
+		libinput_event_pointer_get_predicted_dx(ptrev,
+							time + ms2us(20)));
+
+	libinput_event_destroy(event);
+}
+END_TEST
+
+START_TEST(pointer_motion_prediction_no_drift)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double offset, max_dx = 0.0;
+	uint64_t time;
+	int i;
+
+	libinput_set_motion_prediction(li, ms2us(20));
+	litest_drain_events(li);
+
+	/* The pointer is drawn at its position plus the offset of the
+	 * last event. However long the motion, that offset stays within
+	 * the motion of one horizon instead of adding up. */
+	for (i = 0; i < 50; i++) {
+		litest_event(dev, EV_REL, REL_X, 5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+
+		event = libinput_get_event(li);
+		ptrev = litest_is_motion_event(event);
+		time = libinput_event_pointer_get_time_usec(ptrev);
+
+		max_dx = max(max_dx, libinput_event_pointer_get_dx(ptrev));
+		offset = libinput_event_pointer_get_predicted_dx(ptrev,
+								 time + ms2us(20));
+		libinput_event_destroy(event);
+
+		/* 20ms are four events 5ms apart, allow for scheduling
+		 * jitter in the velocity */
+		litest_assert_double_ge(offset, 0.0);
+		litest_assert_double_le(offset, 8 * max_dx);
+
+		msleep(5);
+	}
+
+	libinput_set_motion_prediction(li, 0);
+}
+END_TEST
+
 static void
 test_button_event(struct litest_device *dev, unsigned int button, int state)
 {
@@ -2084,6 +2228,9 @@ litest_setup_tests_pointer(void)
 	litest_add_ranged("pointer:motion", pointer_motion_relative_min_decel, LITEST_RELATIVE, LITEST_ANY, &compass);
 	litest_add("pointer:motion", pointer_motion_absolute, LITEST_ABSOLUTE, LITEST_ANY);
 	litest_add("pointer:motion", pointer_motion_unaccel, LITEST_RELATIVE, LITEST_ANY);
+	litest_add("pointer:motion", pointer_motion_prediction_disabled, LITEST_RELATIVE, LITEST_ANY);
+	litest_add_for_device("pointer:motion", pointer_motion_prediction, LITEST_MOUSE);
+	litest_add_for_device("pointer:motion", pointer_motion_prediction_no_drift, LITEST_MOUSE);
 	litest_add("pointer:button", pointer_button, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add_no_device("pointer:button", pointer_button_auto_release);
 	litest_add_no_device("pointer:button", pointer_seat_button_count);
@@ -776,6 +776,245 @@ START_TEST(touch_protocol_a_2fg_touch)
 }
 END_TEST
 
+START_TEST(touch_protocol_a_2fg_reordered)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	struct libinput_event_touch *tev;
+	int x;
+
+	litest_drain_events(li);
+
+	litest_push_event_frame(dev);
+	litest_touch_down(dev, 0, 10, 10);
+	litest_touch_down(dev, 0, 90, 90);
+	litest_pop_event_frame(dev);
+	litest_drain_events(li);
+
+	/* The device sends the contacts in the reverse order, the
+	 * slots must follow the touch positions */
+	for (x = 500; x < 2500; x += 500) {
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_X, 29000 + x);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, 29000);
+		litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_X, 3000 + x);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, 3000);
+		litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+
+		ev = libinput_get_event(li);
+		tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_MOTION);
+		ck_assert_int_eq(libinput_event_touch_get_slot(tev), 0);
+		libinput_event_destroy(ev);
+
+		ev = libinput_get_event(li);
+		tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_MOTION);
+		ck_assert_int_eq(libinput_event_touch_get_slot(tev), 1);
+		libinput_event_destroy(ev);
+
+		ev = libinput_get_event(li);
+		litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_FRAME);
+		libinput_event_destroy(ev);
+	}
+
+	/* one contact left, the other one ended */
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, 29000);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, 29000);
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_UP);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 0);
+	libinput_event_destroy(ev);
+
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(touch_protocol_a_lift_and_new_touch)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	struct libinput_event_touch *tev;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 10, 10);
+	litest_drain_events(li);
+
+	/* The first finger is lifted and a second one put down far
+	 * away within the same frame, that's two touches, not a jump */
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, 29000);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, 29000);
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_UP);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 0);
+	libinput_event_destroy(ev);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_DOWN);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 1);
+	libinput_event_destroy(ev);
+
+	ev = libinput_get_event(li);
+	litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(ev);
+
+	/* a small move is still the same touch */
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, 29500);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, 29500);
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_MOTION);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), 1);
+	libinput_event_destroy(ev);
+
+	ev = libinput_get_event(li);
+	litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(ev);
+
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+}
+END_TEST
+
+static inline void
+protocol_a_contact(struct litest_device *dev, int x, int y)
+{
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, x);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, y);
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+}
+
+static inline void
+assert_touch_slot(struct libinput *li,
+		  enum libinput_event_type type,
+		  int slot)
+{
+	struct libinput_event *ev;
+	struct libinput_event_touch *tev;
+
+	ev = libinput_get_event(li);
+	tev = litest_is_touch_event(ev, type);
+	ck_assert_int_eq(libinput_event_touch_get_slot(tev), slot);
+	libinput_event_destroy(ev);
+}
+
+static inline void
+assert_touch_frame(struct libinput *li)
+{
+	struct libinput_event *ev;
+
+	ev = libinput_get_event(li);
+	litest_is_touch_event(ev, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(ev);
+}
+
+START_TEST(touch_protocol_a_lift_and_reappear)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_drain_events(li);
+
+	protocol_a_contact(dev, 3000, 3000);
+	protocol_a_contact(dev, 29000, 29000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_DOWN, 1);
+	assert_touch_frame(li);
+
+	/* the first contact is missing from a frame, its touch ends */
+	protocol_a_contact(dev, 29000, 29000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert_touch_frame(li);
+	litest_assert_empty_queue(li);
+
+	/* back at the same position it's a new touch, the other one
+	 * stays where it is */
+	protocol_a_contact(dev, 29000, 29000);
+	protocol_a_contact(dev, 3000, 3000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert_touch_frame(li);
+	litest_assert_empty_queue(li);
+
+	/* both lift */
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_UP, 1);
+	assert_touch_frame(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(touch_protocol_a_too_many_contacts)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	const int ncontacts = 12; /* more than the slots available */
+	int i;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < ncontacts; i++)
+		protocol_a_contact(dev, 1000 + i * 2500, 16000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	/* only the first ten contacts become touches */
+	for (i = 0; i < 10; i++)
+		assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_DOWN, i);
+	assert_touch_frame(li);
+	litest_assert_empty_queue(li);
+
+	/* once the first contact lifts, the eleventh takes its slot */
+	for (i = 1; i < ncontacts; i++)
+		protocol_a_contact(dev, 1000 + i * 2500, 16000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert_touch_frame(li);
+	litest_assert_empty_queue(li);
+
+	litest_event(dev, EV_SYN, SYN_MT_REPORT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	for (i = 0; i < 10; i++)
+		assert_touch_slot(li, LIBINPUT_EVENT_TOUCH_UP, i);
+	assert_touch_frame(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(touch_initial_state)
 {
 	struct litest_device *dev;
@@ -938,6 +1177,10 @@ litest_setup_tests_touch(void)
 	litest_add("touch:protocol a", touch_protocol_a_init, LITEST_PROTOCOL_A, LITEST_ANY);
 	litest_add("touch:protocol a", touch_protocol_a_touch, LITEST_PROTOCOL_A, LITEST_ANY);
 	litest_add("touch:protocol a", touch_protocol_a_2fg_touch, LITEST_PROTOCOL_A, LITEST_ANY);
+	litest_add("touch:protocol a", touch_protocol_a_2fg_reordered, LITEST_PROTOCOL_A, LITEST_ANY);
+	litest_add("touch:protocol a", touch_protocol_a_lift_and_new_touch, LITEST_PROTOCOL_A, LITEST_ANY);
+	litest_add("touch:protocol a", touch_protocol_a_lift_and_reappear, LITEST_PROTOCOL_A, LITEST_ANY);
+	litest_add("touch:protocol a", touch_protocol_a_too_many_contacts, LITEST_PROTOCOL_A, LITEST_ANY);
 
 	litest_add_ranged("touch:state", touch_initial_state, LITEST_TOUCH, LITEST_PROTOCOL_A, &axes);
 
@@ -65,6 +65,50 @@ START_TEST(touchpad_1fg_motion)
 }
 END_TEST
 
+START_TEST(touchpad_1fg_motion_prediction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double dx = 0.0, offset = 0.0;
+
+	litest_disable_tap(dev->libinput_device);
+	libinput_set_motion_prediction(li, ms2us(16));
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 30, 50);
+	litest_touch_move_to(dev, 0, 30, 50, 80, 50, 20, 5);
+	litest_touch_up(dev, 0);
+
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+
+	while (event) {
+		uint64_t time;
+
+		ptrev = litest_is_motion_event(event);
+		time = libinput_event_pointer_get_time_usec(ptrev);
+
+		dx += libinput_event_pointer_get_dx(ptrev);
+		offset = libinput_event_pointer_get_predicted_dx(ptrev,
+								 time + ms2us(8));
+
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+	}
+
+	/* A finger moving right is predicted to keep moving right. The
+	 * offset only covers the motion after the last event, a small
+	 * part of the whole motion. */
+	litest_assert_double_gt(offset, 0.0);
+	litest_assert_double_lt(offset, dx/2);
+}
+END_TEST
+
 START_TEST(touchpad_2fg_no_motion)
 {
 	struct litest_device *dev = litest_current_device();
@@ -5027,6 +5071,7 @@ litest_setup_tests_touchpad(void)
 	struct range axis_range = {ABS_X, ABS_Y + 1};
 
 	litest_add("touchpad:motion", touchpad_1fg_motion, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:motion", touchpad_1fg_motion_prediction, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("touchpad:motion", touchpad_2fg_no_motion, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add("touchpad:scroll", touchpad_2fg_scroll, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
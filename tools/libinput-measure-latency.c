@@ -0,0 +1,289 @@
+/*
+ * Copyright © 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+
+#include <libinput-util.h>
+
+#include "shared.h"
+
+#define error(...) fprintf(stderr, __VA_ARGS__)
+
+struct device_list {
+	struct libinput_device **devices;
+	size_t ndevices;
+	size_t size;
+};
+
+static const struct {
+	enum libinput_event_type type;
+	const char *name;
+} event_types[] = {
+	{ LIBINPUT_EVENT_KEYBOARD_KEY, "KEYBOARD_KEY" },
+	{ LIBINPUT_EVENT_POINTER_MOTION, "POINTER_MOTION" },
+	{ LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, "POINTER_MOTION_ABSOLUTE" },
+	{ LIBINPUT_EVENT_POINTER_BUTTON, "POINTER_BUTTON" },
+	{ LIBINPUT_EVENT_POINTER_AXIS, "POINTER_AXIS" },
+	{ LIBINPUT_EVENT_TOUCH_DOWN, "TOUCH_DOWN" },
+	{ LIBINPUT_EVENT_TOUCH_UP, "TOUCH_UP" },
+	{ LIBINPUT_EVENT_TOUCH_MOTION, "TOUCH_MOTION" },
+	{ LIBINPUT_EVENT_TOUCH_CANCEL, "TOUCH_CANCEL" },
+	{ LIBINPUT_EVENT_TOUCH_FRAME, "TOUCH_FRAME" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_AXIS, "TABLET_TOOL_AXIS" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY, "TABLET_TOOL_PROXIMITY" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_TIP, "TABLET_TOOL_TIP" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_BUTTON, "TABLET_TOOL_BUTTON" },
+	{ LIBINPUT_EVENT_TABLET_PAD_BUTTON, "TABLET_PAD_BUTTON" },
+	{ LIBINPUT_EVENT_TABLET_PAD_RING, "TABLET_PAD_RING" },
+	{ LIBINPUT_EVENT_TABLET_PAD_STRIP, "TABLET_PAD_STRIP" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN, "GESTURE_SWIPE_BEGIN" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE, "GESTURE_SWIPE_UPDATE" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_END, "GESTURE_SWIPE_END" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_BEGIN, "GESTURE_PINCH_BEGIN" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_UPDATE, "GESTURE_PINCH_UPDATE" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_END, "GESTURE_PINCH_END" },
+	{ LIBINPUT_EVENT_SWITCH_TOGGLE, "SWITCH_TOGGLE" },
+};
+
+static const struct {
+	enum libinput_latency_stage stage;
+	const char *name;
+} stages[] = {
+	{ LIBINPUT_LATENCY_STAGE_PROCESSING, "processing" },
+	{ LIBINPUT_LATENCY_STAGE_QUEUED, "queued" },
+	{ LIBINPUT_LATENCY_STAGE_TOTAL, "total" },
+};
+
+static void
+device_list_add(struct device_list *list,
+		struct libinput_device *device)
+{
+	if (list->ndevices == list->size) {
+		size_t size = max(list->size * 2, 8);
+		struct libinput_device **devices;
+
+		devices = realloc(list->devices, size * sizeof(*devices));
+		if (!devices) {
+			error("Failed to allocate memory, ignoring device\n");
+			return;
+		}
+		list->devices = devices;
+		list->size = size;
+	}
+
+	list->devices[list->ndevices++] = libinput_device_ref(device);
+}
+
+static void
+handle_events(struct libinput *li, struct device_list *devices)
+{
+	struct libinput_event *ev;
+
+	libinput_dispatch(li);
+
+	while ((ev = libinput_get_event(li))) {
+		/* Keep a reference to every device so removed devices are
+		 * still in the summary */
+		if (libinput_event_get_type(ev) == LIBINPUT_EVENT_DEVICE_ADDED)
+			device_list_add(devices, libinput_event_get_device(ev));
+
+		libinput_event_destroy(ev);
+	}
+}
+
+static void
+print_statistics(struct device_list *devices)
+{
+	size_t d;
+	unsigned int i, j;
+	bool printed = false;
+
+	printf("%-20s %-24s %-10s %10s %10s %10s %10s\n",
+	       "device",
+	       "event",
+	       "stage",
+	       "count",
+	       "p50 (us)",
+	       "p99 (us)",
+	       "max (us)");
+
+	for (d = 0; d < devices->ndevices; d++) {
+		struct libinput_device *device = devices->devices[d];
+
+		for (i = 0; i < ARRAY_LENGTH(event_types); i++) {
+			uint64_t count;
+
+			count = libinput_device_get_latency_count(device,
+								  event_types[i].type);
+			if (count == 0)
+				continue;
+
+			for (j = 0; j < ARRAY_LENGTH(stages); j++) {
+				enum libinput_latency_stage s = stages[j].stage;
+
+				printf("%-20.20s %-24s %-10s %10" PRIu64
+				       " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+				       libinput_device_get_sysname(device),
+				       event_types[i].name,
+				       stages[j].name,
+				       count,
+				       libinput_device_get_latency_percentile(
+						device, event_types[i].type, s, 50),
+				       libinput_device_get_latency_percentile(
+						device, event_types[i].type, s, 99),
+				       libinput_device_get_latency_percentile(
+						device, event_types[i].type, s, 100));
+			}
+			printed = true;
+		}
+	}
+
+	if (!printed)
+		error("No events were recorded.\n");
+}
+
+static int
+loop(struct libinput *li, struct device_list *devices)
+{
+	struct pollfd fds[2];
+	sigset_t mask;
+
+	fds[0].fd = libinput_get_fd(li);
+	fds[0].events = POLLIN;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	fds[1].fd = signalfd(-1, &mask, SFD_NONBLOCK);
+	fds[1].events = POLLIN;
+
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+
+	if (fds[1].fd < 0) {
+		error("Failed to set up signal handling (%s)\n",
+		      strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	error("Ready for recording data.\n"
+	      "Use the devices as usual, Ctrl+C to exit\n");
+
+	handle_events(li, devices);
+
+	while (poll(fds, 2, -1) > -1) {
+		if (fds[1].revents)
+			break;
+
+		handle_events(li, devices);
+	}
+
+	close(fds[1].fd);
+
+	return EXIT_SUCCESS;
+}
+
+static inline void
+usage(void)
+{
+	printf("Usage: libinput measure latency [--help] [/dev/input/event0]\n");
+	printf("\n"
+	       "Measure the latency of events from the kernel timestamp to the\n"
+	       "event being processed and returned to the caller.\n"
+	       "If a path to the device is provided, that device is used. Otherwise, this tool\n"
+	       "uses all devices on seat0.\n"
+	       "\n"
+	       "Options:\n"
+	       "--help ...... show this help\n"
+	       "\n"
+	       "This tool requires access to the /dev/input/eventX nodes.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct tools_context context;
+	struct libinput *li;
+	struct device_list devices = { NULL, 0, 0 };
+	size_t i;
+	int option_index = 0;
+	int rc;
+
+	while (1) {
+		enum opts {
+			OPT_HELP,
+		};
+		static struct option opts[] = {
+			{ "help",	      no_argument, 0, OPT_HELP },
+			{ 0, 0, 0, 0 },
+		};
+		int c;
+
+		c = getopt_long(argc, argv, "", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch(c) {
+		case OPT_HELP:
+			usage();
+			return EXIT_SUCCESS;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	tools_init_context(&context);
+	if (optind < argc) {
+		context.options.backend = BACKEND_DEVICE;
+		context.options.device = argv[optind];
+	}
+
+	li = tools_open_backend(&context);
+	if (!li)
+		return EXIT_FAILURE;
+
+	libinput_set_latency_tracking(li, 1);
+
+	rc = loop(li, &devices);
+
+	if (rc == EXIT_SUCCESS)
+		print_statistics(&devices);
+
+	for (i = 0; i < devices.ndevices; i++)
+		libinput_device_unref(devices.devices[i]);
+	free(devices.devices);
+
+	libinput_unref(li);
+
+	return rc;
+}
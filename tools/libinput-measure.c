@@ -48,6 +48,8 @@ usage(void)
 	       "Available features are:\n"
 	       "  touchpad-tap-time\n"
 	       "	Measures the time for tap-to-click interactions\n"
+	       "  latency\n"
+	       "	Measures the latency of events from the kernel to the caller\n"
 	       "     "
 	       "For information about each feature, see the --help output for that feature.\n"
 	       "\n"
@@ -0,0 +1,477 @@
+/*
+ * Copyright © 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/input.h>
+
+#include "filter.h"
+#include "libinput-util.h"
+
+#define error(...) fprintf(stderr, __VA_ARGS__)
+
+/* Without an event for this long the device was still, the motion of the
+ * next event happened just before that event */
+#define MAX_EVENT_INTERVAL ms2us(50)
+
+struct sample {
+	uint64_t time;
+	struct device_float_coords raw;
+	struct normalized_coords delta;
+	struct device_float_coords velocity;
+	struct normalized_coords position; /* after this event */
+};
+
+struct trace {
+	struct sample *samples;
+	size_t nsamples;
+	size_t size;
+};
+
+static bool
+trace_add(struct trace *trace, uint64_t time, double dx, double dy)
+{
+	struct sample *s;
+
+	if (trace->nsamples == trace->size) {
+		size_t size = max(trace->size * 2, 1024);
+		struct sample *samples;
+
+		samples = realloc(trace->samples, size * sizeof(*samples));
+		if (!samples)
+			return false;
+		trace->samples = samples;
+		trace->size = size;
+	}
+
+	s = &trace->samples[trace->nsamples++];
+	memset(s, 0, sizeof(*s));
+	s->time = time;
+	s->raw.x = dx;
+	s->raw.y = dy;
+
+	return true;
+}
+
+/* Read the relative motion from an evemu recording. Absolute devices are
+ * converted to deltas between the positions of a touch. */
+static bool
+trace_read(struct trace *trace, FILE *fp)
+{
+	char line[256];
+	double dx = 0.0, dy = 0.0;
+	int32_t x = 0, y = 0;
+	bool has_x = false, has_y = false;
+
+	while (fgets(line, sizeof(line), fp)) {
+		unsigned long sec;
+		unsigned int usec, type, code;
+		int value;
+		uint64_t time;
+
+		if (sscanf(line, "E: %lu.%u %x %x %d",
+			   &sec, &usec, &type, &code, &value) != 5)
+			continue;
+
+		time = s2us(sec) + usec;
+
+		switch (type) {
+		case EV_REL:
+			if (code == REL_X)
+				dx += value;
+			else if (code == REL_Y)
+				dy += value;
+			break;
+		case EV_ABS:
+			if (code == ABS_X) {
+				if (has_x)
+					dx += value - x;
+				x = value;
+				has_x = true;
+			} else if (code == ABS_Y) {
+				if (has_y)
+					dy += value - y;
+				y = value;
+				has_y = true;
+			}
+			break;
+		case EV_KEY:
+			/* a new touch starts from scratch */
+			if (code == BTN_TOUCH && value == 0) {
+				has_x = false;
+				has_y = false;
+			}
+			break;
+		case EV_SYN:
+			if (code != SYN_REPORT)
+				break;
+			if (dx == 0.0 && dy == 0.0)
+				break;
+			if (!trace_add(trace, time, dx, dy))
+				return false;
+			dx = 0.0;
+			dy = 0.0;
+			break;
+		}
+	}
+
+	return true;
+}
+
+static void
+trace_filter(struct trace *trace, struct motion_filter *filter)
+{
+	struct normalized_coords position = { 0.0, 0.0 };
+	size_t i;
+
+	for (i = 0; i < trace->nsamples; i++) {
+		struct sample *s = &trace->samples[i];
+		double length, speed;
+
+		s->delta = filter_dispatch(filter, &s->raw, NULL, s->time);
+
+		/* Same as the fallback dispatch, the velocity keeps the
+		 * direction of the delta */
+		length = hypot(s->raw.x, s->raw.y);
+		speed = filter_get_velocity(filter);
+		s->velocity.x = s->raw.x/length * speed;
+		s->velocity.y = s->raw.y/length * speed;
+
+		position.x += s->delta.x;
+		position.y += s->delta.y;
+		s->position = position;
+	}
+}
+
+/* The pointer position at the given time, interpolated between events */
+static struct normalized_coords
+trace_position_at(const struct trace *trace, size_t from, uint64_t time)
+{
+	const struct sample *prev, *next;
+	struct normalized_coords p;
+	double frac;
+	size_t i = from;
+
+	while (trace->samples[i].time < time)
+		i++;
+
+	next = &trace->samples[i];
+	prev = &trace->samples[i - 1];
+
+	if (next->time - prev->time > MAX_EVENT_INTERVAL) {
+		if (next->time - time > MAX_EVENT_INTERVAL)
+			return prev->position;
+		frac = 1.0 - (double)(next->time - time)/MAX_EVENT_INTERVAL;
+	} else {
+		frac = (double)(time - prev->time)/(next->time - prev->time);
+	}
+
+	p.x = prev->position.x + frac * (next->position.x - prev->position.x);
+	p.y = prev->position.y + frac * (next->position.y - prev->position.y);
+
+	return p;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double da = *(const double *)a,
+	       db = *(const double *)b;
+
+	return (da > db) - (da < db);
+}
+
+static double
+percentile(double *values, size_t count, double p)
+{
+	size_t idx = ceil(p/100.0 * count);
+
+	return values[idx > 0 ? idx - 1 : 0];
+}
+
+static void
+print_errors(const char *name, double *errors, size_t count)
+{
+	double sum = 0.0;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		sum += errors[i];
+
+	qsort(errors, count, sizeof(*errors), cmp_double);
+
+	printf(" %-10s %10.3f %10.3f %10.3f %10.3f",
+	       name,
+	       sum/count,
+	       percentile(errors, count, 50),
+	       percentile(errors, count, 95),
+	       errors[count - 1]);
+}
+
+static bool
+evaluate_horizon(const struct trace *trace, uint64_t horizon)
+{
+	const struct sample *last = &trace->samples[trace->nsamples - 1];
+	double *baseline, *predicted;
+	size_t i, count = 0;
+
+	baseline = calloc(trace->nsamples, sizeof(*baseline));
+	predicted = calloc(trace->nsamples, sizeof(*predicted));
+	if (!baseline || !predicted) {
+		free(baseline);
+		free(predicted);
+		return false;
+	}
+
+	for (i = 1; i < trace->nsamples; i++) {
+		const struct sample *s = &trace->samples[i];
+		struct normalized_coords actual, guess;
+
+		if (s->time + horizon > last->time)
+			break;
+
+		actual = trace_position_at(trace, i, s->time + horizon);
+
+		/* Without prediction the pointer stays where it is */
+		baseline[count] = hypot(actual.x - s->position.x,
+					actual.y - s->position.y);
+
+		guess = filter_predict_motion(&s->delta,
+					      &s->raw,
+					      &s->velocity,
+					      NULL,
+					      horizon);
+		guess.x += s->position.x;
+		guess.y += s->position.y;
+		predicted[count] = hypot(actual.x - guess.x,
+					 actual.y - guess.y);
+		count++;
+	}
+
+	printf("%8.1f %8zu", horizon/1000.0, count);
+	if (count > 0) {
+		print_errors("baseline", baseline, count);
+		printf("\n%17s", "");
+		print_errors("predicted", predicted, count);
+	}
+	printf("\n");
+
+	free(baseline);
+	free(predicted);
+
+	return true;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: %s [options] [recording.evemu]\n", program_invocation_short_name);
+	printf("\n"
+	       "Replay the relative motion of an evemu recording through a motion filter\n"
+	       "and print the error of the predicted pointer position compared to the\n"
+	       "position the pointer actually reached, for a number of prediction\n"
+	       "horizons. Errors are in normalized units, the baseline is the error\n"
+	       "without prediction.\n"
+	       "\n"
+	       "If no recording is given, the recording is read from stdin.\n"
+	       "\n"
+	       "Options:\n"
+	       "--horizon=<double> ... the prediction horizon in ms (default: 4, 8, 16, 24 and 32)\n"
+	       "--speed=<double>  ... accel speed [-1, 1], default 0\n"
+	       "--dpi=<int>	... device resolution in DPI (default: 1000)\n"
+	       "--trackers=<int> ... number of events used for the velocity (default: 16)\n"
+	       "--filter=<linear|low-dpi|touchpad|x230|trackpoint> \n"
+	       "	linear	  ... the default motion filter\n"
+	       "	low-dpi	  ... low-dpi filter, use --dpi with this argument\n"
+	       "	touchpad  ... the touchpad motion filter\n"
+	       "	x230  	  ... custom filter for the Lenovo x230 touchpad\n"
+	       "	trackpoint... trackpoint motion filter\n"
+	       "\n"
+	       "Touchpad recordings are replayed from the single-touch axes, the\n"
+	       "velocity comes from the filter, not the per-touch motion history\n"
+	       "libinput uses for touchpads.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct motion_filter *filter;
+	struct trace trace = { NULL, 0, 0 };
+	uint64_t horizons[] = { ms2us(4), ms2us(8), ms2us(16), ms2us(24), ms2us(32) };
+	size_t nhorizons = ARRAY_LENGTH(horizons);
+	double speed = 0.0;
+	int dpi = 1000;
+	int ntrackers = 0;
+	const char *filter_type = "linear";
+	FILE *fp = stdin;
+	size_t i;
+	int rc = EXIT_FAILURE;
+
+	enum {
+		OPT_HELP = 1,
+		OPT_HORIZON,
+		OPT_SPEED,
+		OPT_DPI,
+		OPT_FILTER,
+		OPT_TRACKERS,
+	};
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		static struct option long_options[] = {
+			{"help", 0, 0, OPT_HELP },
+			{"horizon", 1, 0, OPT_HORIZON },
+			{"speed", 1, 0, OPT_SPEED },
+			{"dpi", 1, 0, OPT_DPI },
+			{"filter", 1, 0, OPT_FILTER },
+			{"trackers", 1, 0, OPT_TRACKERS },
+			{0, 0, 0, 0}
+		};
+		double ms;
+
+		c = getopt_long(argc, argv, "",
+				long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_HELP:
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_HORIZON:
+			ms = strtod(optarg, NULL);
+			if (ms <= 0.0) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			horizons[0] = ms * 1000;
+			nhorizons = 1;
+			break;
+		case OPT_SPEED:
+			speed = strtod(optarg, NULL);
+			break;
+		case OPT_DPI:
+			dpi = strtod(optarg, NULL);
+			break;
+		case OPT_FILTER:
+			filter_type = optarg;
+			break;
+		case OPT_TRACKERS:
+			ntrackers = atoi(optarg);
+			if (ntrackers < 2) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (streq(filter_type, "linear")) {
+		filter = create_pointer_accelerator_filter_linear(dpi);
+	} else if (streq(filter_type, "low-dpi")) {
+		filter = create_pointer_accelerator_filter_linear_low_dpi(dpi);
+	} else if (streq(filter_type, "touchpad")) {
+		filter = create_pointer_accelerator_filter_touchpad(dpi);
+	} else if (streq(filter_type, "x230")) {
+		filter = create_pointer_accelerator_filter_lenovo_x230(dpi);
+	} else if (streq(filter_type, "trackpoint")) {
+		filter = create_pointer_accelerator_filter_trackpoint(dpi);
+	} else {
+		error("Invalid filter type %s\n", filter_type);
+		return EXIT_FAILURE;
+	}
+
+	if (!filter) {
+		error("Failed to create the filter\n");
+		return EXIT_FAILURE;
+	}
+
+	if (speed < -1.0 || speed > 1.0 || !filter_set_speed(filter, speed)) {
+		error("Invalid speed %.2f\n", speed);
+		goto out;
+	}
+
+	if (ntrackers > 0 && !filter_set_tracker_count(filter, ntrackers)) {
+		error("Failed to set the number of trackers\n");
+		goto out;
+	}
+
+	if (optind < argc) {
+		fp = fopen(argv[optind], "r");
+		if (!fp) {
+			error("Failed to open %s (%s)\n",
+			      argv[optind],
+			      strerror(errno));
+			goto out;
+		}
+	}
+
+	if (!trace_read(&trace, fp)) {
+		error("Failed to allocate memory\n");
+		goto out;
+	}
+
+	if (trace.nsamples < 2) {
+		error("No motion in the recording\n");
+		goto out;
+	}
+
+	trace_filter(&trace, filter);
+
+	printf("%8s %8s %-10s %10s %10s %10s %10s\n",
+	       "ms",
+	       "count",
+	       "",
+	       "mean",
+	       "p50",
+	       "p95",
+	       "max");
+
+	for (i = 0; i < nhorizons; i++) {
+		if (!evaluate_horizon(&trace, horizons[i])) {
+			error("Failed to allocate memory\n");
+			goto out;
+		}
+	}
+
+	rc = EXIT_SUCCESS;
+out:
+	if (fp != stdin && fp)
+		fclose(fp);
+	free(trace.samples);
+	filter_destroy(filter);
+
+	return rc;
+}
@@ -114,10 +114,9 @@ print_ptraccel_sequence(struct motion_filter *filter,
 			int nevents,
 			double *deltas)
 {
-	struct device_float_coords motion;
-	struct normalized_coords accel;
-	uint64_t time = 0;
-	double *dx;
+	double dy[1024] = {0};
+	double accel_x[1024], accel_y[1024];
+	uint64_t times[1024];
 	int i;
 
 	printf("# gnuplot:\n");
@@ -128,17 +127,20 @@ print_ptraccel_sequence(struct motion_filter *filter,
 	printf("#      \"gnuplot.data\" using 1:3 title \"dx in\"\n");
 	printf("#\n");
 
-	dx = deltas;
+	assert(nevents <= 1024);
 
-	for (i = 0; i < nevents; i++, dx++) {
-		motion.x = *dx;
-		motion.y = 0;
-		time += us(12500); /* pretend 80Hz data */
+	for (i = 0; i < nevents; i++)
+		times[i] = us(12500) * (i + 1); /* pretend 80Hz data */
 
-		accel = filter_dispatch(filter, &motion, NULL, time);
+	filter_dispatch_batch(filter,
+			      nevents,
+			      deltas, dy,
+			      times,
+			      NULL,
+			      accel_x, accel_y);
 
-		printf("%d	%.3f	%.3f\n", i, accel.x, *dx);
-	}
+	for (i = 0; i < nevents; i++)
+		printf("%d	%.3f	%.3f\n", i, accel_x[i], deltas[i]);
 }
 
 /* mm/s → units/µs */
@@ -161,11 +163,13 @@ print_accel_func(struct motion_filter *filter,
 	printf("# set style data lines\n");
 	printf("# plot \"gnuplot.data\" using 1:2 title 'accel factor'\n");
 	printf("#\n");
-	printf("# data: velocity(mm/s) factor velocity(units/us)\n");
+	printf("# data: velocity(mm/s) factor velocity(units/us) table-factor\n");
 	for (mmps = 0.0; mmps < 1000.0; mmps += 1) {
 		double units_per_us = mmps_to_upus(mmps, dpi);
 		double result = profile(filter, NULL, units_per_us, 0 /* time */);
-		printf("%.8f\t%.4f\t%.8f\n", mmps, result, units_per_us);
+		double table = filter_get_accel_factor(filter, units_per_us);
+		printf("%.8f\t%.4f\t%.8f\t%.4f\n",
+		       mmps, result, units_per_us, table);
 	}
 }
 
@@ -184,6 +188,7 @@ usage(void)
 	       "--steps=<double>  ... in motion and delta modes only. Increase dx by step each round\n"
 	       "--speed=<double>  ... accel speed [-1, 1], default 0\n"
 	       "--dpi=<int>	... device resolution in DPI (default: 1000)\n"
+	       "--trackers=<int> ... number of events used for the velocity (default: 16)\n"
 	       "--filter=<linear|low-dpi|touchpad|x230|trackpoint> \n"
 	       "	linear	  ... the default motion filter\n"
 	       "	low-dpi	  ... low-dpi filter, use --dpi with this argument\n"
@@ -217,6 +222,7 @@ main(int argc, char **argv)
 	double custom_deltas[1024];
 	double speed = 0.0;
 	int dpi = 1000;
+	int ntrackers = 0;
 	const char *filter_type = "linear";
 	accel_profile_func_t profile = NULL;
 
@@ -229,6 +235,7 @@ main(int argc, char **argv)
 		OPT_SPEED,
 		OPT_DPI,
 		OPT_FILTER,
+		OPT_TRACKERS,
 	};
 
 	while (1) {
@@ -243,6 +250,7 @@ main(int argc, char **argv)
 			{"speed", 1, 0, OPT_SPEED },
 			{"dpi", 1, 0, OPT_DPI },
 			{"filter", 1, 0, OPT_FILTER },
+			{"trackers", 1, 0, OPT_TRACKERS },
 			{0, 0, 0, 0}
 		};
 
@@ -300,6 +308,13 @@ main(int argc, char **argv)
 		case OPT_FILTER:
 			filter_type = optarg;
 			break;
+		case OPT_TRACKERS:
+			ntrackers = atoi(optarg);
+			if (ntrackers < 2) {
+				usage();
+				return 1;
+			}
+			break;
 		default:
 			usage();
 			exit(1);
@@ -330,6 +345,11 @@ main(int argc, char **argv)
 	assert(filter != NULL);
 	filter_set_speed(filter, speed);
 
+	if (ntrackers > 0 && !filter_set_tracker_count(filter, ntrackers)) {
+		fprintf(stderr, "Failed to set the number of trackers\n");
+		return 1;
+	}
+
 	if (!isatty(STDIN_FILENO)) {
 		char buf[12];
 		print_sequence = true;
@@ -122,8 +122,17 @@ def property_grammar():
                          Suppress('=') -
                          kbintegration_tags('VALUE')]
 
+    history_length = [Literal('LIBINPUT_ATTR_TOUCHPAD_HISTORY_LENGTH')('NAME') -
+                      Suppress('=') -
+                      INTEGER('VALUE')]
+
+    history_velocity = [Literal('LIBINPUT_ATTR_TOUCHPAD_HISTORY_VELOCITY')('NAME') -
+                        Suppress('=') -
+                        Or(('0', '1'))('VALUE')]
+
     grammar = Or(model_props + size_props + reliability + tpkbcombo +
-                 pressure_prop + kbintegration)
+                 pressure_prop + kbintegration + history_length +
+                 history_velocity)
 
     return grammar
 